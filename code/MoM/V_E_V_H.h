@@ -51,6 +51,19 @@ void local_V_CFIE_dipole (blitz::Array<std::complex<float>, 1>& V_CFIE,
                           const blitz::Array<std::complex<float>, 1>& CFIE,
                           const int FULL_PRECISION);
 
+void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
+                          const blitz::Array<std::complex<float>, 1>& CFIE,
+                          const blitz::Array<std::complex<double>, 2>& J_dip,
+                          const blitz::Array<double, 2>& r_dip,
+                          const blitz::Array<int, 1>& numbers_RWG_test,
+                          const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
+                          const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                          const double w,
+                          const std::complex<double>& eps_r,
+                          const std::complex<double>& mu_r,
+                          const char CURRENT_TYPE,
+                          const int FULL_PRECISION);
+
 void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1>& V_CFIE,
                                 const blitz::Array<std::complex<double>, 2>& J_dip,
                                 const blitz::Array<double, 2>& r_dip,
@@ -62,6 +75,30 @@ void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1>& V_CFIE,
                                 const char CURRENT_TYPE,
                                 const int FULL_PRECISION);
 
+// the excitation vectors of the dipoles taken separately, one row of V_CFIE per dipole.
+// They are computed in one pass over the mesh.
+void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 2>& V_CFIE,
+                                const blitz::Array<std::complex<double>, 2>& J_dip,
+                                const blitz::Array<double, 2>& r_dip,
+                                const LocalMesh & local_target_mesh,
+                                const double w,
+                                const std::complex<double>& eps_r,
+                                const std::complex<double>& mu_r,
+                                const blitz::Array<std::complex<float>, 1>& CFIE,
+                                const char CURRENT_TYPE,
+                                const int FULL_PRECISION);
+
+void compute_E_obs(blitz::Array<std::complex<float>, 1>& E_obs,
+                   blitz::Array<std::complex<float>, 1>& H_obs,
+                   const blitz::Array<double, 1>& r_obs,
+                   const blitz::Array<std::complex<float>, 1>& ZI,
+                   const blitz::Array<int, 1>& numbers_RWG_test,
+                   const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                   const double w,
+                   const std::complex<double>& eps_r,
+                   const std::complex<double>& mu_r,
+                   const int FULL_PRECISION);
+
 void local_compute_E_obs (blitz::Array<std::complex<float>, 1>& E_obs,
                           blitz::Array<std::complex<float>, 1>& H_obs,
                           const blitz::Array<double, 1>& r_obs,
@@ -137,6 +174,34 @@ void local_V_CFIE_plane (blitz::Array<std::complex<float>, 1>& V_CFIE,
                          const blitz::Array<std::complex<float>, 1>& CFIE,
                          const int FULL_PRECISION);
 
+// the excitation vectors of several plane waves, one row of V_CFIE per excitation
+// (E_0(e, :), k_hat(e, :)). They are computed in one pass over the mesh, by N_threads threads.
+void V_CFIE_plane_array (blitz::Array<std::complex<float>, 2> V_CFIE,
+                         const blitz::Array<std::complex<float>, 1>& CFIE,
+                         const blitz::Array<std::complex<double>, 2>& E_0,
+                         const blitz::Array<double, 2>& k_hat,
+                         const blitz::Array<double, 1>& r_ref,
+                         const blitz::Array<int, 1>& numbers_RWG_test,
+                         const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
+                         const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                         const double w,
+                         const std::complex<double>& eps_r,
+                         const std::complex<double>& mu_r,
+                         const int FULL_PRECISION,
+                         const int N_threads);
+
+void local_V_CFIE_plane_array (blitz::Array<std::complex<float>, 2>& V_CFIE,
+                               const blitz::Array<std::complex<double>, 2>& E_0,
+                               const blitz::Array<double, 2>& k_hat,
+                               const blitz::Array<double, 1>& r_ref,
+                               const LocalMesh & local_target_mesh,
+                               const double w,
+                               const std::complex<double>& eps_r,
+                               const std::complex<double>& mu_r,
+                               const blitz::Array<std::complex<float>, 1>& CFIE,
+                               const int FULL_PRECISION,
+                               const int N_threads);
+
 void local_V_CFIE_slot (blitz::Array<std::complex<float>, 1>& V_CFIE,
                         const std::complex<double> E_0,
                         const blitz::Array<double, 1>& l_hat,
@@ -390,23 +390,25 @@ void local_V_CFIE_dipole (blitz::Array<std::complex<float>, 1>& V_CFIE,
 }
 
 
-void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
-                          const blitz::Array<std::complex<float>, 1>& CFIE,
-                          const blitz::Array<std::complex<double>, 2>& J_dip,
-                          const blitz::Array<double, 2>& r_dip,
-                          const blitz::Array<int, 1>& numbers_RWG_test,
-                          const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
-                          const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
-                          const double w,
-                          const std::complex<double>& eps_r,
-                          const std::complex<double>& mu_r,
-                          const char CURRENT_TYPE,
-                          const int FULL_PRECISION)
+void V_CFIE_dipole_array_rows (blitz::Array<std::complex<float>, 2> V_CFIE,
+                               const blitz::Array<std::complex<float>, 1>& CFIE,
+                               const blitz::Array<std::complex<double>, 2>& J_dip,
+                               const blitz::Array<double, 2>& r_dip,
+                               const blitz::Array<int, 1>& numbers_RWG_test,
+                               const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
+                               const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                               const double w,
+                               const std::complex<double>& eps_r,
+                               const std::complex<double>& mu_r,
+                               const char CURRENT_TYPE,
+                               const int FULL_PRECISION,
+                               const int SEPARATE)
 /**
  * This function computes the CFIE excitation vectors of the MoM due to
  * multiple elementary electric current elements J_dip located at r_dip.
- * This allows for more complex sources to be modeled.
- *
+ * If SEPARATE==0, V_CFIE has one row, the excitation of all the dipoles together.
+ * Otherwise, row d of V_CFIE is the excitation of dipole d alone: the triangles
+ * geometry and integration points are then shared by all the dipoles.
  */
 {
   // def of k, mu_i, eps_i
@@ -415,6 +417,7 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
     cout << "Error in V_CFIE_dipole_array: J_dip and R_dip don't have the same size. Aborting." << endl;
     exit(1);
   }
+  const int N_rows = (SEPARATE!=0) ? N_dipoles : 1;
   std::complex<double> mu = mu_0 * mu_r, eps = eps_0 * eps_r, k = w * sqrt(eps*mu);
   const complex<double> tE = CFIE(0), nE = CFIE(1), tH = CFIE(2), nH = CFIE(3);
   // triangle integration precision. Possible values for N_points: 1, 3, 6, 9, 12, 13
@@ -430,8 +433,10 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
 
   // geometrical entities
   double r0[3], r1[3], r2[3], *r_opp;
-  std::complex<double> ITo_r_dot_H_inc, ITo_r_dot_E_inc, ITo_n_hat_X_r_dot_H_inc, ITo_n_hat_X_r_dot_E_inc;
-  std::complex<double> H_inc_i[3], ITo_H_inc[3], E_inc_i[3], ITo_E_inc[3];
+  // the integrals of the incoming fields, for each row of V_CFIE
+  std::vector< std::complex<double> > ITo_r_dot_H_inc(N_rows), ITo_r_dot_E_inc(N_rows), ITo_n_hat_X_r_dot_H_inc(N_rows), ITo_n_hat_X_r_dot_E_inc(N_rows);
+  std::vector< std::complex<double> > ITo_H_inc(3*N_rows), ITo_E_inc(3*N_rows);
+  std::complex<double> H_inc_i[3], E_inc_i[3];
   std::vector< std::vector < std::complex<double> > > G_EJ, G_HJ;
   G_EJ.resize(3);
   G_HJ.resize(3);
@@ -468,12 +473,14 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
         l_p = sqrt(dot3D(r0_r1, r0_r1));
       }
       Triangle triangle(r0, r1, r2, 0);
-      for (int i=0 ; i<3 ; ++i) ITo_E_inc[i] = 0.0; // Vector<complex<double>, 3>
-      for (int i=0 ; i<3 ; ++i) ITo_H_inc[i] = 0.0; // Vector<complex<double>, 3>
-      ITo_r_dot_E_inc = 0.0; // complex<double>
-      ITo_r_dot_H_inc = 0.0; // complex<double>
-      ITo_n_hat_X_r_dot_E_inc = 0.0; // complex<double>
-      ITo_n_hat_X_r_dot_H_inc = 0.0; // complex<double>
+      for (int i=0 ; i<3*N_rows ; ++i) ITo_E_inc[i] = 0.0;
+      for (int i=0 ; i<3*N_rows ; ++i) ITo_H_inc[i] = 0.0;
+      for (int row=0 ; row<N_rows ; ++row) {
+        ITo_r_dot_E_inc[row] = 0.0;
+        ITo_r_dot_H_inc[row] = 0.0;
+        ITo_n_hat_X_r_dot_E_inc[row] = 0.0;
+        ITo_n_hat_X_r_dot_H_inc[row] = 0.0;
+      }
 
       // we first select the weights and abscissas for triangle integration
       bool IS_NEAR;
@@ -491,6 +498,7 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
       IT_points (xi, eta, weigths, sum_weigths, N_points);
       // now the loop on the sources
       for (int dipNumber = 0 ; dipNumber < N_dipoles ; dipNumber++) {
+        const int row = (SEPARATE!=0) ? dipNumber : 0;
         for (int i=0 ; i<3 ; ++i) rDip[i] = r_dip(dipNumber, i);
         for (int i=0 ; i<3 ; ++i) JDip[i] = J_dip(dipNumber, i);
         // triangle integration
@@ -523,32 +531,25 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
 
           // computation of ITo_E_inc due to a dipole located at r_dip
           for (int m=0 ; m<3 ; m++) E_inc_i[m] = (G_EJ [m][0] * JDip[0] + G_EJ [m][1] * JDip[1] + G_EJ [m][2] * JDip[2]) * weigths[j];
-          ITo_E_inc[0] += E_inc_i[0];
-          ITo_E_inc[1] += E_inc_i[1];
-          ITo_E_inc[2] += E_inc_i[2];
-          ITo_r_dot_E_inc += (r_obs[0] * E_inc_i[0] + r_obs[1] * E_inc_i[1] + r_obs[2] * E_inc_i[2]);
-          ITo_n_hat_X_r_dot_E_inc += (n_hat_X_r[0] * E_inc_i[0] + n_hat_X_r[1] * E_inc_i[1] + n_hat_X_r[2] * E_inc_i[2]);
+          ITo_E_inc[3*row] += E_inc_i[0];
+          ITo_E_inc[3*row+1] += E_inc_i[1];
+          ITo_E_inc[3*row+2] += E_inc_i[2];
+          ITo_r_dot_E_inc[row] += (r_obs[0] * E_inc_i[0] + r_obs[1] * E_inc_i[1] + r_obs[2] * E_inc_i[2]);
+          ITo_n_hat_X_r_dot_E_inc[row] += (n_hat_X_r[0] * E_inc_i[0] + n_hat_X_r[1] * E_inc_i[1] + n_hat_X_r[2] * E_inc_i[2]);
 
           // computation of ITo_H_inc due to a dipole located at r_dip
           for (int m=0 ; m<3 ; m++) H_inc_i[m] = (G_HJ [m][0] * JDip[0] + G_HJ [m][1] * JDip[1] + G_HJ [m][2] * JDip[2]) * weigths[j];
-          ITo_H_inc[0] += H_inc_i[0];
-          ITo_H_inc[1] += H_inc_i[1];
-          ITo_H_inc[2] += H_inc_i[2];
-          ITo_r_dot_H_inc += (r_obs[0] * H_inc_i[0] + r_obs[1] * H_inc_i[1] + r_obs[2] * H_inc_i[2]);
-          ITo_n_hat_X_r_dot_H_inc += (n_hat_X_r[0] * H_inc_i[0] + n_hat_X_r[1] * H_inc_i[1] + n_hat_X_r[2] * H_inc_i[2]);
+          ITo_H_inc[3*row] += H_inc_i[0];
+          ITo_H_inc[3*row+1] += H_inc_i[1];
+          ITo_H_inc[3*row+2] += H_inc_i[2];
+          ITo_r_dot_H_inc[row] += (r_obs[0] * H_inc_i[0] + r_obs[1] * H_inc_i[1] + r_obs[2] * H_inc_i[2]);
+          ITo_n_hat_X_r_dot_H_inc[row] += (n_hat_X_r[0] * H_inc_i[0] + n_hat_X_r[1] * H_inc_i[1] + n_hat_X_r[2] * H_inc_i[2]);
 
         } // loop on the triangle integration points
       } // loop on the dipoles
  
       const double norm_factor = triangle.A/sum_weigths;
 
-      for (int i=0 ; i<3 ; ++i) ITo_E_inc[i] *= norm_factor;
-      for (int i=0 ; i<3 ; ++i) ITo_H_inc[i] *= norm_factor;
-      ITo_r_dot_E_inc *= norm_factor;
-      ITo_r_dot_H_inc *= norm_factor;
-      ITo_n_hat_X_r_dot_E_inc *= norm_factor;
-      ITo_n_hat_X_r_dot_H_inc *= norm_factor;
-
       const int local_number_edge_p = numbers_RWG_test(rwg);
       const int sign_edge_p = (tr==0) ? 1 : -1;
       const double C_rp = sign_edge_p * l_p * 0.5/triangle.A;
@@ -557,18 +558,39 @@ void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
       double n_hat_X_r_p[3];
       cross3D(n_hat_X_r_p, triangle.n_hat, r_p);
 
-      std::complex<double> tmpResult(0.0, 0.0);
-      tmpResult -= tE * C_rp * (ITo_r_dot_E_inc - (r_p[0]*ITo_E_inc[0] + r_p[1]*ITo_E_inc[1] + r_p[2]*ITo_E_inc[2])); // -<f_m ; E_inc>
-      tmpResult -= nE * C_rp * (ITo_n_hat_X_r_dot_E_inc - (n_hat_X_r_p[0]*ITo_E_inc[0] + n_hat_X_r_p[1]*ITo_E_inc[1] + n_hat_X_r_p[2]*ITo_E_inc[2])); // -<n_hat x f_m ; E_inc> 
-      if (RWGNumber_CFIE_OK(local_number_edge_p) == 1) {
-        tmpResult -= tH * C_rp * (ITo_r_dot_H_inc - (r_p[0]*ITo_H_inc[0] + r_p[1]*ITo_H_inc[1] + r_p[2]*ITo_H_inc[2])); // -<f_m ; H_inc>
-        tmpResult -= nH * C_rp * (ITo_n_hat_X_r_dot_H_inc - (n_hat_X_r_p[0]*ITo_H_inc[0] + n_hat_X_r_p[1]*ITo_H_inc[1] + n_hat_X_r_p[2]*ITo_H_inc[2])); // -<n_hat x f_m ; H_inc> 
+      for (int row=0 ; row<N_rows ; ++row) {
+        const std::complex<double> * ITo_E = &ITo_E_inc[3*row], * ITo_H = &ITo_H_inc[3*row];
+        std::complex<double> tmpResult(0.0, 0.0);
+        tmpResult -= tE * C_rp * (ITo_r_dot_E_inc[row] - (r_p[0]*ITo_E[0] + r_p[1]*ITo_E[1] + r_p[2]*ITo_E[2])); // -<f_m ; E_inc>
+        tmpResult -= nE * C_rp * (ITo_n_hat_X_r_dot_E_inc[row] - (n_hat_X_r_p[0]*ITo_E[0] + n_hat_X_r_p[1]*ITo_E[1] + n_hat_X_r_p[2]*ITo_E[2])); // -<n_hat x f_m ; E_inc> 
+        if (RWGNumber_CFIE_OK(local_number_edge_p) == 1) {
+          tmpResult -= tH * C_rp * (ITo_r_dot_H_inc[row] - (r_p[0]*ITo_H[0] + r_p[1]*ITo_H[1] + r_p[2]*ITo_H[2])); // -<f_m ; H_inc>
+          tmpResult -= nH * C_rp * (ITo_n_hat_X_r_dot_H_inc[row] - (n_hat_X_r_p[0]*ITo_H[0] + n_hat_X_r_p[1]*ITo_H[1] + n_hat_X_r_p[2]*ITo_H[2])); // -<n_hat x f_m ; H_inc> 
+        }
+        V_CFIE(row, local_number_edge_p) += tmpResult * norm_factor;
       }
-      V_CFIE(local_number_edge_p) += tmpResult;
     }
   }
 }
 
+void V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1> V_CFIE,
+                          const blitz::Array<std::complex<float>, 1>& CFIE,
+                          const blitz::Array<std::complex<double>, 2>& J_dip,
+                          const blitz::Array<double, 2>& r_dip,
+                          const blitz::Array<int, 1>& numbers_RWG_test,
+                          const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
+                          const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                          const double w,
+                          const std::complex<double>& eps_r,
+                          const std::complex<double>& mu_r,
+                          const char CURRENT_TYPE,
+                          const int FULL_PRECISION)
+{
+  blitz::Array<std::complex<float>, 2> V_CFIE_row(1, V_CFIE.size());
+  V_CFIE_dipole_array_rows (V_CFIE_row, CFIE, J_dip, r_dip, numbers_RWG_test, RWGNumber_CFIE_OK, RWGNumber_trianglesCoord, w, eps_r, mu_r, CURRENT_TYPE, FULL_PRECISION, 0);
+  V_CFIE = V_CFIE_row(0, blitz::Range::all());
+}
+
 void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1>& V_CFIE,
                                 const blitz::Array<std::complex<double>, 2>& J_dip,
                                 const blitz::Array<double, 2>& r_dip,
@@ -585,6 +607,22 @@ void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 1>& V_CFIE,
   V_CFIE_dipole_array (V_CFIE, CFIE, J_dip, r_dip, local_target_mesh.reallyLocalRWGNumbers, local_target_mesh.localRWGNumber_CFIE_OK, local_target_mesh.localRWGNumber_trianglesCoord, w, eps_r, mu_r, CURRENT_TYPE, FULL_PRECISION);
 }
 
+void local_V_CFIE_dipole_array (blitz::Array<std::complex<float>, 2>& V_CFIE,
+                                const blitz::Array<std::complex<double>, 2>& J_dip,
+                                const blitz::Array<double, 2>& r_dip,
+                                const LocalMesh & local_target_mesh,
+                                const double w,
+                                const std::complex<double>& eps_r,
+                                const std::complex<double>& mu_r,
+                                const blitz::Array<std::complex<float>, 1>& CFIE,
+                                const char CURRENT_TYPE,
+                                const int FULL_PRECISION)
+{
+  // one excitation vector per dipole, in one pass over the mesh
+  V_CFIE.resize(J_dip.rows(), local_target_mesh.N_local_RWG);
+  V_CFIE_dipole_array_rows (V_CFIE, CFIE, J_dip, r_dip, local_target_mesh.reallyLocalRWGNumbers, local_target_mesh.localRWGNumber_CFIE_OK, local_target_mesh.localRWGNumber_trianglesCoord, w, eps_r, mu_r, CURRENT_TYPE, FULL_PRECISION, 1);
+}
+
 /*****************************************
  * computation of the observation fields *
  *****************************************/
@@ -3,6 +3,7 @@
 #include <blitz/array.h>
 #include <vector>
 #include <algorithm>
+#include <pthread.h>
 
 using namespace std;
 
@@ -330,6 +331,223 @@ void local_V_CFIE_plane (blitz::Array<std::complex<float>, 1>& V_CFIE,
 }
 
 
+//! the data shared by the threads computing the plane waves excitation vectors
+struct V_CFIE_planeThreadsData {
+  blitz::Array<std::complex<float>, 2> * V_CFIE;
+  const blitz::Array<int, 1> * numbers_RWG_test;
+  const blitz::Array<int, 1> * RWGNumber_CFIE_OK;
+  const blitz::Array<float, 2> * RWGNumber_trianglesCoord;
+  // the distinct directions of incidence, the direction of each excitation, and its E_0 and H_0
+  int N_directions, N_excitations;
+  std::vector<double> kHat;
+  std::vector<int> directionOfExcitation;
+  std::vector< std::complex<double> > E0, H0;
+  double rRef[3];
+  std::complex<double> k, tE, nE, tH, nH;
+  // triangle integration
+  int N_points;
+  const double *xi, *eta, *weigths;
+  double sum_weigths;
+  int startRWG, stopRWG;
+};
+
+//! computes the excitation vectors of the RWGs startRWG to stopRWG-1 for all the plane waves
+/*!
+  A plane wave integral is linear in E_0. For each triangle, the phase
+  integrals are therefore computed once per direction of incidence, and
+  all the excitations sharing this direction (e.g. both polarisations)
+  are obtained from them by a few dot products.
+*/
+void * V_CFIE_plane_arrayThread(void * arg)
+{
+  V_CFIE_planeThreadsData * data = static_cast<V_CFIE_planeThreadsData *>(arg);
+  blitz::Array<std::complex<float>, 2> & V_CFIE = *(data->V_CFIE);
+  const blitz::Array<int, 1> & numbers_RWG_test = *(data->numbers_RWG_test);
+  const blitz::Array<int, 1> & RWGNumber_CFIE_OK = *(data->RWGNumber_CFIE_OK);
+  const blitz::Array<float, 2> & RWGNumber_trianglesCoord = *(data->RWGNumber_trianglesCoord);
+  const int N_dir = data->N_directions, N_exc = data->N_excitations, N_points = data->N_points;
+  const double *xi = data->xi, *eta = data->eta, *weigths = data->weigths;
+  const double *kHat = &(data->kHat[0]), *rRef = data->rRef;
+  const std::complex<double> k = data->k;
+  // per direction: I_d = sum of phases, I_r_d = sum of r * phases, I_nXr_d = sum of n_hat x r * phases
+  std::vector< std::complex<double> > I_d(N_dir), I_r_d(3*N_dir), I_nXr_d(3*N_dir), V_rwg(N_exc);
+  double r0[3], r1[3], r2[3], *r_opp;
+
+  for (int rwg=data->startRWG ; rwg<data->stopRWG ; ++rwg) { // loop on the RWGs
+    for (int e=0 ; e<N_exc ; ++e) V_rwg[e] = 0.0;
+    const int local_number_edge_p = numbers_RWG_test(rwg);
+    const bool CFIE_OK = (RWGNumber_CFIE_OK(local_number_edge_p) == 1);
+    for (int tr = 0 ; tr<2 ; ++tr) {
+      double l_p;
+      if (tr==0) {
+        for (int i=0; i<3; i++) { 
+          r0[i] = RWGNumber_trianglesCoord(rwg, i);
+          r1[i] = RWGNumber_trianglesCoord(rwg, i+3);
+          r2[i] = RWGNumber_trianglesCoord(rwg, i+6);
+        }
+        r_opp = r0;
+        double r1_r2[3] = {r1[0]-r2[0], r1[1]-r2[1], r1[2]-r2[2]};
+        l_p = sqrt(dot3D(r1_r2, r1_r2));
+      }
+      else{
+        for (int i=0 ; i<3 ; i++) {
+          r0[i] = RWGNumber_trianglesCoord(rwg, i+6);
+          r1[i] = RWGNumber_trianglesCoord(rwg, i+3);
+          r2[i] = RWGNumber_trianglesCoord(rwg, i+9);
+        }
+        r_opp = r2;
+        double r0_r1[3] = {r0[0]-r1[0], r0[1]-r1[1], r0[2]-r1[2]};
+        l_p = sqrt(dot3D(r0_r1, r0_r1));
+      }
+      Triangle triangle(r0, r1, r2, 0);
+      for (int d=0 ; d<N_dir ; ++d) I_d[d] = 0.0;
+      for (int d=0 ; d<3*N_dir ; ++d) I_r_d[d] = 0.0;
+      for (int d=0 ; d<3*N_dir ; ++d) I_nXr_d[d] = 0.0;
+
+      for (int j=0 ; j<N_points ; ++j) {
+        double r_obs[3];
+        r_obs[0] = r0[0] * xi[j] + r1[0] * eta[j] + r2[0] * (1-xi[j]-eta[j]);
+        r_obs[1] = r0[1] * xi[j] + r1[1] * eta[j] + r2[1] * (1-xi[j]-eta[j]);
+        r_obs[2] = r0[2] * xi[j] + r1[2] * eta[j] + r2[2] * (1-xi[j]-eta[j]);
+        double n_hat_X_r[3];
+        cross3D(n_hat_X_r, triangle.n_hat, r_obs);
+        const double r_obs_rRef[3] = {r_obs[0] - rRef[0], r_obs[1] - rRef[1], r_obs[2] - rRef[2]};
+        // the geometry of the point is shared by all the directions
+        for (int d=0 ; d<N_dir ; ++d) {
+          const double * kHat_d = kHat + 3*d;
+          const std::complex<double> temp(exp(-I*k * (kHat_d[0] * r_obs_rRef[0] + kHat_d[1] * r_obs_rRef[1] + kHat_d[2] * r_obs_rRef[2]) ) * weigths[j]);
+          I_d[d] += temp;
+          for (int m=0 ; m<3 ; m++) I_r_d[3*d + m] += r_obs[m] * temp;
+          for (int m=0 ; m<3 ; m++) I_nXr_d[3*d + m] += n_hat_X_r[m] * temp;
+        }
+      }
+      const double norm_factor = triangle.A/data->sum_weigths;
+      const int sign_edge_p = (tr==0) ? 1 : -1;
+      const double C_rp = sign_edge_p * l_p * 0.5/triangle.A * norm_factor;
+      double *r_p;
+      r_p = r_opp;
+      double n_hat_X_r_p[3];
+      cross3D(n_hat_X_r_p, triangle.n_hat, r_p);
+      // (r - r_p) and n_hat x (r - r_p) integrated with the phase, for each direction
+      for (int d=0 ; d<N_dir ; ++d) {
+        for (int m=0 ; m<3 ; m++) {
+          I_nXr_d[3*d + m] -= n_hat_X_r_p[m] * I_d[d];
+          I_r_d[3*d + m] -= r_p[m] * I_d[d];
+        }
+      }
+
+      for (int e=0 ; e<N_exc ; ++e) {
+        const int d = data->directionOfExcitation[e];
+        const std::complex<double> *E0 = &(data->E0[3*e]), *H0 = &(data->H0[3*e]);
+        const std::complex<double> *I_r = &(I_r_d[3*d]), *I_nXr = &(I_nXr_d[3*d]);
+        std::complex<double> tmpResult(0.0, 0.0);
+        tmpResult -= data->tE * C_rp * (I_r[0]*E0[0] + I_r[1]*E0[1] + I_r[2]*E0[2]); // -<f_m ; E_inc>
+        if (CFIE_OK) {
+          tmpResult -= data->nE * C_rp * (I_nXr[0]*E0[0] + I_nXr[1]*E0[1] + I_nXr[2]*E0[2]); // -<n_hat x f_m ; E_inc>
+          tmpResult -= data->tH * C_rp * (I_r[0]*H0[0] + I_r[1]*H0[1] + I_r[2]*H0[2]); // -<f_m ; H_inc>
+          tmpResult -= data->nH * C_rp * (I_nXr[0]*H0[0] + I_nXr[1]*H0[1] + I_nXr[2]*H0[2]); // -<n_hat x f_m ; H_inc>
+        }
+        V_rwg[e] += tmpResult;
+      }
+    }
+    for (int e=0 ; e<N_exc ; ++e) V_CFIE(e, local_number_edge_p) += V_rwg[e];
+  }
+  return 0;
+}
+
+void V_CFIE_plane_array (blitz::Array<std::complex<float>, 2> V_CFIE,
+                         const blitz::Array<std::complex<float>, 1>& CFIE,
+                         const blitz::Array<std::complex<double>, 2>& E_0,
+                         const blitz::Array<double, 2>& k_hat,
+                         const blitz::Array<double, 1>& r_ref,
+                         const blitz::Array<int, 1>& numbers_RWG_test,
+                         const blitz::Array<int, 1>& RWGNumber_CFIE_OK,
+                         const blitz::Array<float, 2>& RWGNumber_trianglesCoord,
+                         const double w,
+                         const std::complex<double>& eps_r,
+                         const std::complex<double>& mu_r,
+                         const int FULL_PRECISION,
+                         const int N_threads)
+{
+  // def of k, mu_i, eps_i
+  const int N_RWG_test = numbers_RWG_test.size(), N_excitations = E_0.extent(0);
+  std::complex<double> mu = mu_0 * mu_r, eps = eps_0 * eps_r, k = w * sqrt(eps*mu);
+
+  V_CFIE_planeThreadsData threadsData;
+  threadsData.V_CFIE = &V_CFIE;
+  threadsData.numbers_RWG_test = &numbers_RWG_test;
+  threadsData.RWGNumber_CFIE_OK = &RWGNumber_CFIE_OK;
+  threadsData.RWGNumber_trianglesCoord = &RWGNumber_trianglesCoord;
+  threadsData.k = k;
+  threadsData.tE = CFIE(0);
+  threadsData.nE = CFIE(1);
+  threadsData.tH = CFIE(2);
+  threadsData.nH = CFIE(3);
+  threadsData.N_points = (FULL_PRECISION!=0) ? 6 : 3;
+  IT_points (threadsData.xi, threadsData.eta, threadsData.weigths, threadsData.sum_weigths, threadsData.N_points);
+  // r_ref is the reference for the phase of the incoming plane waves
+  for (int i=0 ; i<3 ; ++i) threadsData.rRef[i] = r_ref(i);
+
+  // the excitations sharing a direction of incidence share its phase integrals
+  threadsData.N_excitations = N_excitations;
+  threadsData.N_directions = 0;
+  threadsData.directionOfExcitation.resize(N_excitations);
+  threadsData.E0.resize(3*N_excitations);
+  threadsData.H0.resize(3*N_excitations);
+  for (int e=0 ; e<N_excitations ; ++e) {
+    int d = 0;
+    while ( (d<threadsData.N_directions) && ((threadsData.kHat[3*d]!=k_hat(e, 0)) || (threadsData.kHat[3*d+1]!=k_hat(e, 1)) || (threadsData.kHat[3*d+2]!=k_hat(e, 2))) ) d++;
+    if (d==threadsData.N_directions) {
+      for (int i=0 ; i<3 ; ++i) threadsData.kHat.push_back(k_hat(e, i));
+      threadsData.N_directions++;
+    }
+    threadsData.directionOfExcitation[e] = d;
+    // computation of H_0
+    for (int i=0 ; i<3 ; ++i) threadsData.E0[3*e + i] = E_0(e, i);
+    threadsData.H0[3*e] = (k_hat(e, 1)*E_0(e, 2)-k_hat(e, 2)*E_0(e, 1)) * sqrt(eps/mu);
+    threadsData.H0[3*e + 1] = (k_hat(e, 2)*E_0(e, 0)-k_hat(e, 0)*E_0(e, 2)) * sqrt(eps/mu);
+    threadsData.H0[3*e + 2] = (k_hat(e, 0)*E_0(e, 1)-k_hat(e, 1)*E_0(e, 0)) * sqrt(eps/mu);
+  }
+
+  V_CFIE = 0.0;
+  if (N_excitations==0) return;
+  // each thread takes a contiguous range of RWGs, so that they write distinct columns of V_CFIE
+  const int N_thr = max(1, min(N_threads, N_RWG_test));
+  std::vector<V_CFIE_planeThreadsData> dataPerThread(N_thr, threadsData);
+  for (int t=0 ; t<N_thr ; ++t) {
+    dataPerThread[t].startRWG = (t * N_RWG_test)/N_thr;
+    dataPerThread[t].stopRWG = ((t+1) * N_RWG_test)/N_thr;
+  }
+  if (N_thr > 1) {
+    std::vector<pthread_t> threads(N_thr);
+    for (int t=0 ; t<N_thr ; ++t) {
+      if (pthread_create(&threads[t], 0, V_CFIE_plane_arrayThread, &dataPerThread[t]) != 0) {
+        std::cout << "V_CFIE_plane_array: could not create thread " << t << ". Exiting..." << std::endl;
+        exit(1);
+      }
+    }
+    for (int t=0 ; t<N_thr ; ++t) pthread_join(threads[t], 0);
+  }
+  else V_CFIE_plane_arrayThread(&dataPerThread[0]);
+}
+
+void local_V_CFIE_plane_array (blitz::Array<std::complex<float>, 2>& V_CFIE,
+                               const blitz::Array<std::complex<double>, 2>& E_0,
+                               const blitz::Array<double, 2>& k_hat,
+                               const blitz::Array<double, 1>& r_ref,
+                               const LocalMesh & local_target_mesh,
+                               const double w,
+                               const std::complex<double>& eps_r,
+                               const std::complex<double>& mu_r,
+                               const blitz::Array<std::complex<float>, 1>& CFIE,
+                               const int FULL_PRECISION,
+                               const int N_threads)
+{
+  // We now compute the excitation vectors, one row per excitation
+  V_CFIE.resize(E_0.extent(0), local_target_mesh.N_local_RWG);
+  V_CFIE_plane_array (V_CFIE, CFIE, E_0, k_hat, r_ref, local_target_mesh.reallyLocalRWGNumbers, local_target_mesh.localRWGNumber_CFIE_OK, local_target_mesh.localRWGNumber_trianglesCoord, w, eps_r, mu_r, FULL_PRECISION, N_threads);
+}
+
 // void V_E_V_H_horn_BBHA (Array<complex<double>,2>& V_EJ, Array<complex<double>,2>& V_HJ, Array<complex<double>,2>& V_EM, Array<complex<double>,2>& V_HM, const mesh & MESH_TARGET, const mesh & MESH_ANTENNA, const Vector<double,3>& r_ant, const Vector<double,3>& x_hat_ant, const Vector<double,3>& y_hat_ant, const G_EJ_grid & G_EJ_tab_ant_object, const G_HJ_grid & G_HJ_tab_ant_object, const layers_constants & LC, const G_EJ_grid & G_EJ_tab_ant_object_dual, const G_HJ_grid & G_HJ_tab_ant_object_dual, const layers_constants & LC_dual) {
 
 //   int i, j, N_TR_ANT = MESH_ANTENNA.triangles.rows(), E = MESH_TARGET.edges.rows()/2; 
@@ -1,7 +1,53 @@
 #ifndef Z_EJ_Z_HJ_H
 #define Z_EJ_Z_HJ_H
+#include <map>
+#include <complex>
+
 using namespace std;
 
+//! the triangle-to-triangle integrals that Z_CFIE_J_computation needs for one pair of triangles
+class NearFieldPairIntegrals {
+  public:
+    std::complex<double> ITo_ITs_G, ITo_r_dot_ITs_G_rprime, ITo_n_hat_X_r_dot_ITs_G_rprime, IDTo_l_hat_dot_r_ITs_G;
+    std::complex<double> ITo_n_hat_X_r_dot_r_X_ITs_grad_G;
+    std::complex<double> ITo_r_ITs_G[3], ITo_ITs_G_rprime[3], IDTo_l_hat_ITs_G[3];
+    std::complex<double> ITo_ITs_grad_G[3], ITo_r_X_ITs_grad_G[3], ITo_n_hat_X_r_X_ITs_grad_G[3];
+};
+
+//! the relative geometry of a triangle pair, quantized, plus the integration flags
+class NearFieldPairKey {
+  public:
+    long int coords[18];
+    int flags;
+    bool operator< (const NearFieldPairKey& other) const;
+};
+
+//! cache of near-field integrals, using the translational invariance of the Green's function
+/*!
+  The integrals of a pair of triangles are computed in a frame centred on the gravity
+  centre of the test triangle. Two pairs which are translated copies of each other
+  (up to "tolerance", in meters) hence share their integrals, which is the case
+  for the many repeated pairs of regular or periodic meshes.
+  A cache can be shared between calls of Z_CFIE_J_computation as long as
+  w, eps_r, mu_r and FULL_PRECISION do not change. It stops taking new pairs when it reaches maxSize pairs,
+  see maxSizeFromMemory for deriving maxSize from a memory budget.
+*/
+class NearFieldIntegralsCache {
+    double tolerance;
+    int maxSize;
+    long int N_hits, N_misses;
+    std::map<NearFieldPairKey, NearFieldPairIntegrals> pairs;
+  public:
+    NearFieldIntegralsCache(const double tol, const int max_size);
+    void computeKey(NearFieldPairKey& key, const double r_nodes_test[3][3], const double r_nodes_src[3][3], const double r_origin[3], const int flags) const;
+    bool find(const NearFieldPairKey& key, NearFieldPairIntegrals& integrals);
+    void insert(const NearFieldPairKey& key, const NearFieldPairIntegrals& integrals);
+    long int getN_hits(void) const {return N_hits;}
+    long int getN_misses(void) const {return N_misses;}
+    //! the number of pairs that fit in MAX_MB megabytes, std::map node overhead included
+    static int maxSizeFromMemory(const double MAX_MB) {return static_cast<int>(MAX_MB * 1024.0 * 1024.0 / (sizeof(NearFieldPairKey) + sizeof(NearFieldPairIntegrals) + 48));}
+};
+
 void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
                            blitz::Array<std::complex<double>, 2>& Z_CFIE_M,
                            const blitz::Array<std::complex<double>, 1>& CFIE,
@@ -19,7 +65,9 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
                            const std::complex<double>& mu_r,
                            const int TDS_APPROX, // do we compute for a surface impedance?
                            const std::complex<double>& Z_s, // surface impedance
-                           const int FULL_PRECISION);
+                           const int FULL_PRECISION,
+                           const double QUADRATURE_ACCURACY = 0.0, // if > 0, adaptive order for the non-touching pairs
+                           NearFieldIntegralsCache * nearFieldCache = 0); // optional, 0 means no cache
 
 void Z_EH_J_computation (blitz::Array<std::complex<double>, 2>& Z_tE_J,
                          blitz::Array<std::complex<double>, 2>& Z_nE_J,
@@ -10,6 +10,131 @@ using namespace std;
 #include "EMConstants.h"
 #include "triangle_int.h"
 #include "dictionary.h"
+#include "Z_EJ_Z_HJ.h"
+
+/****************************************************************************/
+/************************* NearFieldIntegralsCache **************************/
+/****************************************************************************/
+
+bool NearFieldPairKey::operator< (const NearFieldPairKey& other) const
+{
+  if (flags != other.flags) return (flags < other.flags);
+  return std::lexicographical_compare(coords, coords + 18, other.coords, other.coords + 18);
+}
+
+NearFieldIntegralsCache::NearFieldIntegralsCache(const double tol, const int max_size)
+{
+  tolerance = tol;
+  maxSize = max_size;
+  N_hits = 0;
+  N_misses = 0;
+}
+
+void NearFieldIntegralsCache::computeKey(NearFieldPairKey& key,
+                                         const double r_nodes_test[3][3],
+                                         const double r_nodes_src[3][3],
+                                         const double r_origin[3],
+                                         const int flags) const
+{
+  for (int i=0 ; i<3 ; ++i) {
+    for (int j=0 ; j<3 ; ++j) {
+      key.coords[3*i + j] = static_cast<long int>(floor((r_nodes_test[i][j] - r_origin[j])/tolerance + 0.5));
+      key.coords[9 + 3*i + j] = static_cast<long int>(floor((r_nodes_src[i][j] - r_origin[j])/tolerance + 0.5));
+    }
+  }
+  key.flags = flags;
+}
+
+bool NearFieldIntegralsCache::find(const NearFieldPairKey& key, NearFieldPairIntegrals& integrals)
+{
+  std::map<NearFieldPairKey, NearFieldPairIntegrals>::const_iterator itr = pairs.find(key);
+  if (itr == pairs.end()) {
+    N_misses++;
+    return false;
+  }
+  N_hits++;
+  integrals = itr->second;
+  return true;
+}
+
+void NearFieldIntegralsCache::insert(const NearFieldPairKey& key, const NearFieldPairIntegrals& integrals)
+{
+  // once full, the cache keeps its pairs and takes no more: emptying it would throw
+  // away the pairs that have been the most reused so far.
+  if (static_cast<int>(pairs.size()) < maxSize) pairs[key] = integrals;
+}
+
+//! returns a copy of T translated by -r_origin, without its RWGs
+Triangle translatedTriangle(const Triangle& T, const double r_origin[])
+{
+  double r0[3], r1[3], r2[3];
+  for (int i=0 ; i<3 ; ++i) {
+    r0[i] = T.r_nodes[0][i] - r_origin[i];
+    r1[i] = T.r_nodes[1][i] - r_origin[i];
+    r2[i] = T.r_nodes[2][i] - r_origin[i];
+  }
+  return Triangle(r0, r1, r2, T.number);
+}
+
+//! flattens the triangles-to-RWGs data of "triangles" in contiguous arrays
+/*!
+  The RWGs of triangle i are stored in triangle_RWGsIndexes, triangle_indexesInRWGs
+  and triangle_signsInRWGs from triangle_RWGsStart[i] to triangle_RWGsStart[i+1]-1.
+  This avoids copying the vectors of the triangles in the triangle-to-triangle loops.
+*/
+void flattenTrianglesRWGs(std::vector<int>& triangle_RWGsStart,
+                          std::vector<int>& triangle_RWGsIndexes,
+                          std::vector<int>& triangle_indexesInRWGs,
+                          std::vector<double>& triangle_signsInRWGs,
+                          const std::vector<Triangle>& triangles)
+{
+  const int N_triangles = triangles.size();
+  triangle_RWGsStart.resize(N_triangles + 1);
+  triangle_RWGsStart[0] = 0;
+  for (int i=0 ; i<N_triangles ; ++i) triangle_RWGsStart[i+1] = triangle_RWGsStart[i] + triangles[i].RWGIndexes.size();
+  const int N = triangle_RWGsStart[N_triangles];
+  triangle_RWGsIndexes.resize(N);
+  triangle_indexesInRWGs.resize(N);
+  triangle_signsInRWGs.resize(N);
+  for (int i=0 ; i<N_triangles ; ++i) {
+    for (unsigned int j=0 ; j<triangles[i].RWGIndexes.size() ; ++j) {
+      triangle_RWGsIndexes[triangle_RWGsStart[i] + j] = triangles[i].RWGIndexes[j];
+      triangle_indexesInRWGs[triangle_RWGsStart[i] + j] = triangles[i].indexesInRWGs[j];
+      triangle_signsInRWGs[triangle_RWGsStart[i] + j] = triangles[i].signInRWG[j];
+    }
+  }
+}
+
+//! the number of points of the triangle rule to use for a pair of non-touching triangles
+/*!
+  The relative error of a rule of degree p is estimated from the Taylor terms of order p+1
+  of the kernel over the pair: (c/ratio)^(p+1) for the 1/R part, with ratio = R_os/(R_max_test + R_max_src)
+  the distance-to-size ratio of the pair, and (c*kR)^(p+1)/(p+1)! for the phase exp(-jkR) over
+  the electrical size kR = |k|*(R_max_test + R_max_src). The constant c is calibrated on the fixed
+  rules: at accuracy = 1e-4 the 3 points rule is reached exactly at the near pairs limit
+  ratio = 1.5, so that the near pairs keep 6 points and the well-separated pairs of an
+  ordinary mesh (kR below 1) drop to 3. We return the smallest rule (3, 6, 9, 12 or 13 points)
+  satisfying the accuracy target.
+*/
+int adaptiveNumberOfPoints(const double distanceToSizeRatio, const double kR, const double accuracy)
+{
+  const int N_RULES = 5;
+  const int N_points[N_RULES] = {3, 6, 9, 12, 13};
+  const int degree[N_RULES] = {2, 4, 5, 6, 7};
+  const double NEAR_RATIO = 1.5, CALIBRATION_ACCURACY = 1.0e-4;
+  const double c = NEAR_RATIO * pow(CALIBRATION_ACCURACY, 1.0/(degree[0]+1));
+  for (int i=0 ; i<N_RULES ; ++i) {
+    double factorial = 1.0;
+    for (int n=2 ; n<=degree[i]+1 ; ++n) factorial *= n;
+    const double error = pow(c/distanceToSizeRatio, degree[i]+1) + pow(c*kR, degree[i]+1)/factorial;
+    if (error <= accuracy) return N_points[i];
+  }
+  return N_points[N_RULES-1];
+}
+
+/****************************************************************************/
+/************************** Z_CFIE_J_computation ****************************/
+/****************************************************************************/
 
 void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
                            blitz::Array<std::complex<double>, 2>& Z_CFIE_M,
@@ -28,7 +153,9 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
                            const std::complex<double>& mu_r,
                            const int TDS_APPROX, // do we compute for a surface impedance?
                            const std::complex<double>& Z_s, // surface impedance
-                           const int FULL_PRECISION)
+                           const int FULL_PRECISION,
+                           const double QUADRATURE_ACCURACY,
+                           NearFieldIntegralsCache * nearFieldCache)
 {
   const int N_RWG_src = numbers_RWG_src.size(), N_RWG_test = numbers_RWG_test.size();
   // half RWGs construction
@@ -87,6 +214,10 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
   std::vector<Triangle> triangles_src, triangles_test;
   constructVectorTriangles(triangles_src, src_RWGs, srcTriangleToRWG);
   constructVectorTriangles(triangles_test, test_RWGs, testTriangleToRWG);
+  std::vector<int> src_RWGsStart, src_RWGsIndexes, src_indexesInRWGs, test_RWGsStart, test_RWGsIndexes, test_indexesInRWGs;
+  std::vector<double> src_signsInRWGs, test_signsInRWGs;
+  flattenTrianglesRWGs(src_RWGsStart, src_RWGsIndexes, src_indexesInRWGs, src_signsInRWGs, triangles_src);
+  flattenTrianglesRWGs(test_RWGsStart, test_RWGsIndexes, test_indexesInRWGs, test_signsInRWGs, triangles_test);
 
   // Z_CFIE computation
   // def of k, mu_i, eps_i
@@ -96,25 +227,40 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
   const std::complex<double> mu = mu_0 * mu_r, eps = eps_0 * eps_r, k = w * sqrt(eps*mu), k_square = k*k;
   const std::complex<double> z_pq_factor = 1.0/(I*w*eps);
 
+  // with a near-field cache, all the computations of a test triangle are made
+  // in a frame centred on its gravity centre, so that the integrals only depend
+  // on the relative geometry of the triangles pair
+  const bool USE_CACHE = (nearFieldCache != 0);
+  NearFieldPairKey pairKey;
+
   Z_CFIE_J = 0.0; Z_CFIE_M = 0.0;
   for (unsigned int r=0 ; r<triangles_test.size() ; ++r) { // loop on the observation RWGs
+    double r_origin[3] = {0.0, 0.0, 0.0};
+    Triangle triangleTestTranslated;
+    if (USE_CACHE) {
+      for (int i=0 ; i<3 ; ++i) r_origin[i] = triangles_test[r].r_grav[i];
+      triangleTestTranslated = translatedTriangle(triangles_test[r], r_origin);
+    }
+    const Triangle & triangleTest = (USE_CACHE) ? triangleTestTranslated : triangles_test[r];
     // computation of the triangle-to-triangle terms
-    double *n_hat;
-    n_hat = triangles_test[r].n_hat;
+    const double *n_hat;
+    n_hat = triangleTest.n_hat;
     double IT_r_square; // n_hat_X_r_p_dot_IT_r;
     double IT_r[3], IT_n_hat_X_r[3];
-    IT_fm_fn (IT_r_square, IT_r, triangles_test[r]); // serves for <f_m ; f_n> and <f_m ; n x f_n>
+    IT_fm_fn (IT_r_square, IT_r, triangleTest); // serves for <f_m ; f_n> and <f_m ; n x f_n>
     cross3D(IT_n_hat_X_r, n_hat, IT_r); // serves for <f_m ; n x f_n>
     // the RWGs concerned by the test triangle
-    std::vector<int> RWGsIndexes_test(triangles_test[r].RWGIndexes);
-    std::vector<int> triangleTest_indexesInRWGs(triangles_test[r].indexesInRWGs);
-    std::vector<double> triangleTest_signsInRWGs(triangles_test[r].signInRWG);
+    const int N_RWGs_test = test_RWGsStart[r+1] - test_RWGsStart[r];
+    const int *RWGsIndexes_test = &test_RWGsIndexes[test_RWGsStart[r]];
+    const int *triangleTest_indexesInRWGs = &test_indexesInRWGs[test_RWGsStart[r]];
+    const double *triangleTest_signsInRWGs = &test_signsInRWGs[test_RWGsStart[r]];
     // we now start the loop on the src triangles
     for (unsigned int s=0 ; s<triangles_src.size() ; ++s) { // loop on the source RWGs
       // the RWGs concerned by the source triangle
-      std::vector<int> RWGsIndexes_src(triangles_src[s].RWGIndexes);
-      std::vector<int> triangleSrc_indexesInRWGs(triangles_src[s].indexesInRWGs);
-      std::vector<double> triangleSrc_signsInRWGs(triangles_src[s].signInRWG);
+      const int N_RWGs_src = src_RWGsStart[s+1] - src_RWGsStart[s];
+      const int *RWGsIndexes_src = &src_RWGsIndexes[src_RWGsStart[s]];
+      const int *triangleSrc_indexesInRWGs = &src_indexesInRWGs[src_RWGsStart[s]];
+      const double *triangleSrc_signsInRWGs = &src_signsInRWGs[src_RWGsStart[s]];
 
       double r_grav_obs_r_grav_src[3] = {triangles_test[r].r_grav[0] - triangles_src[s].r_grav[0], triangles_test[r].r_grav[1] - triangles_src[s].r_grav[1], triangles_test[r].r_grav[2] - triangles_src[s].r_grav[2]};
       double R_os = sqrt(dot3D(r_grav_obs_r_grav_src, r_grav_obs_r_grav_src));
@@ -146,31 +292,55 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
           EXTRACT_1_R = (EXTRACT_R = 0); N_points_o = (N_points_s = 6);
         }
       }
+      // the order of the non-touching pairs can be chosen from their distance-to-size ratio
+      if ((QUADRATURE_ACCURACY > 0.0) && (!IS_SAME_TR) && (!IS_TOUCH)) {
+        const double R_pair = triangles_test[r].R_max + triangles_src[s].R_max;
+        N_points_o = (N_points_s = adaptiveNumberOfPoints(R_os/R_pair, abs(k) * R_pair, QUADRATURE_ACCURACY));
+      }
 
       // declaration of the scalars and vectors needed in the integrations
-      std::complex<double> ITo_ITs_G, ITo_r_dot_ITs_G_rprime, ITo_n_hat_X_r_dot_ITs_G_rprime, IDTo_l_hat_dot_r_ITs_G;
-      std::complex<double> ITo_n_hat_X_r_dot_r_X_ITs_grad_G;
-      std::complex<double> ITo_r_ITs_G[3], ITo_ITs_G_rprime[3], IDTo_l_hat_ITs_G[3];
-      std::complex<double> ITo_ITs_grad_G[3], ITo_r_X_ITs_grad_G[3], ITo_n_hat_X_r_X_ITs_grad_G[3];
-
-      ITo_ITs_free (ITo_ITs_G, ITo_r_ITs_G, ITo_ITs_G_rprime, ITo_r_dot_ITs_G_rprime, ITo_n_hat_X_r_dot_ITs_G_rprime, ITo_ITs_grad_G, ITo_r_X_ITs_grad_G, ITo_n_hat_X_r_dot_r_X_ITs_grad_G, ITo_n_hat_X_r_X_ITs_grad_G, triangles_test[r], triangles_src[s], k, N_points_o, N_points_s, EXTRACT_1_R, EXTRACT_R);
+      NearFieldPairIntegrals pairIntegrals;
+      std::complex<double> & ITo_ITs_G = pairIntegrals.ITo_ITs_G, & ITo_r_dot_ITs_G_rprime = pairIntegrals.ITo_r_dot_ITs_G_rprime, & ITo_n_hat_X_r_dot_ITs_G_rprime = pairIntegrals.ITo_n_hat_X_r_dot_ITs_G_rprime, & IDTo_l_hat_dot_r_ITs_G = pairIntegrals.IDTo_l_hat_dot_r_ITs_G;
+      std::complex<double> & ITo_n_hat_X_r_dot_r_X_ITs_grad_G = pairIntegrals.ITo_n_hat_X_r_dot_r_X_ITs_grad_G;
+      std::complex<double> *ITo_r_ITs_G = pairIntegrals.ITo_r_ITs_G, *ITo_ITs_G_rprime = pairIntegrals.ITo_ITs_G_rprime, *IDTo_l_hat_ITs_G = pairIntegrals.IDTo_l_hat_ITs_G;
+      std::complex<double> *ITo_ITs_grad_G = pairIntegrals.ITo_ITs_grad_G, *ITo_r_X_ITs_grad_G = pairIntegrals.ITo_r_X_ITs_grad_G, *ITo_n_hat_X_r_X_ITs_grad_G = pairIntegrals.ITo_n_hat_X_r_X_ITs_grad_G;
+      const bool COMPUTE_IDTo = ((IS_TOUCH) && (nE_tmp || nH_tmp));
+
+      bool IS_CACHED = false;
+      if (USE_CACHE) {
+        const int flags = IS_SAME_TR + 2 * COMPUTE_IDTo + 4 * EXTRACT_1_R + 8 * EXTRACT_R + 16 * N_points_o + 16 * 64 * N_points_s;
+        nearFieldCache->computeKey(pairKey, triangles_test[r].r_nodes, triangles_src[s].r_nodes, r_origin, flags);
+        IS_CACHED = nearFieldCache->find(pairKey, pairIntegrals);
+      }
+      if (!IS_CACHED) {
+        if (USE_CACHE) {
+          const Triangle triangleSrcTranslated(translatedTriangle(triangles_src[s], r_origin));
+          ITo_ITs_free (ITo_ITs_G, ITo_r_ITs_G, ITo_ITs_G_rprime, ITo_r_dot_ITs_G_rprime, ITo_n_hat_X_r_dot_ITs_G_rprime, ITo_ITs_grad_G, ITo_r_X_ITs_grad_G, ITo_n_hat_X_r_dot_r_X_ITs_grad_G, ITo_n_hat_X_r_X_ITs_grad_G, triangleTest, triangleSrcTranslated, k, N_points_o, N_points_s, EXTRACT_1_R, EXTRACT_R);
+          if (COMPUTE_IDTo) IDTo_ITs_free(IDTo_l_hat_dot_r_ITs_G, IDTo_l_hat_ITs_G, triangleTest, triangleSrcTranslated, k, 3, N_points_s, EXTRACT_1_R, EXTRACT_R);
+          nearFieldCache->insert(pairKey, pairIntegrals);
+        }
+        else {
+          ITo_ITs_free (ITo_ITs_G, ITo_r_ITs_G, ITo_ITs_G_rprime, ITo_r_dot_ITs_G_rprime, ITo_n_hat_X_r_dot_ITs_G_rprime, ITo_ITs_grad_G, ITo_r_X_ITs_grad_G, ITo_n_hat_X_r_dot_r_X_ITs_grad_G, ITo_n_hat_X_r_X_ITs_grad_G, triangles_test[r], triangles_src[s], k, N_points_o, N_points_s, EXTRACT_1_R, EXTRACT_R);
+          if (COMPUTE_IDTo) IDTo_ITs_free(IDTo_l_hat_dot_r_ITs_G, IDTo_l_hat_ITs_G, triangles_test[r], triangles_src[s], k, 3, N_points_s, EXTRACT_1_R, EXTRACT_R);
+        }
+      }
 
       const std::complex<double> ITo_n_hat_X_r_ITs_G[3] = {n_hat[1]*ITo_r_ITs_G[2] - n_hat[2]*ITo_r_ITs_G[1],
                                                            n_hat[2]*ITo_r_ITs_G[0] - n_hat[0]*ITo_r_ITs_G[2],
                                                            n_hat[0]*ITo_r_ITs_G[1] - n_hat[1]*ITo_r_ITs_G[0]};
       const std::complex<double> n_hat_dot_ITo_r_X_ITs_grad_G(n_hat[0]*ITo_r_X_ITs_grad_G[0] + n_hat[1]*ITo_r_X_ITs_grad_G[1] + n_hat[2]*ITo_r_X_ITs_grad_G[2]);
 
-      if ((IS_TOUCH) && (nE_tmp || nH_tmp)) IDTo_ITs_free(IDTo_l_hat_dot_r_ITs_G, IDTo_l_hat_ITs_G, triangles_test[r], triangles_src[s], k, 3, N_points_s, EXTRACT_1_R, EXTRACT_R);
-
-      for (unsigned int p=0 ; p<RWGsIndexes_test.size() ; ++p) {
+      for (int p=0 ; p<N_RWGs_test ; ++p) {
         const int index_p = RWGsIndexes_test[p];
         const int local_number_edge_p = test_RWGs[index_p].number;
         const double l_p = test_RWGs[index_p].length;
         const double sign_edge_p = triangleTest_signsInRWGs[p];
         const double C_p = sign_edge_p * l_p * 0.5/triangles_test[r].A;
-        double *r_p, n_hat_X_r_p[3];
-        if (triangleTest_indexesInRWGs[p]==0) r_p = test_RWGs[index_p].vertexesCoord_0;
-        else r_p = test_RWGs[index_p].vertexesCoord_3;
+        double r_p[3], n_hat_X_r_p[3];
+        const double *r_p_abs;
+        if (triangleTest_indexesInRWGs[p]==0) r_p_abs = test_RWGs[index_p].vertexesCoord_0;
+        else r_p_abs = test_RWGs[index_p].vertexesCoord_3;
+        for (int i=0 ; i<3 ; ++i) r_p[i] = r_p_abs[i] - r_origin[i];
         cross3D(n_hat_X_r_p, n_hat, r_p);
         const int IS_CFIE = testRWGNumber_CFIE_OK(local_number_edge_p);
         const bool tEJ = tE_tmp, nEJ = nE_tmp, tHJ = (tH_tmp * IS_CFIE ), nHJ = (nH_tmp * IS_CFIE);
@@ -200,15 +370,17 @@ void Z_CFIE_J_computation (blitz::Array<std::complex<double>, 2>& Z_CFIE_J,
                                                                        ITo_n_hat_X_r_X_ITs_grad_G[2] - n_hat_X_r_p_X_ITo_ITs_grad_G[2]};
         const std::complex<double> n_hat_X_r_p_dot_ITo_r_X_ITs_grad_G(n_hat_X_r_p[0]*ITo_r_X_ITs_grad_G[0] + n_hat_X_r_p[1]*ITo_r_X_ITs_grad_G[1] + n_hat_X_r_p[2]*ITo_r_X_ITs_grad_G[2]);
 
-        for (unsigned int q=0 ; q<RWGsIndexes_src.size() ; ++q) {
+        for (int q=0 ; q<N_RWGs_src ; ++q) {
           const int index_q = RWGsIndexes_src[q];
           const int local_number_edge_q = src_RWGs[index_q].number;
           const double l_q = src_RWGs[index_q].length;
           const double sign_edge_q = triangleSrc_signsInRWGs[q];
           const double C_pq = C_p * sign_edge_q * l_q * 0.5/triangles_src[s].A;
-          double *r_q;
-          if (triangleSrc_indexesInRWGs[q]==0) r_q = src_RWGs[index_q].vertexesCoord_0;
-          else r_q = src_RWGs[index_q].vertexesCoord_3;
+          double r_q[3];
+          const double *r_q_abs;
+          if (triangleSrc_indexesInRWGs[q]==0) r_q_abs = src_RWGs[index_q].vertexesCoord_0;
+          else r_q_abs = src_RWGs[index_q].vertexesCoord_3;
+          for (int i=0 ; i<3 ; ++i) r_q[i] = r_q_abs[i] - r_origin[i];
           const bool M_CURRENT_OK = (srcRWGNumber_CURRENT_M_OK(local_number_edge_q)==1);
           const bool tHM = (tH_tmp && M_CURRENT_OK), nHM = (nH_tmp && M_CURRENT_OK), tEM = (tE_tmp && M_CURRENT_OK), nEM = (nE_tmp && M_CURRENT_OK);
           const double rp_dot_rq(r_p[0]*r_q[0] + r_p[1]*r_q[1] + r_p[2]*r_q[2]);
@@ -335,6 +507,10 @@ void Z_EH_J_computation (blitz::Array<std::complex<double>, 2>& Z_tE_J,
   std::vector<Triangle> triangles_src, triangles_test;
   constructVectorTriangles(triangles_src, src_RWGs, srcTriangleToRWG);
   constructVectorTriangles(triangles_test, test_RWGs, testTriangleToRWG);
+  std::vector<int> src_RWGsStart, src_RWGsIndexes, src_indexesInRWGs, test_RWGsStart, test_RWGsIndexes, test_indexesInRWGs;
+  std::vector<double> src_signsInRWGs, test_signsInRWGs;
+  flattenTrianglesRWGs(src_RWGsStart, src_RWGsIndexes, src_indexesInRWGs, src_signsInRWGs, triangles_src);
+  flattenTrianglesRWGs(test_RWGsStart, test_RWGsIndexes, test_indexesInRWGs, test_signsInRWGs, triangles_test);
 
   // Z_CFIE computation
   // def of k, mu_i, eps_i
@@ -355,15 +531,17 @@ void Z_EH_J_computation (blitz::Array<std::complex<double>, 2>& Z_tE_J,
     IT_fm_fn (IT_r_square, IT_r, triangles_test[r]); // serves for <f_m ; f_n> and <f_m ; n x f_n>
     cross3D(IT_n_hat_X_r, n_hat, IT_r); // serves for <f_m ; n x f_n>
     // the RWGs concerned by the test triangle
-    std::vector<int> RWGsIndexes_test(triangles_test[r].RWGIndexes);
-    std::vector<int> triangleTest_indexesInRWGs(triangles_test[r].indexesInRWGs);
-    std::vector<double> triangleTest_signsInRWGs(triangles_test[r].signInRWG);
+    const int N_RWGs_test = test_RWGsStart[r+1] - test_RWGsStart[r];
+    const int *RWGsIndexes_test = &test_RWGsIndexes[test_RWGsStart[r]];
+    const int *triangleTest_indexesInRWGs = &test_indexesInRWGs[test_RWGsStart[r]];
+    const double *triangleTest_signsInRWGs = &test_signsInRWGs[test_RWGsStart[r]];
     // we now start the loop on the src triangles
     for (unsigned int s=0 ; s<triangles_src.size() ; ++s) { // loop on the source RWGs
       // the RWGs concerned by the source triangle
-      std::vector<int> RWGsIndexes_src(triangles_src[s].RWGIndexes);
-      std::vector<int> triangleSrc_indexesInRWGs(triangles_src[s].indexesInRWGs);
-      std::vector<double> triangleSrc_signsInRWGs(triangles_src[s].signInRWG);
+      const int N_RWGs_src = src_RWGsStart[s+1] - src_RWGsStart[s];
+      const int *RWGsIndexes_src = &src_RWGsIndexes[src_RWGsStart[s]];
+      const int *triangleSrc_indexesInRWGs = &src_indexesInRWGs[src_RWGsStart[s]];
+      const double *triangleSrc_signsInRWGs = &src_signsInRWGs[src_RWGsStart[s]];
 
       double r_grav_obs_r_grav_src[3] = {triangles_test[r].r_grav[0] - triangles_src[s].r_grav[0], triangles_test[r].r_grav[1] - triangles_src[s].r_grav[1], triangles_test[r].r_grav[2] - triangles_src[s].r_grav[2]};
       double R_os = sqrt(dot3D(r_grav_obs_r_grav_src, r_grav_obs_r_grav_src));
@@ -411,7 +589,7 @@ void Z_EH_J_computation (blitz::Array<std::complex<double>, 2>& Z_tE_J,
 
       if ((IS_TOUCH) && (nE_tmp || nH_tmp)) IDTo_ITs_free(IDTo_l_hat_dot_r_ITs_G, IDTo_l_hat_ITs_G, triangles_test[r], triangles_src[s], k, 3, N_points_s, EXTRACT_1_R, EXTRACT_R);
 
-      for (unsigned int p=0 ; p<RWGsIndexes_test.size() ; ++p) {
+      for (int p=0 ; p<N_RWGs_test ; ++p) {
         const int index_p = RWGsIndexes_test[p];
         const int local_number_edge_p = test_RWGs[index_p].number;
         const double l_p = test_RWGs[index_p].length;
@@ -449,7 +627,7 @@ void Z_EH_J_computation (blitz::Array<std::complex<double>, 2>& Z_tE_J,
                                                                        ITo_n_hat_X_r_X_ITs_grad_G[2] - n_hat_X_r_p_X_ITo_ITs_grad_G[2]};
         const std::complex<double> n_hat_X_r_p_dot_ITo_r_X_ITs_grad_G(n_hat_X_r_p[0]*ITo_r_X_ITs_grad_G[0] + n_hat_X_r_p[1]*ITo_r_X_ITs_grad_G[1] + n_hat_X_r_p[2]*ITo_r_X_ITs_grad_G[2]);
 
-        for (unsigned int q=0 ; q<RWGsIndexes_src.size() ; ++q) {
+        for (int q=0 ; q<N_RWGs_src ; ++q) {
           const int index_q = RWGsIndexes_src[q];
           const int local_number_edge_q = src_RWGs[index_q].number;
           const double l_q = src_RWGs[index_q].length;
@@ -2,6 +2,7 @@
 #define Z_SPARSE_MLFMA_H
 
 #include <complex>
+#include <vector>
 
 using namespace std;
 
@@ -15,6 +16,8 @@ class Z_sparse_MLFMA {
     blitz::Array<int, 1> src_RWG_numbers;
     blitz::Array<int, 2> rowIndexToColumnIndexes;
     blitz::Array<std::complex<float>, 1> Z_CFIE_near;
+    // scratch row of the block matvec, kept between calls
+    blitz::Array<std::complex<float>, 1> zi_block;
   public:
     // constructors
     Z_sparse_MLFMA(void);
@@ -52,6 +55,8 @@ class Z_sparse_MLFMA {
     void printZ_CFIE_near(void) {blitz::cout << "Z_CFIE_near = " << Z_CFIE_near << endl;}
     void matvec_Z_PQ_near(blitz::Array<std::complex<float>, 1>& /*ZI_PQ*/,
                           const blitz::Array<std::complex<float>, 1>& /*I_PQ*/);
+    void matvec_Z_PQ_near(blitz::Array<std::complex<float>, 2>& /*ZI_PQ*/,
+                          const blitz::Array<std::complex<float>, 2>& /*I_PQ*/);
 };
 
 Z_sparse_MLFMA::Z_sparse_MLFMA(void){}
@@ -96,6 +101,7 @@ Z_sparse_MLFMA::~Z_sparse_MLFMA() {
   src_RWG_numbers.free();
   rowIndexToColumnIndexes.free();
   Z_CFIE_near.free();
+  zi_block.free();
 }
 
 void Z_sparse_MLFMA::setZ_sparse_MLFMAFromFile(const string path, const string Z_name, const int chunkNumber)
@@ -185,4 +191,31 @@ void Z_sparse_MLFMA::matvec_Z_PQ_near(blitz::Array<std::complex<float>, 1>& ZI_P
   }
 }
 
+void Z_sparse_MLFMA::matvec_Z_PQ_near(blitz::Array<std::complex<float>, 2>& ZI_PQ,
+                                      const blitz::Array<std::complex<float>, 2>& I_PQ)
+/**
+ * matrix-vector multiplication for a block of K vectors, ZI_PQ(:, l) += Z * I_PQ(:, l).
+ * The K values of a given RWG are contiguous, so that each element of Z_CFIE_near is
+ * read once and applied to all the columns.
+ */
+{
+  const int K = I_PQ.extent(1);
+  if (zi_block.size()!=K) zi_block.resize(K);
+  std::complex<float> * zi = zi_block.data();
+  int indexInZ_CFIE = 0;
+  for (int i=0 ; i<N_test_RWG ; i++) {
+    const int test_RWG_number = test_RWG_numbers(i);
+    const int startIndexInSrcRWG_numbers = rowIndexToColumnIndexes(i, 0);
+    const int stopIndexInSrc_RWG_numbers = rowIndexToColumnIndexes(i, 1);
+    for (int l=0 ; l<K ; l++) zi[l] = 0.0;
+    for (int j=startIndexInSrcRWG_numbers ; j<stopIndexInSrc_RWG_numbers ; j++) {
+      const std::complex<float> z = Z_CFIE_near(indexInZ_CFIE);
+      const int src_RWG_number = src_RWG_numbers(j);
+      for (int l=0 ; l<K ; l++) zi[l] += z * I_PQ(src_RWG_number, l);
+      indexInZ_CFIE++;
+    }
+    for (int l=0 ; l<K ; l++) ZI_PQ(test_RWG_number, l) += zi[l];
+  }
+}
+
 #endif
@@ -6,7 +6,8 @@
 #include <blitz/array.h>
 #include <mpi.h>
 #include <map>
-#include <set>
+#include <algorithm>
+#include <pthread.h>
 
 using namespace std;
 
@@ -21,6 +22,8 @@ class CubeArrays {
     int N_RWG_src;
     int N_neighbors;
     std::vector<int> testSrc_RWGsNumbers;
+    //! the RWG numbers renumbered within the chunk, see computeChunkLocalRWGNumbers
+    std::vector<int> testSrc_RWGsLocalNumbers;
     std::vector<int> isEdgeInCartesianRadius;
     std::vector<int> neighborsIndexes;
     blitz::Array<std::complex<float>, 2> Z_CFIE_J;
@@ -82,6 +85,7 @@ void CubeArrays::copyCubeArrays(const CubeArrays& cubeArraysToCopy) // copy memb
   N_neighbors = cubeArraysToCopy.N_neighbors;
   testSrc_RWGsNumbers.resize(cubeArraysToCopy.testSrc_RWGsNumbers.size());
   testSrc_RWGsNumbers = cubeArraysToCopy.testSrc_RWGsNumbers;
+  testSrc_RWGsLocalNumbers = cubeArraysToCopy.testSrc_RWGsLocalNumbers;
   isEdgeInCartesianRadius.resize(cubeArraysToCopy.isEdgeInCartesianRadius.size());
   isEdgeInCartesianRadius = cubeArraysToCopy.isEdgeInCartesianRadius;
   neighborsIndexes.resize(cubeArraysToCopy.neighborsIndexes.size());
@@ -102,6 +106,7 @@ CubeArrays& CubeArrays::operator=(const CubeArrays& cubeArraysToCopy) { // copy
 
 CubeArrays::~CubeArrays() {
   testSrc_RWGsNumbers.clear();
+  testSrc_RWGsLocalNumbers.clear();
   isEdgeInCartesianRadius.clear();
   neighborsIndexes.clear();
   Z_CFIE_J.free();
@@ -110,6 +115,29 @@ CubeArrays::~CubeArrays() {
 typedef std::map<int, CubeArrays> CubeArraysMap;
 typedef std::map<int, CubeArrays>::const_iterator CubeArraysMapIterator;
 
+//! renumbers the RWGs of the cubes of ListCubes from 0 to N-1 and returns N
+/*!
+  The per-thread lookup tables of SAIWorkspace are indexed by these numbers, so that their
+  size is that of the chunk and its neighbors and not that of the whole mesh.
+*/
+int computeChunkLocalRWGNumbers(CubeArraysMap & ListCubes)
+{
+  std::vector<int> RWGsNumbers;
+  for (CubeArraysMap::iterator it = ListCubes.begin(); it != ListCubes.end(); ++it) {
+    RWGsNumbers.insert(RWGsNumbers.end(), (*it).second.testSrc_RWGsNumbers.begin(), (*it).second.testSrc_RWGsNumbers.end());
+  }
+  sort(RWGsNumbers.begin(), RWGsNumbers.end());
+  RWGsNumbers.erase(unique(RWGsNumbers.begin(), RWGsNumbers.end()), RWGsNumbers.end());
+  for (CubeArraysMap::iterator it = ListCubes.begin(); it != ListCubes.end(); ++it) {
+    CubeArrays & cube = (*it).second;
+    cube.testSrc_RWGsLocalNumbers.resize(cube.testSrc_RWGsNumbers.size());
+    for (unsigned int kk=0; kk<cube.testSrc_RWGsNumbers.size(); kk++) {
+      cube.testSrc_RWGsLocalNumbers[kk] = lower_bound(RWGsNumbers.begin(), RWGsNumbers.end(), cube.testSrc_RWGsNumbers[kk]) - RWGsNumbers.begin();
+    }
+  }
+  return RWGsNumbers.size();
+}
+
 
 void computeLwork(int & lwork, const int M, const int N, const int nrhs) {
   // computes the space necessary for WORK to.....work!!
@@ -122,136 +150,280 @@ void computeLwork(int & lwork, const int M, const int N, const int nrhs) {
   lwork = max( 1, mn + max( mn, nrhs )*NB );
 }
 
-void computeMyPinvCC(blitz::Array<std::complex<double>, 2>& Y, blitz::Array<std::complex<double>, 1>& A, int m, int n) {
-  /* this routine computes the pseudo inverse of A
+//! the work buffers of a thread, allocated once and reused for all its cubes
+class SAIWorkspace {
+  public:
+    //! chunk-local RWG number -> local (source) index in the current cube, -1 if absent
+    std::vector<int> RWG_to_localIndex;
+    //! chunk-local RWG number -> 1 if it is a test RWG of a common neighbor, 0 otherwise
+    std::vector<int> isCommonNeighborEdge;
+    //! local index -> line index in the reduced local matrix, -1 if not in the cartesian radius
+    std::vector<int> localIndex_to_line;
+    std::vector<int> sortedNeighborsIndexes;
+    std::vector<int> Z_local_lines_indexes, Z_local_columns_indexes, src_tmp, columnsOfNeighborCubeToBeConsidered;
+    //! the reduced local matrix (column major), the right hand side and the work array of zgels
+    blitz::Array<std::complex<double>, 1> A, B, work;
+    SAIWorkspace(const int N_RWG_local) : RWG_to_localIndex(N_RWG_local, -1), isCommonNeighborEdge(N_RWG_local, 0) {};
+};
+
+//! the arrays have to be large enough, but are only reallocated if they have to grow
+void growBuffer(blitz::Array<std::complex<double>, 1>& X, const int N)
+{
+  if (X.size() < N) X.resize(N);
+}
+
+int computeMyPinvCC(int & ldY, SAIWorkspace & ws, int m, int n) {
+  /* this routine computes the pseudo inverse of ws.A, of dimension (m, n),
   and is a wrapper to the fortran function zgels.f
   By the way, to understand this wrapping structure, you
-  better check the comments at the beginning of zgels.f */
+  better check the comments at the beginning of zgels.f.
+  On exit, the element (i, j) of the pseudo inverse is ws.B(i + j*ldY) */
   int lda = m;
   int ldb = max(n, m);
   int nrhs = m;
   const int N = min(ldb, nrhs);
-  blitz::Array<std::complex<double>, 1> B(ldb * nrhs); // B(ldb, nrhs)
-  B = 0.0;
-  for (int i=0 ; i<N ; i++) B(i + i*ldb) = 1.0;
+  growBuffer(ws.B, ldb * nrhs); // B(ldb, nrhs)
+  for (int i=0 ; i<ldb * nrhs ; i++) ws.B(i) = 0.0;
+  for (int i=0 ; i<N ; i++) ws.B(i + i*ldb) = 1.0;
   int lwork;
   computeLwork(lwork, m, n, nrhs);
-  blitz::Array<std::complex<double>, 1> work(lwork);
-  work = 0.0;
+  growBuffer(ws.work, lwork);
   int info = 0;
   char trans = 'N';
-  zgels2(trans, m, n, nrhs, A, lda, B, ldb, work, lwork, info);
-  if (info==0) {
-    if (m<=n) {
-      Y.resize(ldb, nrhs);
-      for (int j=0; j<nrhs; j++) {
-        for (int i=0; i<ldb; i++) Y(i, j) = B(i + j*ldb);
-      }
-    }
-    else {
-      Y.resize(n, nrhs);
-      for (int i=0; i<n; i++) {
-        for (int j=0; j<nrhs; j++) Y(i, j) = B(i + j*n);
-      }
-    }
+  // workspace query: an optimised lapack may want larger blocks than our estimate
+  int lwork_query = -1;
+  zgels2(trans, m, n, nrhs, ws.A, lda, ws.B, ldb, ws.work, lwork_query, info);
+  if ((info==0) && (static_cast<int>(ws.work(0).real()) > lwork)) {
+    lwork = static_cast<int>(ws.work(0).real());
+    growBuffer(ws.work, lwork);
   }
+  zgels2(trans, m, n, nrhs, ws.A, lda, ws.B, ldb, ws.work, lwork, info);
+  ldY = (m<=n) ? ldb : n;
+  return info;
 }
 
-void MgPreconditionerComputationPerCube(blitz::Array<std::complex<float>, 1>& Mg_tmp,
-                                        blitz::Array<int, 1>& src_edges_numbers_2,
+//! computes the SAI rows of cube "cubeNumber" in Mg_cube and the corresponding source RWGs in src_edges_numbers_2
+/*!
+  Mg_cube and src_edges_numbers_2 point to the preallocated places of the cube in the chunk arrays.
+  Only the workspace is written to besides them, so that different cubes can be computed concurrently.
+*/
+void MgPreconditionerComputationPerCube(std::complex<float> * Mg_cube,
+                                        int * src_edges_numbers_2,
+                                        SAIWorkspace & ws,
                                         const int cubeNumber,
                                         const CubeArraysMap & ListCubes)
 {
   CubeArraysMapIterator it = ListCubes.find(cubeNumber);
-  blitz::Array<std::complex<float>, 2> Z_local((*it).second.N_RWG_src, (*it).second.N_RWG_src);
-  Z_local = std::complex<float>(0.0, 0.0);
-  for (int i=0; i<(*it).second.N_RWG_src; i++) Z_local(i, i) = std::complex<float>(1.0, 0.0);
-
-  std::map<int, int> src_edges_numbers_local_src_edges_numbers;
-  for (int index = 0; index<(*it).second.N_RWG_src; index++) {
-    const int RWG_number = (*it).second.testSrc_RWGsNumbers[index];
-    src_edges_numbers_local_src_edges_numbers[RWG_number] = index;
+  const CubeArrays & cube = (*it).second;
+  const int N_RWG_src = cube.N_RWG_src;
+
+  // the local indexes and the lines of the reduced matrix
+  if (static_cast<int>(ws.localIndex_to_line.size()) < N_RWG_src) ws.localIndex_to_line.resize(N_RWG_src);
+  int N_lines = 0;
+  for (int index = 0; index<N_RWG_src; index++) {
+    ws.RWG_to_localIndex[cube.testSrc_RWGsLocalNumbers[index]] = index;
+    ws.localIndex_to_line[index] = (cube.isEdgeInCartesianRadius[index]==1) ? N_lines++ : -1;
   }
-  std::set<int> set_cubeNeighborsIndexes((*it).second.neighborsIndexes.begin(), (*it).second.neighborsIndexes.end());
+  // the reduced local matrix is directly assembled, in column major order, from the lines of Z_local in the radius.
+  // Z_local is the identity where it is not given by the Z_near blocks
+  growBuffer(ws.A, N_lines * N_RWG_src);
+  for (int i=0; i<N_lines * N_RWG_src; i++) ws.A(i) = 0.0;
+  for (int i=0; i<N_RWG_src; i++) {
+    if (ws.localIndex_to_line[i] >= 0) ws.A(ws.localIndex_to_line[i] + i*N_lines) = 1.0;
+  }
+  ws.sortedNeighborsIndexes.assign(cube.neighborsIndexes.begin(), cube.neighborsIndexes.end());
+  sort(ws.sortedNeighborsIndexes.begin(), ws.sortedNeighborsIndexes.end());
 
-  for (int index=0; index<(*it).second.N_neighbors; index++) {
-    const int neighborCubeNumber = (*it).second.neighborsIndexes[index];
-    CubeArraysMapIterator it_neighbor = ListCubes.find(neighborCubeNumber);
+  for (int index=0; index<cube.N_neighbors; index++) {
+    const int neighborCubeNumber = cube.neighborsIndexes[index];
     // we first fill in the first lines of Z_local
     if (index==0) {
-      for (int i=0; i<(*it).second.N_RWG_test; i++) {
-        for (int j=0; j<(*it).second.N_RWG_src; j++) Z_local(i, j) = (*it).second.Z_CFIE_J(i, j);
+      for (int i=0; i<cube.N_RWG_test; i++) {
+        const int line = ws.localIndex_to_line[i];
+        if (line < 0) continue;
+        for (int j=0; j<N_RWG_src; j++) ws.A(line + j*N_lines) = cube.Z_CFIE_J(i, j);
       }
     }
     // we then fill in the remaining lines
     else {
+      const CubeArrays & neighbor = (*ListCubes.find(neighborCubeNumber)).second;
       // first we find the line indexes
-      std::vector<int> Z_local_lines_indexes;
-      Z_local_lines_indexes.resize((*it_neighbor).second.N_RWG_test);
-      for (int i=0; i<(*it_neighbor).second.N_RWG_test; i++) {
-        const int RWG_number = (*it_neighbor).second.testSrc_RWGsNumbers[i];  
-        Z_local_lines_indexes[i] = src_edges_numbers_local_src_edges_numbers[RWG_number];
+      ws.Z_local_lines_indexes.resize(neighbor.N_RWG_test);
+      for (int i=0; i<neighbor.N_RWG_test; i++) {
+        const int localIndex = ws.RWG_to_localIndex[neighbor.testSrc_RWGsLocalNumbers[i]];
+        ws.Z_local_lines_indexes[i] = (localIndex < 0) ? 0 : localIndex;
       }
       // then we find the column indexes. A little more complicated
-      std::vector<int> common_neighborsNumbers;
-      for (int i=0; i<(*it_neighbor).second.N_neighbors; i++) {
-        const int val = (*it_neighbor).second.neighborsIndexes[i];
-        if (set_cubeNeighborsIndexes.find(val) != set_cubeNeighborsIndexes.end()) common_neighborsNumbers.push_back(val);
-      }
-      std::vector<int> src_tmp;
-      for (unsigned int i=0; i<common_neighborsNumbers.size(); i++) {
-        const int commonNeighbor = common_neighborsNumbers[i];
-        CubeArraysMapIterator it_commonNeighbor = ListCubes.find(commonNeighbor);
-        for (int kk=0; kk<(*it_commonNeighbor).second.N_RWG_test; kk++) {
-          src_tmp.push_back((*it_commonNeighbor).second.testSrc_RWGsNumbers[kk]);
-        }
+      ws.src_tmp.clear();
+      for (int i=0; i<neighbor.N_neighbors; i++) {
+        const int val = neighbor.neighborsIndexes[i];
+        if (!binary_search(ws.sortedNeighborsIndexes.begin(), ws.sortedNeighborsIndexes.end(), val)) continue;
+        const CubeArrays & commonNeighbor = (*ListCubes.find(val)).second;
+        for (int kk=0; kk<commonNeighbor.N_RWG_test; kk++) ws.src_tmp.push_back(commonNeighbor.testSrc_RWGsLocalNumbers[kk]);
       }
-      std::set<int> set_srcEdges(src_tmp.begin(), src_tmp.end());
-      std::vector<int> columnsOfNeighborCubeToBeConsidered;
-      for (int i=0; i<(*it_neighbor).second.N_RWG_src; i++) {
-        if (set_srcEdges.find((*it_neighbor).second.testSrc_RWGsNumbers[i]) != set_srcEdges.end()) {
-          columnsOfNeighborCubeToBeConsidered.push_back(i);
-        }
+      for (unsigned int i=0; i<ws.src_tmp.size(); i++) ws.isCommonNeighborEdge[ws.src_tmp[i]] = 1;
+      ws.columnsOfNeighborCubeToBeConsidered.clear();
+      for (int i=0; i<neighbor.N_RWG_src; i++) {
+        if (ws.isCommonNeighborEdge[neighbor.testSrc_RWGsLocalNumbers[i]] == 1) ws.columnsOfNeighborCubeToBeConsidered.push_back(i);
       }
-      std::vector<int> Z_local_columns_indexes;
-      Z_local_columns_indexes.resize(src_tmp.size());
-      for (unsigned int i=0; i<src_tmp.size(); i++) {
-        const int RWG_number = src_tmp[i];
-        Z_local_columns_indexes[i] = src_edges_numbers_local_src_edges_numbers[RWG_number];
+      ws.Z_local_columns_indexes.resize(ws.src_tmp.size());
+      for (unsigned int i=0; i<ws.src_tmp.size(); i++) {
+        const int localIndex = ws.RWG_to_localIndex[ws.src_tmp[i]];
+        ws.Z_local_columns_indexes[i] = (localIndex < 0) ? 0 : localIndex;
+        ws.isCommonNeighborEdge[ws.src_tmp[i]] = 0;
       }
       // we construct Z_local
-      for (int i=0; i<(int)Z_local_lines_indexes.size(); i++) {
-        for (unsigned int j=0; j<Z_local_columns_indexes.size(); j++) {
-          const int index_line = Z_local_lines_indexes[i];
-          const int index_column = Z_local_columns_indexes[j];
-          Z_local(index_line, index_column) = (*it_neighbor).second.Z_CFIE_J(i, columnsOfNeighborCubeToBeConsidered[j]);
+      for (unsigned int i=0; i<ws.Z_local_lines_indexes.size(); i++) {
+        const int line = ws.localIndex_to_line[ws.Z_local_lines_indexes[i]];
+        if (line < 0) continue;
+        for (unsigned int j=0; j<ws.Z_local_columns_indexes.size(); j++) {
+          const int index_column = ws.Z_local_columns_indexes[j];
+          ws.A(line + index_column*N_lines) = neighbor.Z_CFIE_J(i, ws.columnsOfNeighborCubeToBeConsidered[j]);
         }
       }
     } // end else
   } // end for 
 
-  // further reduce the matrix size
-  int N_lines = 0;
-  for (int i=0; i<(*it).second.N_RWG_src; i++) N_lines += (*it).second.isEdgeInCartesianRadius[i];
-  src_edges_numbers_2.resize(N_lines);
-  blitz::Array<std::complex<double>, 1> Z_local_2(N_lines * (*it).second.N_RWG_src);
-  Z_local_2 = 0.0;
-  int line_index = 0;
-  for (int i=0; i<(*it).second.N_RWG_src; i++) {
-    if ((*it).second.isEdgeInCartesianRadius[i]==1) {
-      for (int j=0; j<(*it).second.N_RWG_src; j++) Z_local_2(line_index + j*N_lines) = Z_local (i, j);
-      src_edges_numbers_2(line_index) = (*it).second.testSrc_RWGsNumbers[i];
-      line_index++;
-    }
+  for (int i=0; i<N_RWG_src; i++) {
+    if (ws.localIndex_to_line[i] >= 0) src_edges_numbers_2[ws.localIndex_to_line[i]] = cube.testSrc_RWGsNumbers[i];
+    ws.RWG_to_localIndex[cube.testSrc_RWGsLocalNumbers[i]] = -1;
   }
   // compute the SAI matrix
-  blitz::Array<std::complex<double>, 2> Y_CFIE;
-  computeMyPinvCC(Y_CFIE, Z_local_2, N_lines, (*it).second.N_RWG_src);
-  
-  Mg_tmp.resize((*it).second.N_RWG_test * Y_CFIE.extent(1));
-  for (int i=0; i<(*it).second.N_RWG_test; i++) {
-    for (int j=0; j<Y_CFIE.extent(1); j++) Mg_tmp(i*Y_CFIE.extent(1) + j) = Y_CFIE(i, j);    
+  int ldY;
+  const int info = computeMyPinvCC(ldY, ws, N_lines, N_RWG_src);
+  if (info != 0) {
+    std::cout << "compute_SAI_precond: zgels failed for cube " << cubeNumber << ", info = " << info << std::endl;
+    for (int i=0; i<cube.N_RWG_test * N_lines; i++) Mg_cube[i] = 0.0;
+    return;
+  }
+  for (int i=0; i<cube.N_RWG_test; i++) {
+    for (int j=0; j<N_lines; j++) Mg_cube[i*N_lines + j] = ws.B(i + j*ldY);
+  }
+}
+
+//! the data shared by the threads computing the SAI preconditioner of a chunk
+class SAIThreadsData {
+  public:
+    const CubeArraysMap * ListCubes;
+    const blitz::Array<int, 1> * cubesNumbers;
+    const std::vector<int> * MgStartIndexes;
+    const std::vector<int> * qArrayStartIndexes;
+    std::complex<float> * Mg;
+    int * src_RWG_numbers;
+    int N_RWG_local;
+    //! the next cube to compute, protected by mutex
+    int nextCube;
+    pthread_mutex_t mutex;
+};
+
+//! a thread takes the cubes one by one until they are all computed
+void * MgPreconditionerComputationThread(void * arg)
+{
+  SAIThreadsData * data = static_cast<SAIThreadsData *>(arg);
+  SAIWorkspace ws(data->N_RWG_local);
+  const int N_cubes = data->cubesNumbers->size();
+  while (true) {
+    pthread_mutex_lock(&data->mutex);
+    const int j = data->nextCube++;
+    pthread_mutex_unlock(&data->mutex);
+    if (j >= N_cubes) break;
+    MgPreconditionerComputationPerCube(data->Mg + (*data->MgStartIndexes)[j], data->src_RWG_numbers + (*data->qArrayStartIndexes)[j], ws, (*data->cubesNumbers)(j), *data->ListCubes);
+  }
+  return 0;
+}
+
+//! drops the entries of each row of Mg below threshold * (largest magnitude of the row)
+/*!
+  The rows of a cube share their columns in src_RWG_numbers: 8 B per entry, plus 4 B per
+  column of the cube. A sparsified row needs its own columns, that is 12 B per kept entry.
+  A cube is therefore only stored row by row if that is smaller. Otherwise it keeps its shared
+  columns, and its dropped entries are set to zero. The largest entry of each row is always
+  kept, so that no non-zero row is emptied. threshold must be in (0, 1].
+  N_kept returns the number of kept entries, and the function the number of stored entries.
+*/
+int sparsifyMg(blitz::Array<std::complex<float>, 1>& Mg,
+               blitz::Array<int, 1>& src_RWG_numbers,
+               blitz::Array<int, 2>& rowIndexToColumnIndexes,
+               const std::vector<int>& N_RowsPerCube,
+               const double threshold,
+               int & N_kept)
+{
+  const int N_cubes = N_RowsPerCube.size();
+  // first pass: the kept entries, and the storage of each cube
+  std::vector<char> isKept(Mg.size());
+  std::vector<bool> isCubeSparse(N_cubes);
+  int N_stored = 0, N_columnsStored = 0, row = 0, indexInMg = 0;
+  N_kept = 0;
+  for (int c=0; c<N_cubes; c++) {
+    const int N_rows = N_RowsPerCube[c];
+    if (N_rows==0) continue;
+    const int N_columns = rowIndexToColumnIndexes(row, 1) - rowIndexToColumnIndexes(row, 0);
+    int N_keptCube = 0;
+    for (int i=0; i<N_rows; i++) {
+      float maxMagnitude = 0.0;
+      int jMax = 0;
+      for (int j=0; j<N_columns; j++) {
+        if (abs(Mg(indexInMg + j)) > maxMagnitude) {maxMagnitude = abs(Mg(indexInMg + j)); jMax = j;}
+      }
+      const float minMagnitude = threshold * maxMagnitude;
+      for (int j=0; j<N_columns; j++) {
+        isKept[indexInMg + j] = ( (j==jMax) || (abs(Mg(indexInMg + j)) >= minMagnitude) );
+        N_keptCube += isKept[indexInMg + j];
+      }
+      indexInMg += N_columns;
+    }
+    isCubeSparse[c] = (12.0 * N_keptCube < 8.0 * N_rows * N_columns + 4.0 * N_columns);
+    N_stored += isCubeSparse[c] ? N_keptCube : N_rows * N_columns;
+    N_columnsStored += isCubeSparse[c] ? N_keptCube : N_columns;
+    N_kept += N_keptCube;
+    row += N_rows;
+  }
+  // second pass: the compacted arrays
+  blitz::Array<std::complex<float>, 1> Mg_sparse(N_stored);
+  blitz::Array<int, 1> src_RWG_numbers_sparse(N_columnsStored);
+  int index = 0, indexInColumns = 0;
+  row = 0;
+  indexInMg = 0;
+  for (int c=0; c<N_cubes; c++) {
+    const int N_rows = N_RowsPerCube[c];
+    if (N_rows==0) continue;
+    const int startIndex = rowIndexToColumnIndexes(row, 0);
+    const int N_columns = rowIndexToColumnIndexes(row, 1) - startIndex;
+    if (isCubeSparse[c]) {
+      for (int i=0; i<N_rows; i++) {
+        rowIndexToColumnIndexes(row + i, 0) = indexInColumns;
+        for (int j=0; j<N_columns; j++) {
+          if (isKept[indexInMg + j]) {
+            Mg_sparse(index) = Mg(indexInMg + j);
+            src_RWG_numbers_sparse(indexInColumns) = src_RWG_numbers(startIndex + j);
+            index++;
+            indexInColumns++;
+          }
+        }
+        rowIndexToColumnIndexes(row + i, 1) = indexInColumns;
+        indexInMg += N_columns;
+      }
+    }
+    else {
+      for (int j=0; j<N_columns; j++) src_RWG_numbers_sparse(indexInColumns + j) = src_RWG_numbers(startIndex + j);
+      for (int i=0; i<N_rows; i++) {
+        rowIndexToColumnIndexes(row + i, 0) = indexInColumns;
+        rowIndexToColumnIndexes(row + i, 1) = indexInColumns + N_columns;
+        for (int j=0; j<N_columns; j++) {
+          Mg_sparse(index) = isKept[indexInMg + j] ? Mg(indexInMg + j) : std::complex<float>(0.0, 0.0);
+          index++;
+        }
+        indexInMg += N_columns;
+      }
+      indexInColumns += N_columns;
+    }
+    row += N_rows;
   }
+  Mg.resize(N_stored);
+  Mg = Mg_sparse;
+  src_RWG_numbers.resize(N_columnsStored);
+  src_RWG_numbers = src_RWG_numbers_sparse;
+  return N_stored;
 }
 
 int main(int argc, char* argv[]) {
@@ -276,6 +448,19 @@ int main(int argc, char* argv[]) {
   readIntBlitzArray1DFromASCIIFile(SAI_PRECOND_DATA_PATH + "chunkNumbers.txt", chunkNumbers);
   readIntBlitzArray1DFromASCIIFile(SAI_PRECOND_DATA_PATH + "cubeNumber_to_chunkNumber.txt", cubeNumber_to_chunkNumber);
 
+  // the number of threads computing the SAI preconditioner of each process
+  int SAI_PRECOND_N_THREADS;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "SAI_PRECOND_N_THREADS.txt", SAI_PRECOND_N_THREADS);
+  SAI_PRECOND_N_THREADS = max(1, SAI_PRECOND_N_THREADS);
+  // the relative magnitude below which the entries of the preconditioner are dropped (0: no dropping)
+  double SAI_PRECOND_DROP_THRESHOLD;
+  readDoubleFromASCIIFile(OCTTREE_DATA_PATH + "SAI_PRECOND_DROP_THRESHOLD.txt", SAI_PRECOND_DROP_THRESHOLD);
+  if ( (SAI_PRECOND_DROP_THRESHOLD < 0.0) || (SAI_PRECOND_DROP_THRESHOLD > 1.0) ) {
+    if (my_id==0) std::cout << "compute_SAI_precond: SAI_PRECOND_DROP_THRESHOLD = " << SAI_PRECOND_DROP_THRESHOLD << " must be 0 (no dropping) or in (0, 1]. Exiting..." << std::endl;
+    exit(1);
+  }
+  double N_entries_local = 0.0, N_kept_entries_local = 0.0, N_bytes_local = 0.0, N_stored_bytes_local = 0.0;
+
   const int N_chunks = chunkNumbers.size();
   for (int i=0; i<N_chunks; i++) {
     const int chunk = chunkNumbers(i);
@@ -285,8 +470,9 @@ int main(int argc, char* argv[]) {
     CubeArraysMap ListCubes;
     // variables needed later
     int N_RWG = 0, N_precond = 0, N_q_array = 0;
-    std::vector<int> N_ColumnsPerCube;
+    std::vector<int> N_ColumnsPerCube, N_RowsPerCube;
     N_ColumnsPerCube.resize(N_cubes);
+    N_RowsPerCube.resize(N_cubes);
     // we construct a list of cubes
     for (int j=0; j<N_cubes; j++) {
       const int cubeNumber = cubesNumbers(j);
@@ -310,6 +496,7 @@ int main(int argc, char* argv[]) {
       int N_isEdgeInCartesianRadius = 0;
       for (unsigned int kk=0; kk<cube.isEdgeInCartesianRadius.size(); kk++) N_isEdgeInCartesianRadius += cube.isEdgeInCartesianRadius[kk];
       N_ColumnsPerCube[j] = N_isEdgeInCartesianRadius;
+      N_RowsPerCube[j] = cube.N_RWG_test;
       // N_precond = number of elements in the preconditioner chunk
       N_precond += N_isEdgeInCartesianRadius * cube.N_RWG_test;
       N_q_array += N_isEdgeInCartesianRadius;      
@@ -330,30 +517,60 @@ int main(int argc, char* argv[]) {
     blitz::Array<std::complex<float>, 1> Mg(N_precond); // N_precond = number of elements in the preconditioner chunk
     blitz::Array<int, 2> rowIndexToColumnIndexes(N_RWG, 2);
     blitz::Array<int, 1> src_RWG_numbers(N_q_array);
+    // the cubes write their results in Mg and src_RWG_numbers at precomputed offsets
+    std::vector<int> MgStartIndexes(N_cubes), qArrayStartIndexes(N_cubes);
     int startIndex = 0, startIndexInQArray = 0;
-    int indexN_ColumnsPerCube = 0, index_in_rowIndexToColumnIndexes = 0;
+    int index_in_rowIndexToColumnIndexes = 0;
     for (int j=0; j<N_cubes; j++) {
-      const int cubeNumber = cubesNumbers(j);
-      blitz::Array<int, 1> Mg_q_array;
-      blitz::Array<std::complex<float>, 1> Mg_tmp;
-      MgPreconditionerComputationPerCube(Mg_tmp, Mg_q_array, cubeNumber, ListCubes);
-      // filling Mg
-      for (unsigned int kk=0; kk<Mg_tmp.size(); kk++) Mg(kk + startIndex) = Mg_tmp(kk);
-      startIndex += Mg_tmp.size();
-      // filling src_RWG_numbers
-      for (unsigned int kk=0; kk<Mg_q_array.size(); kk++) src_RWG_numbers(kk + startIndexInQArray) = Mg_q_array(kk);
-      // the rest
-      CubeArraysMapIterator it = ListCubes.find(cubeNumber);
+      CubeArraysMapIterator it = ListCubes.find(cubesNumbers(j));
+      MgStartIndexes[j] = startIndex;
+      qArrayStartIndexes[j] = startIndexInQArray;
       const int indInf = index_in_rowIndexToColumnIndexes;
       const int indSup = index_in_rowIndexToColumnIndexes + (*it).second.N_RWG_test;
       for (int kk=0; kk<(*it).second.N_RWG_test; kk++) {
         rowIndexToColumnIndexes(kk + indInf, 0) = startIndexInQArray;
-        rowIndexToColumnIndexes(kk + indInf, 1) = startIndexInQArray + N_ColumnsPerCube[indexN_ColumnsPerCube];
+        rowIndexToColumnIndexes(kk + indInf, 1) = startIndexInQArray + N_ColumnsPerCube[j];
       }
       index_in_rowIndexToColumnIndexes = indSup;
-      startIndexInQArray += N_ColumnsPerCube[indexN_ColumnsPerCube];
-      indexN_ColumnsPerCube += 1;  
+      startIndex += (*it).second.N_RWG_test * N_ColumnsPerCube[j];
+      startIndexInQArray += N_ColumnsPerCube[j];
+    }
+    const int N_RWG_local = computeChunkLocalRWGNumbers(ListCubes);
+    SAIThreadsData threadsData;
+    threadsData.ListCubes = &ListCubes;
+    threadsData.cubesNumbers = &cubesNumbers;
+    threadsData.MgStartIndexes = &MgStartIndexes;
+    threadsData.qArrayStartIndexes = &qArrayStartIndexes;
+    threadsData.Mg = Mg.data();
+    threadsData.src_RWG_numbers = src_RWG_numbers.data();
+    threadsData.N_RWG_local = N_RWG_local;
+    threadsData.nextCube = 0;
+    pthread_mutex_init(&threadsData.mutex, 0);
+    if ((SAI_PRECOND_N_THREADS > 1) && (N_cubes > 1)) {
+      // the first cube is computed alone, so that the lapack routines
+      // initialise their saved machine constants before the threads start
+      SAIWorkspace ws(N_RWG_local);
+      MgPreconditionerComputationPerCube(Mg.data(), src_RWG_numbers.data(), ws, cubesNumbers(0), ListCubes);
+      threadsData.nextCube = 1;
+      const int N_threads = min(SAI_PRECOND_N_THREADS, N_cubes - 1);
+      std::vector<pthread_t> threads(N_threads);
+      for (int t=0; t<N_threads; t++) {
+        if (pthread_create(&threads[t], 0, MgPreconditionerComputationThread, &threadsData) != 0) {
+          std::cout << "compute_SAI_precond: could not create thread " << t << ". Exiting..." << std::endl;
+          exit(1);
+        }
+      }
+      for (int t=0; t<N_threads; t++) pthread_join(threads[t], 0);
     }
+    else MgPreconditionerComputationThread(&threadsData);
+    pthread_mutex_destroy(&threadsData.mutex);
+    // the memory of the values and of their columns numbers
+    N_entries_local += N_precond;
+    N_bytes_local += 8.0 * N_precond + 4.0 * N_q_array;
+    int N_kept = N_precond;
+    if (SAI_PRECOND_DROP_THRESHOLD > 0.0) N_precond = sparsifyMg(Mg, src_RWG_numbers, rowIndexToColumnIndexes, N_RowsPerCube, SAI_PRECOND_DROP_THRESHOLD, N_kept);
+    N_kept_entries_local += N_kept;
+    N_stored_bytes_local += 8.0 * N_precond + 4.0 * src_RWG_numbers.size();
     // we write the arrays to disk
     writeComplexFloatBlitzArray1DToBinaryFile(SAI_PRECOND_DATA_PATH + "Mg_LeftFrob"+ intToString(chunk) + ".txt", Mg);
     writeIntBlitzArray1DToBinaryFile(SAI_PRECOND_DATA_PATH + "src_RWG_numbers" + intToString(chunk) + ".txt", src_RWG_numbers);
@@ -365,6 +582,18 @@ int main(int argc, char* argv[]) {
     writeIntToASCIIFile(SAI_PRECOND_DATA_PATH + "N_src_RWG" + intToString(chunk) + ".txt", src_RWG_numbers.size());
   }
   
+  if (SAI_PRECOND_DROP_THRESHOLD > 0.0) {
+    double N_entries, N_kept_entries, N_bytes, N_stored_bytes;
+    MPI_Reduce(&N_entries_local, &N_entries, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&N_kept_entries_local, &N_kept_entries, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&N_bytes_local, &N_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&N_stored_bytes_local, &N_stored_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (my_id==0) {
+      std::cout << "SAI preconditioner sparsification: drop threshold = " << SAI_PRECOND_DROP_THRESHOLD << ", fill ratio = " << N_kept_entries/max(N_entries, 1.0) << " (" << N_kept_entries << " of " << N_entries << " entries kept)" << std::endl;
+      std::cout << "  values and columns: " << N_stored_bytes/(1024.0*1024.0) << " MB instead of " << N_bytes/(1024.0*1024.0) << " MB" << std::endl;
+    }
+  }
+
   // Get peak memory usage of each rank
   float memusage_local_MB = static_cast<float>(MemoryUsageGetPeak())/(1024.0*1024.0);
   float tot_memusage_MB, max_memusage_MB;
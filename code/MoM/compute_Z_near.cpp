@@ -190,6 +190,18 @@ int main(int argc, char* argv[]) {
   readComplexFloatFromASCIIFile(OCTTREE_DATA_PATH  + "Z_s.txt", Z_s);
   double R_NORM_TYPE_1;
   readDoubleFromASCIIFile(OCTTREE_DATA_PATH  + "leaf_side_length.txt", R_NORM_TYPE_1);
+  // the accuracy target of the adaptive quadrature of the non-touching pairs (0: fixed rules)
+  double MOM_NEAR_FIELD_ACCURACY;
+  readDoubleFromASCIIFile(OCTTREE_DATA_PATH  + "MOM_NEAR_FIELD_ACCURACY.txt", MOM_NEAR_FIELD_ACCURACY);
+  // the near field integrals cache, for the pairs of triangles related by a translation
+  int MOM_NEAR_FIELD_CACHE;
+  double MOM_NEAR_FIELD_CACHE_TOL, MOM_NEAR_FIELD_CACHE_MAX_MB;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH  + "MOM_NEAR_FIELD_CACHE.txt", MOM_NEAR_FIELD_CACHE);
+  readDoubleFromASCIIFile(OCTTREE_DATA_PATH  + "MOM_NEAR_FIELD_CACHE_TOL.txt", MOM_NEAR_FIELD_CACHE_TOL);
+  readDoubleFromASCIIFile(OCTTREE_DATA_PATH  + "MOM_NEAR_FIELD_CACHE_MAX_MB.txt", MOM_NEAR_FIELD_CACHE_MAX_MB);
+  const int N_MAX_CACHED_PAIRS = NearFieldIntegralsCache::maxSizeFromMemory(MOM_NEAR_FIELD_CACHE_MAX_MB);
+  NearFieldIntegralsCache nearFieldCache(MOM_NEAR_FIELD_CACHE_TOL * R_NORM_TYPE_1, N_MAX_CACHED_PAIRS);
+  NearFieldIntegralsCache * nearFieldCachePointer = (MOM_NEAR_FIELD_CACHE != 0) ? &nearFieldCache : 0;
   
   // reading mesh data
   int N_local_Chunks, N_local_cubes;
@@ -253,7 +265,7 @@ int main(int argc, char* argv[]) {
     Z_CFIE_M = 0.0;
     localSrcRWGNumber_M_CURRENT_OK *= 0; // no dielectric in MLFMA yet
     const double signSurfObs = 1.0, signSurfSrc = 1.0; // no dielectric in MLFMA yet
-    Z_CFIE_J_computation(Z_CFIE_J, Z_CFIE_M, CFIEcoeffs, signSurfObs, signSurfSrc, test_RWGsNumbers, src_RWGsNumbers, localTestRWGNumber_CFIE_OK, localSrcRWGNumber_M_CURRENT_OK, localTestSrcRWGNumber_signedTriangles, localTestSrcRWGNumber_nodes, nodesCoord, w, eps_r, mu_r, TDS_APPROX, Z_s, MOM_FULL_PRECISION);
+    Z_CFIE_J_computation(Z_CFIE_J, Z_CFIE_M, CFIEcoeffs, signSurfObs, signSurfSrc, test_RWGsNumbers, src_RWGsNumbers, localTestRWGNumber_CFIE_OK, localSrcRWGNumber_M_CURRENT_OK, localTestSrcRWGNumber_signedTriangles, localTestSrcRWGNumber_nodes, nodesCoord, w, eps_r, mu_r, TDS_APPROX, Z_s, MOM_FULL_PRECISION, MOM_NEAR_FIELD_ACCURACY, nearFieldCachePointer);
 
     // transforming and writing the matrix to the disk
     blitz::Array<std::complex<float>, 1> Z_CFIE_J_linear(N_RWG_test * N_RWG_src);
@@ -271,6 +283,10 @@ int main(int argc, char* argv[]) {
     compute_cubeSmallIntArray(cubeSmallIntArray, allCubeIntArrays(i), neighbors_cubes, localTestSrcRWGNumber_nodes, nodesCoord, rCubeCenter, R_NORM_TYPE_1);
     writeIntBlitzArray1DToBinaryFile(filenameIntArray, cubeSmallIntArray);
   }
+  if ((my_id==master) && (MOM_NEAR_FIELD_CACHE != 0)) {
+    std::cout << "Process " <<  my_id << " : near field cache: " << nearFieldCache.getN_hits() << " pairs reused, " << nearFieldCache.getN_misses() << " pairs computed." << endl;
+    flush(std::cout);
+  }
   
   // Get peak memory usage of each rank
   float memusage_local_MB = static_cast<float>(MemoryUsageGetPeak())/(1024.0*1024.0);
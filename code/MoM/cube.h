@@ -12,6 +12,14 @@ using namespace std;
 #include "GK_triangle.h"
 #include "dictionary.h"
 
+//! \brief the absolute cartesian coordinate along one axis of the cube of side sideLength that contains r.
+//! r is first rounded to float, as Cube::rCenter, so that every caller finds the same cube as the Cube constructor
+inline int cubeCartesianCoord(const double r, const double bigCubeLowerCoord, const double sideLength)
+{
+  const float rCenter = static_cast<float>(r);
+  return static_cast<int>(floor( (rCenter - bigCubeLowerCoord)/sideLength ));
+}
+
 class Cube {
     //! the absolute number of the current cube
     int number;
@@ -28,32 +36,27 @@ class Cube {
     int procNumber;
     //! the process number of the father of the current cube
     int fatherProcNumber;
-    //! the indexes of the children of the current cube
-    std::vector<int> sonsIndexes;
-    //! the processes number of the children of the current cube
-    std::vector<int> sonsProcNumbers;
-    //! the indexes of the neighbors of the current cube
-    std::vector<int> neighborsIndexes;
-    //! \brief the indexes of the cubes that will participate to the alpha translation to the current cube
-    //! and that are located on the same process as that of the current cube
-    std::vector<int> localAlphaTransParticipantsIndexes;
-    //! \brief the indexes of the cubes that will participate to the alpha translation to the current cube
-    //! and that are located on another process as that of the current cube
-    std::vector<int> nonLocalAlphaTransParticipantsIndexes;
+    // the sons and the neighbors of the cube are stored in the arrays of its Level
+    //! \brief where the indexes of the cubes that will participate to the alpha translation to the current cube
+    //! start in Level::alphaTransParticipantsIndexes: first those located on the same process as that of the
+    //! current cube, then those located on another process
+    int alphaTransParticipantsStartIndex;
+    int N_localAlphaTransParticipants;
+    int N_nonLocalAlphaTransParticipants;
     //! the absolute coordinates of the center of the current cube 
     float rCenter[3];
     //! \brief the absolute cartesian coordinates of the center of the current cube
     //! calculated with respect to the location of the Father of all Cubes and the side length of the current cube  
     float absoluteCartesianCoord[3];
-    //! the numbers of the RWGs pertaining to the current cube
-    std::vector<int> RWG_numbers;
-    std::vector<int> RWG_numbers_CFIE_OK;
-    std::vector<int> Triangle_numberOfRWGs;
-    std::vector<int> TriangleToRWGindex;
-    std::vector<float> TriangleToRWGweight; 
-    std::vector<float> TriangleToRWG_ropp;
-    blitz::Array<float, 2> triangle_GaussCoord;
-    blitz::Array<float, 2> triangle_nHat;
+    //! \brief the RWGs and triangles of a leaf cube are stored in the flat arrays of its Level
+    //! (see Level::computeGaussLocatedArguments): the cube only holds where its data starts in them
+    int RWG_startIndex;
+    //! the number of RWGs pertaining to the current cube
+    int N_RWG;
+    int triangle_startIndex;
+    int N_triangles;
+    //! start of the (triangle, RWG) pairs of the current cube in the Level arrays
+    int triangleToRWG_startIndex;
     // constructors
     Cube(void){};
     //! the base constructor
@@ -91,8 +94,6 @@ class Cube {
     ~Cube();
 
     // specific functions
-    void addSon(const Cube&);
-    //! returns the sonsIndexes vector
     void setIndex(const int i) {index = i;}
     int getIndex(void) const {return index;}
     void setOldIndex(const int i) {oldIndex = i;}
@@ -103,21 +104,6 @@ class Cube {
     void setFatherNumber(const int n) {fatherNumber = n;}
     int getFatherIndex(void) const {return fatherIndex;}
     void setFatherIndex(const int i) {fatherIndex = i;}
-
-    //! \brief computes the points locations and values for the arguments for the complex exponentials 
-    //! that will be used in computing the radiation function of the leaf cube 
-    /*!
-      \param target_mesh the mesh of the target, C++ object
-      \param N_Gauss int, the number of points per triangles
-      \return void
-    */
-    void computeGaussLocatedArguments(const blitz::Array<int, 1>& local_RWG_numbers,
-                                      const blitz::Array<int, 1>& local_RWG_Numbers_CFIE_OK,
-                                      const blitz::Array<int, 2>& local_RWGNumbers_signedTriangles,
-                                      const blitz::Array<float, 2>& local_RWGNumbers_trianglesCoord,
-                                      const int startIndex_in_localArrays,
-                                      const int NRWG,
-                                      const int N_Gauss);
     // overloaded operators
     bool operator== (const Cube &) const;
     bool operator< (const Cube &) const;
@@ -6,6 +6,9 @@
 #include <string>
 #include <blitz/array.h>
 #include <complex>
+#include <vector>
+#include <map>
+#include <limits>
 #include <mpi.h>
 
 using namespace std;
@@ -318,6 +321,245 @@ class PrecondFunctor
     { return (*pt2Object.*funcpt)(x); }; // execute member function
 };
 
+// block matvec functor: the vectors are the rows of a 2D array
+template <class T, class TClassA>
+class BlockMatvecFunctor
+{
+  private:
+    blitz::Array<T, 2> (TClassA::*funcpt)(const blitz::Array<T, 2>&); /**< pointer to member function */
+    TClassA* pt2Object; /**< pointer to object */
+
+  public:
+    BlockMatvecFunctor(TClassA* _pt2Object, blitz::Array<T, 2>(TClassA::*_funcpt)(const blitz::Array<T, 2>&)) { pt2Object = _pt2Object; funcpt = _funcpt; };
+    ~BlockMatvecFunctor(void){};
+
+    // operator ()
+    blitz::Array<T, 2> operator()(const blitz::Array<T, 2>& X)
+    { return (*pt2Object.*funcpt)(X); }; // execute member function
+};
+
+// block precond functor: the vectors are the rows of a 2D array
+template <class T, class TClassB>
+class BlockPrecondFunctor
+{
+  private:
+    blitz::Array<T, 2> (TClassB::*funcpt)(const blitz::Array<T, 2>&); /**< pointer to member function */
+    TClassB* pt2Object; /**< pointer to object */
+
+  public:
+    BlockPrecondFunctor(TClassB* _pt2Object, blitz::Array<T, 2>(TClassB::*_funcpt)(const blitz::Array<T, 2>&)) { pt2Object = _pt2Object; funcpt = _funcpt; };
+    ~BlockPrecondFunctor(void){};
+
+    // operator ()
+    blitz::Array<T, 2> operator()(const blitz::Array<T, 2>& X)
+    { return (*pt2Object.*funcpt)(X); }; // execute member function
+};
+
+inline int solverTimerSolveNumber(const string & filename)
+/** the number of the current solve for a given log file, starting at 0 */
+{
+  static std::map<string, int> N_solves;
+  return N_solves[filename]++;
+}
+
+/** Per-iteration timing of the iterative solvers. Rank 0 writes one CSV line per iteration to
+ *  the timing log, whose name is that of the convergence file with a "_timing.csv" suffix:
+ *  the solve number (one per excitation), the iteration, the error, the wall time since the
+ *  start of the solve, and the cumulative matvec, preconditioner and reduction times, in seconds.
+ *  The reductions are those of the solver itself: the communications of the MLFMA are counted
+ *  in the matvec time.
+ */
+class SolverTimer
+{
+    std::ofstream ofs;
+    string solverName;
+    int my_id, solveNumber, iteration;
+    double t_start;
+
+  public:
+    double t_matvec, t_psolve, t_comm;
+    int N_matvecs;
+
+    /// constructor
+    SolverTimer(const string & convergenceDetailedOutput, const string & name, const int id)
+    {
+      solverName = name;
+      my_id = id;
+      iteration = 0;
+      N_matvecs = 0;
+      t_matvec = 0.0;
+      t_psolve = 0.0;
+      t_comm = 0.0;
+      const string filename = convergenceDetailedOutput.substr(0, convergenceDetailedOutput.rfind('.')) + "_timing.csv";
+      solveNumber = solverTimerSolveNumber(filename);
+      if (my_id==0) {
+        ofs.open(filename.c_str(), (solveNumber==0) ? std::ios::out : std::ios::app);
+        if (! ofs.is_open()) {
+          cout << "error opening " << filename << endl;
+          exit(1);
+        }
+        ofs.precision(8);
+        if (solveNumber==0) ofs << "solve,solver,iteration,error,wall_time,matvec_time,precond_time,comm_time,N_matvecs" << endl;
+      }
+      t_start = MPI_Wtime();
+    };
+    ~SolverTimer(void) {if (ofs.is_open()) ofs.close();};
+
+    /// timed matrix-vector product
+    template <typename T, typename TClassA>
+    blitz::Array<T, 1> matvec(MatvecFunctor<T, TClassA>& f, const blitz::Array<T, 1>& x)
+    {
+      const double t = MPI_Wtime();
+      blitz::Array<T, 1> y(f(x));
+      t_matvec += MPI_Wtime() - t;
+      N_matvecs++;
+      return y;
+    };
+    /// timed preconditioner solve
+    template <typename T, typename TClassB>
+    blitz::Array<T, 1> psolve(PrecondFunctor<T, TClassB>& f, const blitz::Array<T, 1>& x)
+    {
+      const double t = MPI_Wtime();
+      blitz::Array<T, 1> y(f(x));
+      t_psolve += MPI_Wtime() - t;
+      return y;
+    };
+    /// timed block matrix-vector product, one matvec per row
+    template <typename T, typename TClassA>
+    blitz::Array<T, 2> matvec(BlockMatvecFunctor<T, TClassA>& f, const blitz::Array<T, 2>& X)
+    {
+      const double t = MPI_Wtime();
+      blitz::Array<T, 2> Y(f(X));
+      t_matvec += MPI_Wtime() - t;
+      N_matvecs += X.extent(0);
+      return Y;
+    };
+    /// timed block preconditioner solve
+    template <typename T, typename TClassB>
+    blitz::Array<T, 2> psolve(BlockPrecondFunctor<T, TClassB>& f, const blitz::Array<T, 2>& X)
+    {
+      const double t = MPI_Wtime();
+      blitz::Array<T, 2> Y(f(X));
+      t_psolve += MPI_Wtime() - t;
+      return Y;
+    };
+    /// timed global sum
+    void reduceSum(void* sendbuf, void* recvbuf, const int count, MPI_Datatype datatype)
+    {
+      const double t = MPI_Wtime();
+      MPI_Allreduce(sendbuf, recvbuf, count, datatype, MPI_SUM, MPI_COMM_WORLD);
+      t_comm += MPI_Wtime() - t;
+    };
+    /// non-blocking global sum, completed by waitReduceSum. Only the exposed latency is counted
+    void startReduceSum(void* sendbuf, void* recvbuf, const int count, MPI_Datatype datatype, MPI_Request* request)
+    {
+      const double t = MPI_Wtime();
+      MPI_Iallreduce(sendbuf, recvbuf, count, datatype, MPI_SUM, MPI_COMM_WORLD, request);
+      t_comm += MPI_Wtime() - t;
+    };
+    void waitReduceSum(MPI_Request* request)
+    {
+      const double t = MPI_Wtime();
+      MPI_Wait(request, MPI_STATUS_IGNORE);
+      t_comm += MPI_Wtime() - t;
+    };
+    /// one line of the log
+    void writeIteration(const double error)
+    {
+      if (my_id==0) ofs << solveNumber << "," << solverName << "," << iteration << "," << error << "," << MPI_Wtime() - t_start << "," << t_matvec << "," << t_psolve << "," << t_comm << "," << N_matvecs << "\n";
+      iteration++;
+    };
+};
+
+template <typename T>
+std::complex<double> localDotProduct(const blitz::Array<T, 1>& x, /**< INPUT: local part of x */
+                                     const blitz::Array<T, 1>& y) /**< INPUT: local part of y */
+/** local part of \f$ x^H y \f$, accumulated in double precision */
+{
+  std::complex<double> result = 0.0;
+  const int N = x.extent(0);
+  for (int i=0 ; i<N ; ++i) result += static_cast< std::complex<double> >(conjScalar(x(i))) * static_cast< std::complex<double> >(y(i));
+  return result;
+}
+
+inline void givensRotation(std::complex<double>& cs, /**< OUTPUT: cosine */
+                           std::complex<double>& sn, /**< OUTPUT: sine */
+                           const std::complex<double>& a, /**< INPUT: first component */
+                           const std::complex<double>& b) /**< INPUT: component to annihilate */
+/** the rotation \f$ [\bar{c}, \bar{s}; -s, c] \f$ that maps \f$ (a, b) \f$ to \f$ (\sqrt{|a|^2+|b|^2}, 0) \f$ */
+{
+  const double r = sqrt(norm(a) + norm(b));
+  cs = (r>0.0) ? a/r : std::complex<double>(1.0, 0.0);
+  sn = (r>0.0) ? b/r : std::complex<double>(0.0, 0.0);
+}
+
+inline void applyGivensRotation(const std::complex<double>& cs,
+                                const std::complex<double>& sn,
+                                std::complex<double>& a,
+                                std::complex<double>& b)
+{
+  const std::complex<double> temp = conj(cs) * a + conj(sn) * b;
+  b = -sn * a + cs * b;
+  a = temp;
+}
+
+/** The least-squares problem \f$ \min_y \| \beta e_1 - \bar{H} y \| \f$ of the GMRES family.
+ *  The columns of the Hessenberg matrix are rotated as they are appended, so that the residual
+ *  norm is known at each step and \f$ y \f$ is a back substitution on the triangular factor.
+ */
+class HessenbergLeastSquares
+{
+    blitz::Array<std::complex<double>, 2> R; /**< the rotated Hessenberg matrix */
+    blitz::Array<std::complex<double>, 1> cs, sn, g;
+
+  public:
+    /// constructor
+    HessenbergLeastSquares(const int m) {R.resize(m+1, m); cs.resize(m); sn.resize(m); g.resize(m+1);};
+    ~HessenbergLeastSquares(void){};
+    void reset(const double beta) {g = 0.0; g(0) = beta;};
+    double addColumn(const int j, /**< INPUT: the column number */
+                     const blitz::Array<std::complex<double>, 1>& h) /**< INPUT: h(0:j+1), the column j of \f$ \bar{H} \f$ */
+    /** appends a column and returns the new residual norm */
+    {
+      for (int i=0 ; i<=j+1 ; ++i) R(i, j) = h(i);
+      for (int i=0 ; i<j ; ++i) applyGivensRotation(cs(i), sn(i), R(i, j), R(i+1, j));
+      givensRotation(cs(j), sn(j), R(j, j), R(j+1, j));
+      applyGivensRotation(cs(j), sn(j), R(j, j), R(j+1, j));
+      applyGivensRotation(cs(j), sn(j), g(j), g(j+1));
+      return abs(g(j+1));
+    };
+    void solve(blitz::Array<std::complex<double>, 1>& y, const int n) const
+    /** the solution for the n first columns */
+    {
+      y.resize(n);
+      for (int i=n-1 ; i>-1 ; i--) {
+        y(i) = g(i);
+        for (int l=i+1 ; l<n ; ++l) y(i) -= R(i, l) * y(l);
+        y(i) /= R(i, i);
+      }
+    };
+};
+
+template <typename T>
+void addBasisCombination(blitz::Array<T, 1>& x, /**< INPUT/OUTPUT: the local vector */
+                         const blitz::Array<T, 2>& V, /**< INPUT: the basis vectors, one per row */
+                         const blitz::Array<std::complex<double>, 1>& y, /**< INPUT: the coefficients */
+                         const int n) /**< INPUT: the number of basis vectors */
+/** \f$ x += \sum_{j<n} y_j V(j, :) \f$ in a single pass over x, by blocks that stay in cache
+ *  while the n basis vectors stream through */
+{
+  const int N = x.extent(0), BLOCK_SIZE = 1024;
+  std::vector<T> coefficients(max(n, 1));
+  for (int j=0 ; j<n ; ++j) coefficients[j] = static_cast<T>(y(j));
+  for (int startIndex=0 ; startIndex<N ; startIndex+=BLOCK_SIZE) {
+    const int stopIndex = min(startIndex + BLOCK_SIZE, N);
+    for (int j=0 ; j<n ; ++j) {
+      const T c = coefficients[j];
+      for (int i=startIndex ; i<stopIndex ; ++i) x(i) += c * V(j, i);
+    }
+  }
+}
+
 // left preconditioned GMRES
 template <typename T, typename TClassA, typename TClassB>
 void gmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
@@ -342,6 +584,7 @@ void gmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
   ofs.precision(8);
   ofs << "# GMRES algorithm" << endl;
   ofs << "# output showing the convergence for tol = " << tol << endl;
+  SolverTimer timer(convergenceDetailedOutput, "GMRES", my_id);
 
   blitz::Range all = blitz::Range::all();
   flag = 0;
@@ -359,109 +602,65 @@ void gmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
 
   double bnorm2, local_bnorm2, rnorm2, local_rnorm2, wnorm2, local_wnorm2;
   local_bnorm2 = squareNorm2(b);
-  MPI_Allreduce(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+  timer.reduceSum(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE);
   bnorm2 = sqrt(abs(bnorm2));
   if (bnorm2==0.0) bnorm2 = 1.0;
 
-  T temp;
-  blitz::Array<T, 1> rTmp(N_local), r(N_local);
-
-  // workspaces definitions
-  blitz::Array<T, 1> cs(blitz::Range(1, m)), sn(blitz::Range(1, m)), s(m+1), wTmp(N_local), w(N_local), y;
-  blitz::Array<T, 2> V(N_local, m+1), H(blitz::Range(1, m+1), blitz::Range(1, m+1));
+  blitz::Array<T, 1> rTmp(N_local), r(N_local), wTmp(N_local), w(N_local);
+  // the basis vectors are the rows of V, so that each of them is contiguous
+  blitz::Array<T, 2> V(m+1, N_local);
+  HessenbergLeastSquares leastSquares(m);
+  blitz::Array<std::complex<double>, 1> h(m+1), y;
 
   for (iter=0 ; iter<MAXITER ; iter++) {
-    rTmp = b - matvec(x);
-    r = psolve(rTmp);
+    rTmp = b - timer.matvec(matvec, x);
+    r = timer.psolve(psolve, rTmp);
     local_rnorm2 = squareNorm2(r);
-    MPI_Allreduce(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+    timer.reduceSum(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE);
     rnorm2 = sqrt(abs(rnorm2));
-    V(all, 0) = r/static_cast<T>(rnorm2);
-    s = 0.0;
-    s(0) = static_cast<T>(rnorm2);
-
-    H = 0.0;
-    H(1, m+1) = rnorm2;
+    // check convergence of the previous cycle
+    if (iter>0) {
+      error = rnorm2 / bnorm2;
+      ofs << "intermediate error " << error << endl;
+      if ( (error<=tol) || (rnorm2==0.0) ) {
+        ofs.close();
+        return;
+      }
+    }
+    V(0, all) = r/static_cast<T>(rnorm2);
+    leastSquares.reset(rnorm2);
 
-    for (int jH=1 ; jH<m+1 ; ++jH){
-      // if preconditioning: w = M^(-1) * (A*V(all, jH))
-      wTmp = matvec(V(all, jH-1));
-      w = psolve(wTmp);
-      for (int j=1 ; j<jH+1 ; ++j) H(j, jH) = 0.0;
+    int N_steps = 0;
+    for (int jH=0 ; jH<m ; ++jH){
+      // if preconditioning: w = M^(-1) * (A*V(jH, all))
+      wTmp = timer.matvec(matvec, V(jH, all));
+      w = timer.psolve(psolve, wTmp);
 
       // construct orthonormal basis using Modified Gram-Schmidt
-      T dloo = 0.0;
-      for (int j=1 ; j<jH+1 ; ++j) {
-        complex<double> H_local = sum(w * conjArray(V(all, j-1))), H_global;
-        MPI_Allreduce(&H_local, &H_global, 1, MPI::DOUBLE_COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-        H(j, jH) = H_global;
-        w -= H(j, jH) * V(all, j-1);
-        dloo += abs(H_global)*abs(H_global);
+      for (int j=0 ; j<jH+1 ; ++j) {
+        complex<double> H_local = localDotProduct(V(j, all), w), H_global;
+        timer.reduceSum(&H_local, &H_global, 1, MPI::DOUBLE_COMPLEX);
+        h(j) = H_global;
+        w -= static_cast<T>(H_global) * V(j, all);
       }
-      dloo = sqrt(dloo);
       local_wnorm2 = squareNorm2(w);
-      MPI_Allreduce(&local_wnorm2, &wnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+      timer.reduceSum(&local_wnorm2, &wnorm2, 1, MPI::DOUBLE);
       wnorm2 = sqrt(abs(wnorm2));
 
-      H(jH+1, jH) = wnorm2;
-      if (jH<m) V(all, jH) = w / static_cast<T>(wnorm2);
-
-      // now we apply the GIVENS rotations
-      for (int j=1 ; j<jH ; ++j) {
-        temp = cs(j) * H(j,jH) + conjScalar(sn(j)) * H(j+1,jH);
-        H(j+1,jH) = cs(j) * H(j+1,jH) - conjScalar(sn(j)) * H(j,jH);
-        H(j,jH) = temp;
-      }
-
-      // form jH-th rotation matrix
-      T auxHjj = H(jH,jH), auxHjp1j= H(jH+1,jH), temp;
-      rotmat(temp, sn(jH), auxHjj, auxHjp1j);
-      cs(jH)= temp;
-
-      temp = cs(jH) * H(jH, m+1) + conjScalar(sn(jH)) * H(jH+1, m+1);
-      H(jH+1, m+1) = cs(jH) * H(jH+1, m+1) - conjScalar(sn(jH)) * H(jH, m+1);
-      H(jH, m+1) = temp;
+      h(jH+1) = wnorm2;
+      if (wnorm2>0.0) V(jH+1, all) = w / static_cast<T>(wnorm2);
+      N_steps++;
 
-      temp = cs(jH) * H(jH, jH) + conjScalar(sn(jH)) * H(jH+1, jH);
-      H(jH+1, jH) = 0.0;
-      H(jH, jH) = temp;
-
-      // approximate residual norm
-      s(jH) = H(jH+1, m+1);
-      s(jH-1) = H(jH, m+1);
-      error = abs(s(jH)) / bnorm2;
-      /*error = abs(H(jH+1, m+1));*/
+      // approximate residual norm, from the rotated Hessenberg matrix
+      error = leastSquares.addColumn(jH, h) / bnorm2;
       ofs << error << endl;
-
-      // update approximation x
-      if ( error<=tol ) {
-        y.resize(jH); // Range: 0..jH-1
-        blitz::Array<T, 2> H2(jH, jH);
-        H2 = H(blitz::Range(1, jH), blitz::Range(1, jH));
-        triangleUpSolve( y, H2, s(blitz::Range(0, jH-1)) );
-        x += matrixMultiply(V(all, blitz::Range(0, jH-1)), y);
-        ofs.close();
-        return;
-      }
+      timer.writeIteration(error);
+      if ( (error<=tol) || (wnorm2==0.0) ) break;
     } // end for (jH =...)
-    if ( error<=tol ) {
-      ofs.close();
-      return;
-    }
-    y.resize(m); // Range: 0..m-1
-    blitz::Array<T, 2> H2(m, m);
-    H2 = H(blitz::Range(1, m), blitz::Range(1, m));
-    triangleUpSolve( y, H2, s(blitz::Range(0, m-1)) );
-    x += matrixMultiply(V(all, blitz::Range(0, m-1)), y);
-    rTmp = b - matvec(x);
-    r = psolve(rTmp);
-    local_rnorm2 = squareNorm2(r);
-    MPI_Allreduce(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
-    rnorm2 = sqrt(abs(rnorm2));
-    s(m) = abs(rnorm2);
-    // check convergence
-    error = abs(s(m)) / bnorm2;
-    ofs << "intermediate error " << error << endl;
+
+    // update approximation x
+    leastSquares.solve(y, N_steps);
+    addBasisCombination(x, V, y, N_steps);
     if ( error<=tol ) {
       ofs.close();
       return;
@@ -475,6 +674,171 @@ void gmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
   }
 }
 
+/** Left preconditioned GMRES for several right-hand sides, the rows of B. The systems are
+ *  iterated in lockstep: each step makes one block matvec and one block psolve for all the
+ *  systems still iterating, and the Gram-Schmidt reductions of all of them go in one message.
+ *  Each system keeps its own Krylov basis and least-squares problem, and drops out of the
+ *  block when it has converged, so the iterates are those of gmres run on each system.
+ *  The timing log is that of the first system, with the largest error of the step.
+ */
+template <typename T, typename TClassA, typename TClassB>
+void gmresMultipleRHS(blitz::Array<T, 2>& X, /**< OUTPUT: converged solutions, one per row */
+                      blitz::Array<double, 1>& errors, /**< OUTPUT: the errors */
+                      blitz::Array<int, 1>& iters, /**< OUTPUT: numbers of iterations needed */
+                      blitz::Array<int, 1>& flags, /**< OUTPUT: success flags: 0 if OK */
+                      BlockMatvecFunctor<T, TClassA> matvec, /**< INPUT: block matvec functor */
+                      BlockPrecondFunctor<T, TClassB> psolve, /**< INPUT: block precond functor */
+                      const blitz::Array<T, 2>& B, /**< INPUT: right-hand sides, one per row */
+                      const double tol, /**< INPUT: tolerance on solution */
+                      const int RESTRT, /**< INPUT: restart number */
+                      const int MAXITER, /**< INPUT: max number of iterations */
+                      const int my_id, /**< INPUT: the process ID */
+                      const int num_proc, /**< INPUT: the number of processes */
+                      const std::vector<string>& convergenceDetailedOutputs) /**< INPUT: one file per system */
+{
+  const int K = B.extent(0), N_local = B.extent(1), m = RESTRT;
+  if (RESTRT < 1) {
+    std::cout << "Bad restart value. RESTRT = " << RESTRT << std::endl;
+    exit(1);
+  }
+  if (MAXITER < 1) {
+    std::cout << "Bad maxiter value. MAXITER = " << MAXITER << std::endl;
+    exit(1);
+  }
+  std::vector<std::ofstream *> ofs(K);
+  for (int s=0 ; s<K ; ++s) {
+    ofs[s] = new std::ofstream(convergenceDetailedOutputs[s].c_str());
+    if (! ofs[s]->is_open()) {
+      cout << "error opening " << convergenceDetailedOutputs[s] << endl;
+      exit(1);
+    }
+    ofs[s]->precision(8);
+    *ofs[s] << "# GMRES algorithm, multiple right-hand sides" << endl;
+    *ofs[s] << "# output showing the convergence for tol = " << tol << endl;
+  }
+  SolverTimer timer(convergenceDetailedOutputs[0], "GMRES", my_id);
+
+  blitz::Range all = blitz::Range::all();
+  errors.resize(K);
+  iters.resize(K);
+  flags.resize(K);
+  errors = 1.0;
+  iters = MAXITER;
+  flags = 1;
+
+  blitz::Array<double, 1> local_norms2(K), norms2(K), bnorm2(K);
+  for (int s=0 ; s<K ; ++s) local_norms2(s) = squareNorm2(B(s, all));
+  timer.reduceSum(local_norms2.data(), norms2.data(), K, MPI::DOUBLE);
+  for (int s=0 ; s<K ; ++s) bnorm2(s) = (norms2(s)==0.0) ? 1.0 : sqrt(abs(norms2(s)));
+
+  // the basis vectors of system s are the rows of V[s]
+  std::vector< blitz::Array<T, 2> > V(K);
+  std::vector<HessenbergLeastSquares> leastSquares;
+  leastSquares.reserve(K);
+  for (int s=0 ; s<K ; ++s) {
+    V[s].resize(m+1, N_local);
+    leastSquares.push_back(HessenbergLeastSquares(m));
+  }
+  std::vector<int> active(K), N_steps(K, 0);
+  for (int s=0 ; s<K ; ++s) active[s] = s;
+  blitz::Array<std::complex<double>, 1> y;
+
+  for (int iter=0 ; (iter<MAXITER) && (active.size()>0) ; iter++) {
+    const int K_active = active.size();
+    blitz::Array<T, 2> XA(K_active, N_local), RA(K_active, N_local);
+    for (int a=0 ; a<K_active ; ++a) XA(a, all) = X(active[a], all);
+    blitz::Array<T, 2> AX(timer.matvec(matvec, XA));
+    for (int a=0 ; a<K_active ; ++a) RA(a, all) = B(active[a], all) - AX(a, all);
+    blitz::Array<T, 2> R(timer.psolve(psolve, RA));
+    blitz::Array<double, 1> local_rnorms2(K_active), rnorms2(K_active);
+    for (int a=0 ; a<K_active ; ++a) local_rnorms2(a) = squareNorm2(R(a, all));
+    timer.reduceSum(local_rnorms2.data(), rnorms2.data(), K_active, MPI::DOUBLE);
+    // check convergence of the previous cycle, and start the new one
+    std::vector<int> stepping;
+    for (int a=0 ; a<K_active ; ++a) {
+      const int s = active[a];
+      const double rnorm2 = sqrt(abs(rnorms2(a)));
+      if (iter>0) {
+        errors(s) = rnorm2 / bnorm2(s);
+        *ofs[s] << "intermediate error " << errors(s) << endl;
+        if ( (errors(s)<=tol) || (rnorm2==0.0) ) {
+          iters(s) = iter;
+          flags(s) = 0;
+          continue;
+        }
+      }
+      V[s](0, all) = R(a, all)/static_cast<T>(rnorm2);
+      leastSquares[s].reset(rnorm2);
+      N_steps[s] = 0;
+      stepping.push_back(s);
+    }
+    active = stepping;
+
+    for (int jH=0 ; (jH<m) && (stepping.size()>0) ; ++jH) {
+      // if preconditioning: w = M^(-1) * (A*V(jH, all)), for all the stepping systems
+      const int K_stepping = stepping.size();
+      blitz::Array<T, 2> VS(K_stepping, N_local);
+      for (int a=0 ; a<K_stepping ; ++a) VS(a, all) = V[stepping[a]](jH, all);
+      blitz::Array<T, 2> WTmp(timer.matvec(matvec, VS));
+      blitz::Array<T, 2> W(timer.psolve(psolve, WTmp));
+      VS.free();
+      WTmp.free();
+
+      // construct the orthonormal bases using Modified Gram-Schmidt
+      blitz::Array<std::complex<double>, 2> h(K_stepping, m+1);
+      blitz::Array<std::complex<double>, 1> H_local(K_stepping), H_global(K_stepping);
+      for (int j=0 ; j<jH+1 ; ++j) {
+        for (int a=0 ; a<K_stepping ; ++a) H_local(a) = localDotProduct(V[stepping[a]](j, all), W(a, all));
+        timer.reduceSum(H_local.data(), H_global.data(), K_stepping, MPI::DOUBLE_COMPLEX);
+        for (int a=0 ; a<K_stepping ; ++a) {
+          h(a, j) = H_global(a);
+          W(a, all) -= static_cast<T>(H_global(a)) * V[stepping[a]](j, all);
+        }
+      }
+      blitz::Array<double, 1> local_wnorms2(K_stepping), wnorms2(K_stepping);
+      for (int a=0 ; a<K_stepping ; ++a) local_wnorms2(a) = squareNorm2(W(a, all));
+      timer.reduceSum(local_wnorms2.data(), wnorms2.data(), K_stepping, MPI::DOUBLE);
+
+      std::vector<int> stillStepping;
+      double maxError = 0.0;
+      for (int a=0 ; a<K_stepping ; ++a) {
+        const int s = stepping[a];
+        const double wnorm2 = sqrt(abs(wnorms2(a)));
+        h(a, jH+1) = wnorm2;
+        if (wnorm2>0.0) V[s](jH+1, all) = W(a, all) / static_cast<T>(wnorm2);
+        N_steps[s]++;
+        // approximate residual norm, from the rotated Hessenberg matrix
+        errors(s) = leastSquares[s].addColumn(jH, h(a, all)) / bnorm2(s);
+        *ofs[s] << errors(s) << endl;
+        maxError = max(maxError, errors(s));
+        if ( (errors(s)>tol) && (wnorm2>0.0) ) stillStepping.push_back(s);
+      }
+      timer.writeIteration(maxError);
+      stepping = stillStepping;
+    } // end for (jH =...)
+
+    // update approximations x
+    std::vector<int> stillActive;
+    for (unsigned int a=0 ; a<active.size() ; ++a) {
+      const int s = active[a];
+      leastSquares[s].solve(y, N_steps[s]);
+      blitz::Array<T, 1> x(X(s, all));
+      addBasisCombination(x, V[s], y, N_steps[s]);
+      if ( errors(s)<=tol ) {
+        iters(s) = iter;
+        flags(s) = 0;
+      }
+      else stillActive.push_back(s);
+    }
+    active = stillActive;
+  } // end for (iter =...)
+
+  for (int s=0 ; s<K ; ++s) {
+    ofs[s]->close();
+    delete ofs[s];
+  }
+}
+
 // right preconditioned or flexible GMRES
 template <typename T, typename TClassA, typename TClassB>
 void fgmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
@@ -499,6 +863,7 @@ void fgmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
   ofs.precision(8);
   ofs << "# FGMRES algorithm" << endl;
   ofs << "# output showing the convergence for tol = " << tol << endl;
+  SolverTimer timer(convergenceDetailedOutput, "FGMRES", my_id);
 
   blitz::Range all = blitz::Range::all();
   flag = 0;
@@ -516,119 +881,514 @@ void fgmres(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
 
   double bnorm2, local_bnorm2, rnorm2, local_rnorm2, wnorm2, local_wnorm2;
   local_bnorm2 = squareNorm2(b);
-  MPI_Allreduce(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+  timer.reduceSum(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE);
   bnorm2 = sqrt(abs(bnorm2));
   if (bnorm2==0.0) bnorm2 = 1.0;
 
-  T temp;
-  blitz::Array<T, 1> rTmp(N_local), r(N_local);
-
-  // workspaces definitions
-  blitz::Array<T, 1> cs(blitz::Range(1, m)), sn(blitz::Range(1, m)), s(m+1), wTmp(N_local), w(N_local), y;
-  blitz::Array<T, 2> V(N_local, m+1), Z(N_local, m+1), H(blitz::Range(1, m+1), blitz::Range(1, m+1));
+  blitz::Array<T, 1> r(N_local), w(N_local);
+  // the basis vectors are the rows of V and Z, so that each of them is contiguous
+  blitz::Array<T, 2> V(m+1, N_local), Z(m, N_local);
+  HessenbergLeastSquares leastSquares(m);
+  blitz::Array<std::complex<double>, 1> h(m+1), y;
 
   for (iter=0 ; iter<MAXITER ; iter++) {
-    r = b - matvec(x);
+    r = b - timer.matvec(matvec, x);
     local_rnorm2 = squareNorm2(r);
-    MPI_Allreduce(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+    timer.reduceSum(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE);
     rnorm2 = sqrt(abs(rnorm2));
-    V(all, 0) = r/static_cast<T>(rnorm2);
-    s = 0.0;
-    s(0) = static_cast<T>(rnorm2);
-
-    H = 0.0;
-    H(1, m+1) = rnorm2;
-
-    for (int jH=1 ; jH<m+1 ; ++jH){
-      // if right preconditioning: z = M^-1 * V(all, jH)
-      Z(all, jH-1) = psolve(V(all, jH-1));
-      w = matvec(Z(all, jH-1));
+    // check convergence of the previous cycle
+    if (iter>0) {
+      error = rnorm2 / bnorm2;
+      ofs << "intermediate error " << error << endl;
+      if ( (error<=tol) || (rnorm2==0.0) ) {
+        ofs.close();
+        return;
+      }
+    }
+    V(0, all) = r/static_cast<T>(rnorm2);
+    leastSquares.reset(rnorm2);
 
-      for (int j=1 ; j<jH+1 ; ++j) H(j, jH) = 0.0;
+    int N_steps = 0;
+    for (int jH=0 ; jH<m ; ++jH){
+      // if right preconditioning: z = M^-1 * V(jH, all)
+      Z(jH, all) = timer.psolve(psolve, V(jH, all));
+      w = timer.matvec(matvec, Z(jH, all));
 
       // construct orthonormal basis using Modified Gram-Schmidt
-      T dloo = 0.0;
-      for (int j=1 ; j<jH+1 ; ++j) {
-        complex<double> H_local = sum(w * conjArray(V(all, j-1))), H_global;
-        MPI_Allreduce(&H_local, &H_global, 1, MPI::DOUBLE_COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-        H(j, jH) = H_global;
-        w -= H(j, jH) * V(all, j-1);
-        dloo += abs(H_global)*abs(H_global);
+      for (int j=0 ; j<jH+1 ; ++j) {
+        complex<double> H_local = localDotProduct(V(j, all), w), H_global;
+        timer.reduceSum(&H_local, &H_global, 1, MPI::DOUBLE_COMPLEX);
+        h(j) = H_global;
+        w -= static_cast<T>(H_global) * V(j, all);
       }
-      dloo = sqrt(dloo);
       local_wnorm2 = squareNorm2(w);
-      MPI_Allreduce(&local_wnorm2, &wnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+      timer.reduceSum(&local_wnorm2, &wnorm2, 1, MPI::DOUBLE);
       wnorm2 = sqrt(abs(wnorm2));
 
-      H(jH+1, jH) = wnorm2;
-      if (jH<m) V(all, jH) = w / static_cast<T>(wnorm2);
+      h(jH+1) = wnorm2;
+      if (wnorm2>0.0) V(jH+1, all) = w / static_cast<T>(wnorm2);
+      N_steps++;
+
+      // approximate residual norm, from the rotated Hessenberg matrix
+      error = leastSquares.addColumn(jH, h) / bnorm2;
+      ofs << error << endl;
+      timer.writeIteration(error);
+      if ( (error<=tol) || (wnorm2==0.0) ) break;
+    } // end for (jH =...)
+
+    // update approximation x
+    leastSquares.solve(y, N_steps);
+    addBasisCombination(x, Z, y, N_steps);
+    if ( error<=tol ) {
+      ofs.close();
+      return;
+    }
+  } // end for (iter =...)
+
+  // bad ending...
+  if (error>tol) {
+    ofs.close();
+    flag = 1;
+  }
+}
+
+// small dense complex algebra for the recycled GMRES. The sizes are those of the Krylov
+// subspace (a few tens), so that simple O(n^3) algorithms are enough.
+inline int denseSolve(blitz::Array<std::complex<double>, 2>& X, /**< OUTPUT: the n x p solution */
+                      const blitz::Array<std::complex<double>, 2>& A, /**< INPUT: the n x n matrix */
+                      const blitz::Array<std::complex<double>, 2>& B) /**< INPUT: the n x p right-hand sides */
+/** solves \f$ A X = B \f$ by Gaussian elimination with partial pivoting. Returns 1 if A is singular, 0 otherwise */
+{
+  const int n = A.extent(0), p = B.extent(1);
+  blitz::Array<std::complex<double>, 2> LU(n, n);
+  X.resize(n, p);
+  for (int i=0 ; i<n ; ++i) {
+    for (int j=0 ; j<n ; ++j) LU(i, j) = A(i, j);
+    for (int j=0 ; j<p ; ++j) X(i, j) = B(i, j);
+  }
+  for (int k=0 ; k<n ; ++k) {
+    int pivot = k;
+    for (int i=k+1 ; i<n ; ++i) {
+      if (abs(LU(i, k)) > abs(LU(pivot, k))) pivot = i;
+    }
+    if (abs(LU(pivot, k))==0.0) return 1;
+    if (pivot!=k) {
+      for (int j=0 ; j<n ; ++j) std::swap(LU(k, j), LU(pivot, j));
+      for (int j=0 ; j<p ; ++j) std::swap(X(k, j), X(pivot, j));
+    }
+    for (int i=k+1 ; i<n ; ++i) {
+      const std::complex<double> factor = LU(i, k) / LU(k, k);
+      for (int j=k ; j<n ; ++j) LU(i, j) -= factor * LU(k, j);
+      for (int j=0 ; j<p ; ++j) X(i, j) -= factor * X(k, j);
+    }
+  }
+  for (int k=n-1 ; k>-1 ; k--) {
+    for (int j=0 ; j<p ; ++j) {
+      for (int i=k+1 ; i<n ; ++i) X(k, j) -= LU(k, i) * X(i, j);
+      X(k, j) /= LU(k, k);
+    }
+  }
+  return 0;
+}
 
-      // now we apply the GIVENS rotations
-      for (int j=1 ; j<jH ; ++j) {
-        temp = cs(j) * H(j,jH) + conjScalar(sn(j)) * H(j+1,jH);
-        H(j+1,jH) = cs(j) * H(j+1,jH) - conjScalar(sn(j)) * H(j,jH);
-        H(j,jH) = temp;
+inline void denseEigen(blitz::Array<std::complex<double>, 1>& lambda, /**< OUTPUT: the eigenvalues */
+                       blitz::Array<std::complex<double>, 2>& E, /**< OUTPUT: the unit eigenvectors, in columns */
+                       const blitz::Array<std::complex<double>, 2>& A) /**< INPUT: the n x n matrix */
+/**
+ * Eigenvalues and eigenvectors of a small dense complex matrix: Householder reduction to the
+ * Hessenberg form, shifted QR iterations towards the Schur form \f$ A = Z T Z^H \f$, and
+ * back-substitution in the triangular \f$ T \f$ for the eigenvectors.
+ */
+{
+  const int n = A.extent(0);
+  const double eps = std::numeric_limits<double>::epsilon();
+  blitz::Array<std::complex<double>, 2> H(n, n), Z(n, n);
+  blitz::Array<std::complex<double>, 1> v(n), cs(n), sn(n), y(n);
+  lambda.resize(n);
+  E.resize(n, n);
+  for (int i=0 ; i<n ; ++i) {
+    for (int j=0 ; j<n ; ++j) {
+      H(i, j) = A(i, j);
+      Z(i, j) = (i==j) ? 1.0 : 0.0;
+    }
+  }
+  // Hessenberg reduction: H = P H P and Z = Z P, with P = I - 2 v v^H
+  for (int k=0 ; k<n-2 ; ++k) {
+    double xnorm = 0.0;
+    for (int i=k+1 ; i<n ; ++i) xnorm += norm(H(i, k));
+    xnorm = sqrt(xnorm);
+    if (xnorm==0.0) continue;
+    const std::complex<double> phase = (abs(H(k+1, k))>0.0) ? H(k+1, k)/abs(H(k+1, k)) : std::complex<double>(1.0, 0.0);
+    double vnorm = 0.0;
+    for (int i=k+1 ; i<n ; ++i) v(i) = H(i, k);
+    v(k+1) += phase * xnorm;
+    for (int i=k+1 ; i<n ; ++i) vnorm += norm(v(i));
+    vnorm = sqrt(vnorm);
+    for (int i=k+1 ; i<n ; ++i) v(i) /= vnorm;
+    for (int j=0 ; j<n ; ++j) {
+      std::complex<double> s = 0.0;
+      for (int i=k+1 ; i<n ; ++i) s += conj(v(i)) * H(i, j);
+      for (int i=k+1 ; i<n ; ++i) H(i, j) -= 2.0 * v(i) * s;
+    }
+    for (int i=0 ; i<n ; ++i) {
+      std::complex<double> s = 0.0, t = 0.0;
+      for (int j=k+1 ; j<n ; ++j) {
+        s += H(i, j) * v(j);
+        t += Z(i, j) * v(j);
       }
+      for (int j=k+1 ; j<n ; ++j) {
+        H(i, j) -= 2.0 * s * conj(v(j));
+        Z(i, j) -= 2.0 * t * conj(v(j));
+      }
+    }
+    for (int i=k+2 ; i<n ; ++i) H(i, k) = 0.0;
+  }
+  // shifted QR iterations on the active window H(l:hi, l:hi)
+  int hi = n-1, iterations = 0;
+  while (hi>0) {
+    int l = hi;
+    while (l>0) {
+      if (abs(H(l, l-1)) <= eps * (abs(H(l-1, l-1)) + abs(H(l, l)))) {
+        H(l, l-1) = 0.0;
+        break;
+      }
+      l--;
+    }
+    if (l==hi) {
+      hi--;
+      iterations = 0;
+      continue;
+    }
+    if (iterations > 30*n) break; // the Schur form is then only approximate
+    iterations++;
+    // Wilkinson shift, with an exceptional shift from time to time
+    const std::complex<double> a = H(hi-1, hi-1), b = H(hi-1, hi), c = H(hi, hi-1), d = H(hi, hi);
+    const std::complex<double> disc = sqrt(0.25 * (a-d) * (a-d) + b * c);
+    std::complex<double> shift = 0.5 * (a+d) + disc;
+    if (abs(0.5 * (a+d) - disc - d) < abs(shift - d)) shift = 0.5 * (a+d) - disc;
+    if (iterations % 10 == 0) shift += abs(c);
+    for (int i=l ; i<=hi ; ++i) H(i, i) -= shift;
+    for (int k=l ; k<hi ; ++k) {
+      const double r = sqrt(norm(H(k, k)) + norm(H(k+1, k)));
+      cs(k) = (r>0.0) ? H(k, k)/r : std::complex<double>(1.0, 0.0);
+      sn(k) = (r>0.0) ? H(k+1, k)/r : std::complex<double>(0.0, 0.0);
+      for (int j=k ; j<n ; ++j) {
+        const std::complex<double> hk = H(k, j), hk1 = H(k+1, j);
+        H(k, j) = conj(cs(k)) * hk + conj(sn(k)) * hk1;
+        H(k+1, j) = -sn(k) * hk + cs(k) * hk1;
+      }
+    }
+    for (int k=l ; k<hi ; ++k) {
+      for (int i=0 ; i<=k+1 ; ++i) {
+        const std::complex<double> hk = H(i, k), hk1 = H(i, k+1);
+        H(i, k) = hk * cs(k) + hk1 * sn(k);
+        H(i, k+1) = -hk * conj(sn(k)) + hk1 * conj(cs(k));
+      }
+      for (int i=0 ; i<n ; ++i) {
+        const std::complex<double> zk = Z(i, k), zk1 = Z(i, k+1);
+        Z(i, k) = zk * cs(k) + zk1 * sn(k);
+        Z(i, k+1) = -zk * conj(sn(k)) + zk1 * conj(cs(k));
+      }
+    }
+    for (int i=l ; i<=hi ; ++i) H(i, i) += shift;
+  }
+  // eigenvectors of the triangular T = H, then back to the original basis
+  double Tnorm = 0.0;
+  for (int i=0 ; i<n ; ++i) {
+    for (int j=i ; j<n ; ++j) Tnorm = max(Tnorm, abs(H(i, j)));
+  }
+  const double small = (Tnorm>0.0) ? eps * Tnorm : eps;
+  for (int k=0 ; k<n ; ++k) {
+    lambda(k) = H(k, k);
+    for (int i=0 ; i<n ; ++i) y(i) = 0.0;
+    y(k) = 1.0;
+    for (int i=k-1 ; i>-1 ; i--) {
+      std::complex<double> s = 0.0, denom = H(i, i) - H(k, k);
+      for (int j=i+1 ; j<=k ; ++j) s += H(i, j) * y(j);
+      if (abs(denom) < small) denom = small;
+      y(i) = -s / denom;
+    }
+    double enorm = 0.0;
+    for (int i=0 ; i<n ; ++i) {
+      E(i, k) = 0.0;
+      for (int j=0 ; j<=k ; ++j) E(i, k) += Z(i, j) * y(j);
+      enorm += norm(E(i, k));
+    }
+    enorm = sqrt(enorm);
+    for (int i=0 ; i<n ; ++i) E(i, k) /= enorm;
+  }
+}
 
-      // form jH-th rotation matrix
-      T auxHjj = H(jH,jH), auxHjp1j= H(jH+1,jH), temp;
-      rotmat(temp, sn(jH), auxHjj, auxHjp1j);
-      cs(jH)= temp;
+/** The recycled subspace of GCRO-DR: \f$ C = M^{-1} A U \f$, with \f$ C^H C = I \f$.
+ *  It is kept between successive calls of \c gcrodr for right-hand sides sharing the same
+ *  (preconditioned) operator, for example the incidence angles of a monostatic RCS.
+ */
+template <typename T>
+class RecycledSubspace
+{
+  public:
+    int K; /**< the wanted dimension of the subspace */
+    int k; /**< its current dimension, 0 before the first solve */
+    blitz::Array<T, 2> U; /**< K x N_local, only the k first rows are used */
+    blitz::Array<T, 2> C; /**< K x N_local, only the k first rows are used */
 
-      temp = cs(jH) * H(jH, m+1) + conjScalar(sn(jH)) * H(jH+1, m+1);
-      H(jH+1, m+1) = cs(jH) * H(jH+1, m+1) - conjScalar(sn(jH)) * H(jH, m+1);
-      H(jH, m+1) = temp;
+    /// constructor
+    RecycledSubspace(const int N_local, const int dimension) {K = dimension; k = 0; U.resize(max(K, 1), N_local); C.resize(max(K, 1), N_local);};
+    ~RecycledSubspace(void){};
+};
 
-      temp = cs(jH) * H(jH, jH) + conjScalar(sn(jH)) * H(jH+1, jH);
-      H(jH+1, jH) = 0.0;
-      H(jH, jH) = temp;
+template <typename T>
+void recycledSubspaceUpdate(RecycledSubspace<T>& recycled, /**< INPUT/OUTPUT: the recycled subspace */
+                            const blitz::Array<T, 2>& V, /**< INPUT: the Arnoldi vectors, j+1 rows used */
+                            const blitz::Array<std::complex<double>, 2>& Hbar, /**< INPUT: the (j+1) x j Hessenberg matrix */
+                            const blitz::Array<std::complex<double>, 2>& B, /**< INPUT: the k x j matrix C^H M^{-1} A V */
+                            const int j) /**< INPUT: the number of Arnoldi steps of the cycle */
+/**
+ * Harmonic Ritz update of the recycled subspace at the end of a GCRO-DR cycle, see
+ * Parks et al., "Recycling Krylov subspaces for sequences of linear systems", SIAM J. Sci.
+ * Comput. 28(5), 2006. With \f$ \hat{W} = [\tilde{U}, V_j] \f$ and \f$ \hat{V} = [C, V_{j+1}] \f$,
+ * we have \f$ M^{-1} A \hat{W} = \hat{V} G \f$. The new subspace is spanned by the K harmonic
+ * Ritz vectors \f$ \hat{W} z \f$ of smallest \f$ |\theta| \f$, where
+ * \f$ G^H G z = \theta G^H \hat{V}^H \hat{W} z \f$.
+ *
+ * The small dense problems are solved redundantly by all the processes.
+ */
+{
+  blitz::Range all = blitz::Range::all();
+  const int k = recycled.k, n = k + j, N_local = V.extent(1);
+  const int kNew = min(recycled.K, n);
+  if (kNew < 1) return;
+  // C^H U, V^H U and the squared norms of the columns of U, in one reduction
+  const int N_products = (k + j + 1) * k + k;
+  std::vector< std::complex<double> > local_products(max(N_products, 1)), products(max(N_products, 1));
+  for (int l=0 ; l<k ; ++l) {
+    for (int i=0 ; i<k ; ++i) local_products[i*k + l] = localDotProduct(recycled.C(i, all), recycled.U(l, all));
+    for (int i=0 ; i<=j ; ++i) local_products[k*k + i*k + l] = localDotProduct(V(i, all), recycled.U(l, all));
+    local_products[(k+j+1)*k + l] = localDotProduct(recycled.U(l, all), recycled.U(l, all));
+  }
+  if (N_products>0) MPI_Allreduce(&local_products[0], &products[0], N_products, MPI::DOUBLE_COMPLEX, MPI::SUM, MPI::COMM_WORLD);
+  blitz::Array<double, 1> d(max(k, 1));
+  for (int l=0 ; l<k ; ++l) d(l) = sqrt(real(products[(k+j+1)*k + l]));
+  // G and W = \hat{V}^H \hat{W}, with \tilde{U} = U D^{-1} having unit columns
+  blitz::Array<std::complex<double>, 2> G(n+1, n), W(n+1, n);
+  G = 0.0;
+  W = 0.0;
+  for (int l=0 ; l<k ; ++l) {
+    G(l, l) = 1.0/d(l);
+    for (int i=0 ; i<j ; ++i) G(l, k+i) = B(l, i);
+    for (int i=0 ; i<k ; ++i) W(i, l) = products[i*k + l]/d(l);
+    for (int i=0 ; i<=j ; ++i) W(k+i, l) = products[k*k + i*k + l]/d(l);
+  }
+  for (int i=0 ; i<=j ; ++i) {
+    for (int l=0 ; l<j ; ++l) G(k+i, k+l) = Hbar(i, l);
+  }
+  for (int i=0 ; i<j ; ++i) W(k+i, k+i) = 1.0;
+  // the generalized eigenproblem, as the standard (G^H G)^{-1} G^H W z = z/theta
+  blitz::Array<std::complex<double>, 2> GHG(n, n), GHW(n, n), M, Z;
+  for (int i=0 ; i<n ; ++i) {
+    for (int l=0 ; l<n ; ++l) {
+      GHG(i, l) = 0.0;
+      GHW(i, l) = 0.0;
+      for (int q=0 ; q<n+1 ; ++q) {
+        GHG(i, l) += conj(G(q, i)) * G(q, l);
+        GHW(i, l) += conj(G(q, i)) * W(q, l);
+      }
+    }
+  }
+  if (denseSolve(M, GHG, GHW)!=0) return; // we keep the previous subspace
+  blitz::Array<std::complex<double>, 1> mu;
+  denseEigen(mu, Z, M);
+  // the kNew vectors of largest |mu| = 1/|theta|
+  blitz::Array<std::complex<double>, 2> P(n, kNew);
+  blitz::Array<int, 1> isSelected(n);
+  isSelected = 0;
+  for (int i=0 ; i<kNew ; ++i) {
+    int index = -1;
+    for (int l=0 ; l<n ; ++l) {
+      if ( (isSelected(l)==0) && ((index<0) || (abs(mu(l)) > abs(mu(index)))) ) index = l;
+    }
+    isSelected(index) = 1;
+    for (int l=0 ; l<n ; ++l) P(l, i) = Z(l, index);
+  }
+  // G P = Q R by modified Gram-Schmidt
+  blitz::Array<std::complex<double>, 2> Q(n+1, kNew), R(kNew, kNew);
+  R = 0.0;
+  for (int i=0 ; i<kNew ; ++i) {
+    for (int q=0 ; q<n+1 ; ++q) {
+      Q(q, i) = 0.0;
+      for (int l=0 ; l<n ; ++l) Q(q, i) += G(q, l) * P(l, i);
+    }
+    for (int l=0 ; l<i ; ++l) {
+      for (int q=0 ; q<n+1 ; ++q) R(l, i) += conj(Q(q, l)) * Q(q, i);
+      for (int q=0 ; q<n+1 ; ++q) Q(q, i) -= R(l, i) * Q(q, l);
+    }
+    double Rii = 0.0;
+    for (int q=0 ; q<n+1 ; ++q) Rii += norm(Q(q, i));
+    Rii = sqrt(Rii);
+    if (Rii <= std::numeric_limits<double>::epsilon() * abs(R(0, 0)) || Rii==0.0) return; // rank deficient: we keep the previous subspace
+    R(i, i) = Rii;
+    for (int q=0 ; q<n+1 ; ++q) Q(q, i) /= Rii;
+  }
+  // new C = \hat{V} Q and U = \hat{W} P R^{-1}, so that M^{-1} A U = C still holds
+  blitz::Array<T, 2> Unew(kNew, N_local), Cnew(kNew, N_local);
+  Unew = 0.0;
+  Cnew = 0.0;
+  for (int i=0 ; i<kNew ; ++i) {
+    for (int l=0 ; l<k ; ++l) {
+      Cnew(i, all) += static_cast<T>(Q(l, i)) * recycled.C(l, all);
+      Unew(i, all) += static_cast<T>(P(l, i)/d(l)) * recycled.U(l, all);
+    }
+    for (int l=0 ; l<=j ; ++l) Cnew(i, all) += static_cast<T>(Q(k+l, i)) * V(l, all);
+    for (int l=0 ; l<j ; ++l) Unew(i, all) += static_cast<T>(P(k+l, i)) * V(l, all);
+    for (int l=0 ; l<i ; ++l) Unew(i, all) -= static_cast<T>(R(l, i)) * Unew(l, all);
+    Unew(i, all) /= static_cast<T>(R(i, i));
+  }
+  recycled.U(blitz::Range(0, kNew-1), all) = Unew;
+  recycled.C(blitz::Range(0, kNew-1), all) = Cnew;
+  recycled.k = kNew;
+}
 
-      // approximate residual norm
-      s(jH) = H(jH+1, m+1);
-      s(jH-1) = H(jH, m+1);
-      error = abs(s(jH)) / bnorm2;
-      /*error = abs(H(jH+1, m+1));*/
-      ofs << error << endl;
+// left preconditioned GCRO-DR: GMRES with deflated restarts, whose deflation subspace is
+// recycled from one right-hand side to the next
+template <typename T, typename TClassA, typename TClassB>
+void gcrodr(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
+            double & error, /**< OUTPUT: the error */
+            int & iter, /**< OUTPUT: number of iterations needed */
+            int & flag, /**< OUTPUT: success flag: 0 if OK */
+            MatvecFunctor<T, TClassA> matvec, /**< INPUT: matvec functor */
+            PrecondFunctor<T, TClassB> psolve, /**< INPUT: precond functor */
+            const blitz::Array<T, 1>& b, /**< INPUT: right-hand side */
+            const double tol, /**< INPUT: tolerance on solution */
+            const int RESTRT, /**< INPUT: restart number, recycled subspace included */
+            const int MAXITER, /**< INPUT: max number of iterations */
+            const int my_id, /**< INPUT: the process ID */
+            const int num_proc, /**< INPUT: the number of processes */
+            RecycledSubspace<T>& recycled, /**< INPUT/OUTPUT: the recycled subspace */
+            const string convergenceDetailedOutput)
+{
+  std::ofstream ofs (convergenceDetailedOutput.c_str());
+  if (! ofs.is_open()) { 
+    cout << "error opening " << convergenceDetailedOutput << endl; 
+    exit(1);
+  }
+  ofs.precision(8);
+  ofs << "# GCRO-DR algorithm" << endl;
+  ofs << "# output showing the convergence for tol = " << tol << ", recycled subspace dimension = " << recycled.k << endl;
+  SolverTimer timer(convergenceDetailedOutput, "GCRODR", my_id);
 
-      // update approximation x
-      if ( error<=tol ) {
-        y.resize(jH); // Range: 0..jH-1
-        blitz::Array<T, 2> H2(jH, jH);
-        H2 = H(blitz::Range(1, jH), blitz::Range(1, jH));
-        triangleUpSolve( y, H2, s(blitz::Range(0, jH-1)) );
-        x += matrixMultiply(Z(all, blitz::Range(0, jH-1)), y);
-        ofs.close();
-        return;
+  blitz::Range all = blitz::Range::all();
+  flag = 0;
+  iter = 0;
+  const int N_local = x.extent(0);
+  // dimensions and other checks
+  if (RESTRT < 1) {
+    std::cout << "Bad restart value. RESTRT = " << RESTRT << std::endl;
+    exit(1);
+  }
+  if (MAXITER < 1) {
+    std::cout << "Bad maxiter value. MAXITER = " << MAXITER << std::endl;
+    exit(1);
+  }
+  if ( (recycled.K < 0) || (recycled.K >= RESTRT) ) {
+    std::cout << "Bad recycled subspace dimension. K = " << recycled.K << ", it must be smaller than RESTRT = " << RESTRT << std::endl;
+    exit(1);
+  }
+
+  double bnorm2, local_bnorm2, rnorm2, local_rnorm2, wnorm2, local_wnorm2;
+  local_bnorm2 = squareNorm2(b);
+  timer.reduceSum(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE);
+  bnorm2 = sqrt(abs(bnorm2));
+  if (bnorm2==0.0) bnorm2 = 1.0;
+
+  // workspaces definitions
+  blitz::Array<T, 1> rTmp(N_local), r(N_local), wTmp(N_local), w(N_local);
+  blitz::Array<T, 2> V(RESTRT+1, N_local); // one basis vector per row
+  blitz::Array<std::complex<double>, 2> Hbar(RESTRT+1, RESTRT), B(max(recycled.K, 1), RESTRT);
+  blitz::Array<std::complex<double>, 1> y;
+  HessenbergLeastSquares leastSquares(RESTRT);
+  std::vector< std::complex<double> > local_c(max(recycled.K, 1)), c(max(recycled.K, 1));
+
+  for (iter=0 ; iter<MAXITER ; iter++) {
+    rTmp = b - timer.matvec(matvec, x);
+    r = timer.psolve(psolve, rTmp);
+    const int k = recycled.k, m = RESTRT - k;
+    // projection onto the recycled subspace: x += U C^H r, r -= C C^H r
+    if (k>0) {
+      for (int l=0 ; l<k ; ++l) local_c[l] = localDotProduct(recycled.C(l, all), r);
+      timer.reduceSum(&local_c[0], &c[0], k, MPI::DOUBLE_COMPLEX);
+      for (int l=0 ; l<k ; ++l) {
+        x += static_cast<T>(c[l]) * recycled.U(l, all);
+        r -= static_cast<T>(c[l]) * recycled.C(l, all);
       }
-    } // end for (jH =...)
-    if ( error<=tol ) {
-      ofs.close();
-      return;
     }
-    y.resize(m); // Range: 0..m-1
-    blitz::Array<T, 2> H2(m, m);
-    H2 = H(blitz::Range(1, m), blitz::Range(1, m));
-    triangleUpSolve( y, H2, s(blitz::Range(0, m-1)) );
-    x += matrixMultiply(Z(all, blitz::Range(0, m-1)), y);
-    r = b - matvec(x);
     local_rnorm2 = squareNorm2(r);
-    MPI_Allreduce(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+    timer.reduceSum(&local_rnorm2, &rnorm2, 1, MPI::DOUBLE);
     rnorm2 = sqrt(abs(rnorm2));
-    s(m) = abs(rnorm2);
-    // check convergence
-    error = abs(s(m)) / bnorm2;
-    ofs << "intermediate error " << error << endl;
+    error = rnorm2 / bnorm2;
+    if (iter>0) ofs << "intermediate error " << error << endl;
+    if ( (error<=tol) || (rnorm2==0.0) ) {
+      ofs.close();
+      return;
+    }
+    V(0, all) = r/static_cast<T>(rnorm2);
+    leastSquares.reset(rnorm2);
+    Hbar = 0.0;
+
+    // Arnoldi on (I - C C^H) M^{-1} A
+    int N_steps = 0;
+    for (int jH=0 ; jH<m ; ++jH) {
+      wTmp = timer.matvec(matvec, V(jH, all));
+      w = timer.psolve(psolve, wTmp);
+      if (k>0) {
+        for (int l=0 ; l<k ; ++l) local_c[l] = localDotProduct(recycled.C(l, all), w);
+        timer.reduceSum(&local_c[0], &c[0], k, MPI::DOUBLE_COMPLEX);
+        for (int l=0 ; l<k ; ++l) {
+          B(l, jH) = c[l];
+          w -= static_cast<T>(c[l]) * recycled.C(l, all);
+        }
+      }
+      // Modified Gram-Schmidt
+      for (int i=0 ; i<=jH ; ++i) {
+        std::complex<double> H_local = localDotProduct(V(i, all), w), H_global;
+        timer.reduceSum(&H_local, &H_global, 1, MPI::DOUBLE_COMPLEX);
+        Hbar(i, jH) = H_global;
+        w -= static_cast<T>(H_global) * V(i, all);
+      }
+      local_wnorm2 = squareNorm2(w);
+      timer.reduceSum(&local_wnorm2, &wnorm2, 1, MPI::DOUBLE);
+      wnorm2 = sqrt(abs(wnorm2));
+      Hbar(jH+1, jH) = wnorm2;
+      if (wnorm2>0.0) V(jH+1, all) = w / static_cast<T>(wnorm2);
+      else V(jH+1, all) = 0.0; // lucky breakdown
+      N_steps++;
+
+      // approximate residual norm
+      error = leastSquares.addColumn(jH, Hbar(all, jH)) / bnorm2;
+      ofs << error << endl;
+      timer.writeIteration(error);
+      if ( (error<=tol) || (wnorm2==0.0) ) break;
+    } // end for (jH =...)
+
+    // update approximation x += V y - U B y
+    leastSquares.solve(y, N_steps);
+    addBasisCombination(x, V, y, N_steps);
+    for (int l=0 ; l<k ; ++l) {
+      std::complex<double> By = 0.0;
+      for (int i=0 ; i<N_steps ; ++i) By += B(l, i) * y(i);
+      x -= static_cast<T>(By) * recycled.U(l, all);
+    }
+    // the new recycled subspace serves the next cycle and the next right-hand side
+    recycledSubspaceUpdate(recycled, V, Hbar, B, N_steps);
     if ( error<=tol ) {
+      ofs << "# recycled subspace dimension at exit = " << recycled.k << endl;
       ofs.close();
       return;
     }
   } // end for (iter =...)
 
   // bad ending...
-  if (error>tol) {
-    ofs.close();
-    flag = 1;
-  }
+  ofs.close();
+  flag = 1;
 }
 
 // BICGSTAB
@@ -654,6 +1414,7 @@ void bicgstab(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
   ofs.precision(8);
   ofs << "# BiCGSTAB algorithm" << endl;
   ofs << "# output showing the convergence for tol = " << tol << endl;
+  SolverTimer timer(convergenceDetailedOutput, "BICGSTAB", my_id);
 
   flag = 0;
   iter = 0;
@@ -663,80 +1424,90 @@ void bicgstab(blitz::Array<T, 1>& x, /**< OUTPUT: converged solution */
     std::cout << "BiCGSTAB: Bad maxiter value. MAXITER = " << MAXITER << std::endl;
     exit(1);
   }
-  T alpha, omega, rho, rho_local, rho_1;
+  T alpha, omega, rho, rho_1;
   double bnorm2, snorm2, local_snorm2, local_bnorm2, local_error;
+  // the residual norm and rho = r_tld^H r are reduced together
+  std::complex<double> local_rr[2], rr[2];
+  MPI_Request request;
   // local arrays
   blitz::Array<T, 1> p(N_local), p_hat(N_local), r_tld(N_local), r(N_local), v(N_local), s(N_local), s_hat(N_local), t(N_local);
   local_bnorm2 = squareNorm2(b);
-  MPI_Allreduce(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+  timer.reduceSum(&local_bnorm2, &bnorm2, 1, MPI::DOUBLE);
   bnorm2 = sqrt(abs(bnorm2));
   if (bnorm2==0.0) bnorm2 = 1.0;
-  v = matvec(x); // v is used as a temporary vector here
+  v = timer.matvec(matvec, x); // v is used as a temporary vector here
   r = b - v;
   local_error = squareNorm2(r);
-  MPI_Allreduce(&local_error, &error, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+  timer.reduceSum(&local_error, &error, 1, MPI::DOUBLE);
+  rho = static_cast<T>(error); // since r_tld = r
   error = sqrt( abs(error) ) / bnorm2;
   ofs << error << endl;
+  timer.writeIteration(error);
 
   if ( error <= tol ) {ofs.close(); return;}
   omega  = 1.0;
   r_tld = r;
-  // beginning of the iterations
+  // beginning of the iterations. There are 4 global reductions per iteration instead of 6.
+  // That of ||s|| is overlapped with the preconditioner solve of s, which is thus wasted on the
+  // last iteration only; the others are needed right away and are blocking
   for (iter=1 ; iter<=MAXITER ; iter++) {
-    rho_local = sum(conjArray(r_tld) * r);
-    MPI_Allreduce(&rho_local, &rho, 1, MPI::COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-    
     if (rho==ZZERO) {ofs.close(); return;}
     if (iter==1) p = r;
     else{
       T beta  = ( rho/rho_1 )*( alpha/omega );
       p = r + beta*( p - omega*v );
     }
-    MPI_Barrier(MPI::COMM_WORLD);
-    p_hat = psolve(p);
-    v = matvec(p_hat);
-    T alpha_denom_local, alpha_denom;
-    alpha_denom_local = sum( conjArray(r_tld) * v );
-    MPI_Allreduce(&alpha_denom_local, &alpha_denom, 1, MPI::COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-    alpha = rho / alpha_denom;
+    p_hat = timer.psolve(psolve, p);
+    v = timer.matvec(matvec, p_hat);
+    std::complex<double> alpha_denom_local, alpha_denom;
+    alpha_denom_local = localDotProduct(r_tld, v);
+    timer.reduceSum(&alpha_denom_local, &alpha_denom, 1, MPI::DOUBLE_COMPLEX);
+    alpha = rho / static_cast<T>(alpha_denom);
     s = r - alpha*v;
+    // ||s|| travels while the preconditioner is applied to s
     local_snorm2 = squareNorm2(s);
-    MPI_Allreduce(&local_snorm2, &snorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+    timer.startReduceSum(&local_snorm2, &snorm2, 1, MPI::DOUBLE, &request);
+    s_hat = timer.psolve(psolve, s);
+    timer.waitReduceSum(&request);
     snorm2 = sqrt(abs(snorm2));
     if ( snorm2 / bnorm2 < tol ) {
       x += alpha*p_hat;
       error = snorm2 / bnorm2;
       ofs << error << endl;
+      timer.writeIteration(error);
       ofs.close();
       return;
     }
-    // stabilizer
-    s_hat = psolve(s);
-    t = matvec(s_hat);
-    T local_omega_num, omega_num, local_omega_denom, omega_denom;
-    local_omega_num = sum(conjArray(t) * s);
-    local_omega_denom = sum(conjArray(t) * t);
-    MPI_Allreduce(&local_omega_num, &omega_num, 1, MPI::COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-    MPI_Allreduce(&local_omega_denom, &omega_denom, 1, MPI::COMPLEX, MPI::SUM, MPI::COMM_WORLD);
-    omega = omega_num/omega_denom;
-    x += alpha*p_hat + omega*s_hat;
+    // stabilizer: omega numerator and denominator in one reduction
+    t = timer.matvec(matvec, s_hat);
+    std::complex<double> local_omega[2], omega_num_denom[2];
+    local_omega[0] = localDotProduct(t, s);
+    local_omega[1] = squareNorm2(t);
+    timer.reduceSum(local_omega, omega_num_denom, 2, MPI::DOUBLE_COMPLEX);
+    omega = static_cast<T>(omega_num_denom[0]/omega_num_denom[1]);
     r = s - omega*t;
-    local_error = squareNorm2(r);
-    MPI_Allreduce(&local_error, &error, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
-    error = sqrt( abs(error) ) / bnorm2;
+    // ||r|| and the next rho in one reduction
+    local_rr[0] = squareNorm2(r);
+    local_rr[1] = localDotProduct(r_tld, r);
+    timer.reduceSum(local_rr, rr, 2, MPI::DOUBLE_COMPLEX);
+    x += alpha*p_hat + omega*s_hat;
+    error = sqrt( abs(real(rr[0])) ) / bnorm2;
     ofs << error << endl;
+    timer.writeIteration(error);
+    rho_1 = rho;
+    rho = static_cast<T>(rr[1]);
 
     if ( error <= tol ) {ofs.close(); return;}
     if ( omega == ZZERO ) {ofs.close(); return;}
-    rho_1 = rho;
   } // end for
   local_snorm2 = squareNorm2(s);
-  MPI_Allreduce(&local_snorm2, &snorm2, 1, MPI::DOUBLE, MPI::SUM, MPI::COMM_WORLD);
+  timer.reduceSum(&local_snorm2, &snorm2, 1, MPI::DOUBLE);
   snorm2 = sqrt(abs(snorm2));
   if ( ( error <= tol ) || ( norm2( s ) <= tol ) ) { // converged
     if ( snorm2 / bnorm2 <= tol ) {
       error = snorm2 / bnorm2;
       ofs << error << endl;
+      timer.writeIteration(error);
     }
     flag = 0;
   }
@@ -25,8 +25,11 @@ Level::Level(const int l,
              const blitz::Array<double, 2>& cubes_centroids)
 {
   numberTimesCopied = 0;
+  numbersToIndexesShift = 32;
+  N_GaussOnTriangle = 0;
   level = l;
   DIRECTIONS_PARALLELIZATION = 0;
+  alphaTranslationsInterpolation = 0;
   cubeSideLength = leaf_side_length;
   maxNumberCubes1D = static_cast<int>(pow(2.0, level));
   int N_cubes_level_L = cubes_centroids.extent(0);
@@ -64,11 +67,14 @@ Level::Level(const int l,
 {
   const int my_id = MPI::COMM_WORLD.Get_rank();
   numberTimesCopied = 0;
+  numbersToIndexesShift = 32;
+  N_GaussOnTriangle = 0;
   k = waveNumber;
   level = l;
   leaf = true;
   ceiling = 0;
   DIRECTIONS_PARALLELIZATION = 0;
+  alphaTranslationsInterpolation = 0;
   N = N_expansion;
   cubeSideLength = leaf_side_length;
   maxNumberCubes1D = static_cast<int>(pow(2.0, level));
@@ -121,13 +127,30 @@ void Level::copyLevel(const Level & levelToCopy) // copy constructor
   k = levelToCopy.getK();
   cubes.resize(levelToCopy.cubes.size());
   for (unsigned int i=0 ; i<levelToCopy.cubes.size() ; ++i) cubes[i] = levelToCopy.cubes[i];
-  numbersToIndexes = levelToCopy.getNumbersToIndexes();
+  numbersToIndexesKeys = levelToCopy.getNumbersToIndexesKeys();
+  numbersToIndexesVals = levelToCopy.getNumbersToIndexesVals();
+  numbersToIndexesShift = levelToCopy.getNumbersToIndexesShift();
   localCubesIndexes = levelToCopy.getLocalCubesIndexes();
   listOfFcToBeReceived.resize(levelToCopy.getListOfFcToBeReceived().size());
   listOfFcToBeSent.resize(levelToCopy.getListOfFcToBeSent().size());
   listOfFcToBeReceived = levelToCopy.getListOfFcToBeReceived();
   listOfFcToBeSent = levelToCopy.getListOfFcToBeSent();
   cubesIndexesAfterReduction = levelToCopy.getCubesIndexesAfterReduction();
+  alphaTransParticipantsIndexes = levelToCopy.alphaTransParticipantsIndexes;
+  cubesSonsOffsets = levelToCopy.cubesSonsOffsets;
+  cubesSonsIndexes = levelToCopy.cubesSonsIndexes;
+  cubesSonsProcNumbers = levelToCopy.cubesSonsProcNumbers;
+  cubesNeighborsOffsets = levelToCopy.cubesNeighborsOffsets;
+  cubesNeighborsIndexes = levelToCopy.cubesNeighborsIndexes;
+  cubesRWG_numbers = levelToCopy.cubesRWG_numbers;
+  cubesRWG_numbers_CFIE_OK = levelToCopy.cubesRWG_numbers_CFIE_OK;
+  cubesTriangle_numberOfRWGs = levelToCopy.cubesTriangle_numberOfRWGs;
+  cubesTriangleToRWGindex = levelToCopy.cubesTriangleToRWGindex;
+  cubesTriangleToRWGweight = levelToCopy.cubesTriangleToRWGweight;
+  cubesTriangleToRWG_ropp = levelToCopy.cubesTriangleToRWG_ropp;
+  cubesTriangle_GaussCoord = levelToCopy.cubesTriangle_GaussCoord;
+  cubesTriangle_nHat = levelToCopy.cubesTriangle_nHat;
+  N_GaussOnTriangle = levelToCopy.N_GaussOnTriangle;
   const int N_theta = levelToCopy.getNThetas(), N_phi= levelToCopy.getNPhis();
   thetas.resize(N_theta);
   phis.resize(N_phi);
@@ -151,6 +174,18 @@ void Level::copyLevel(const Level & levelToCopy) // copy constructor
   }
   alphaTranslationsIndexes.resize(alphaTranslationsIndexes.extent(0), alphaTranslationsIndexes.extent(1), alphaTranslationsIndexes.extent(2), alphaTranslationsIndexes.extent(3));
   alphaTranslationsIndexes = levelToCopy.alphaTranslationsIndexes;
+  alphaTranslationsIndexesSwapXY.resize(levelToCopy.alphaTranslationsIndexesSwapXY.size());
+  alphaTranslationsIndexesSwapXY = levelToCopy.alphaTranslationsIndexesSwapXY;
+  alphaTranslationsCoarseCounts.resize(levelToCopy.alphaTranslationsCoarseCounts.shape());
+  alphaTranslationsCoarseCounts = levelToCopy.alphaTranslationsCoarseCounts;
+  alphaTranslationsInterpolation = levelToCopy.alphaTranslationsInterpolation;
+  alphaTranslationsInterpolationOrder = levelToCopy.alphaTranslationsInterpolationOrder;
+  alphaTranslationsInterpolationOversampling = levelToCopy.alphaTranslationsInterpolationOversampling;
+  alphaTranslationsDeltaGamma = levelToCopy.alphaTranslationsDeltaGamma;
+  alphaTranslationsKHats.resize(levelToCopy.alphaTranslationsKHats.extent(0), levelToCopy.alphaTranslationsKHats.extent(1));
+  alphaTranslationsKHats = levelToCopy.alphaTranslationsKHats;
+  alphaTranslationsWeights.resize(levelToCopy.alphaTranslationsWeights.size());
+  alphaTranslationsWeights = levelToCopy.alphaTranslationsWeights;
 
   shiftingArrays.resize(levelToCopy.shiftingArrays.size());
   for (int i=0; i<shiftingArrays.size(); i++) {
@@ -209,21 +244,23 @@ Level::Level(const Level & sonLevel,
 {
   const int my_id = MPI::COMM_WORLD.Get_rank();
   numberTimesCopied = 0;
+  numbersToIndexesShift = 32;
+  N_GaussOnTriangle = 0;
   N = N_expansion;
   k = sonLevel.getK();
   level = sonLevel.getLevel()-1;
   leaf = false; // because this level is created from a lower (finer) level...
   ceiling = 0; // default
   DIRECTIONS_PARALLELIZATION = 0; // default
+  alphaTranslationsInterpolation = 0; // default
   cubeSideLength = 2.0*sonLevel.getCubeSideLength();
   maxNumberCubes1D = sonLevel.getMaxNumberCubes1D()/2;
   if ( (my_id==0) && (VERBOSE==1) ) std::cout << "construction of level " << level << std::endl;
   flush(cout);
-  addNode(Cube(sonLevel.getCube(0), level, big_cube_lower_coord, cubeSideLength)); // initialization
-  for (int j=1 ; j<sonLevel.getLevelSize() ; j++) // we walk through the sons list
+  addNode(Cube(sonLevel.cubes[0], level, big_cube_lower_coord, cubeSideLength)); // initialization
+  for (int j=1 ; j<sonLevel.getLevelSize() ; j++) // we walk through the sons list: the sons of a cube are consecutive
   {
-    if (sonLevel.getCube(j).getFatherNumber() == cubes.back().getNumber()) cubes.back().addSon(sonLevel.getCube(j));
-    else this->addNode(Cube(sonLevel.getCube(j), level, big_cube_lower_coord, cubeSideLength));
+    if (sonLevel.cubes[j].getFatherNumber() != cubes.back().getNumber()) this->addNode(Cube(sonLevel.cubes[j], level, big_cube_lower_coord, cubeSideLength));
   }
   vector<Cube>(cubes).swap(cubes); // swap trick for trimming exceeding capacity
   if ( (my_id==0) && (VERBOSE==1) ) cout << "cubes.size() = " << cubes.size() << ", cubes.capacity() = " << cubes.capacity() << endl;
@@ -246,11 +283,26 @@ Level::Level(const Level & sonLevel,
 Level::~Level()
 {
   cubes.clear();
-  numbersToIndexes.clear();
+  numbersToIndexesKeys.clear();
+  numbersToIndexesVals.clear();
   localCubesIndexes.clear();
   listOfFcToBeReceived.clear();
   listOfFcToBeSent.clear();
   cubesIndexesAfterReduction.clear();
+  alphaTransParticipantsIndexes.clear();
+  cubesSonsOffsets.clear();
+  cubesSonsIndexes.clear();
+  cubesSonsProcNumbers.clear();
+  cubesNeighborsOffsets.clear();
+  cubesNeighborsIndexes.clear();
+  cubesRWG_numbers.clear();
+  cubesRWG_numbers_CFIE_OK.clear();
+  cubesTriangle_numberOfRWGs.clear();
+  cubesTriangleToRWGindex.clear();
+  cubesTriangleToRWGweight.clear();
+  cubesTriangleToRWG_ropp.clear();
+  cubesTriangle_GaussCoord.clear();
+  cubesTriangle_nHat.clear();
   thetas.free();
   phis.free();
   weightsThetas.free();
@@ -258,6 +310,10 @@ Level::~Level()
   alphaTranslations.free();
   alphaTranslationsIndexesNonZeros.free();
   alphaTranslationsIndexes.free();
+  alphaTranslationsIndexesSwapXY.free();
+  alphaTranslationsKHats.free();
+  alphaTranslationsWeights.free();
+  alphaTranslationsCoarseCounts.free();
   for (int i=0; i<shiftingArrays.size(); i++) shiftingArrays[i].resize(0);
   shiftingArrays.clear();
   Sdown.free();
@@ -302,6 +358,10 @@ void Level::alphaTranslationsComputation(const int VERBOSE,
                                          const float alphaTranslation_thresholdRelValueMax,
                                          const float alphaTranslation_RelativeCountAboveThreshold)
 {
+  if (this->alphaTranslationsInterpolation==1) {
+    alphaTranslationsInterpolatedComputation(VERBOSE, alphaTranslation_smoothing_factor);
+    return;
+  }
   const int translationOrder = getN(), NThetas = getNThetas(), NPhis = getNPhis();
   const int translationOrder_prime = static_cast<int>(ceil(translationOrder * alphaTranslation_smoothing_factor));
 
@@ -315,6 +375,12 @@ void Level::alphaTranslationsComputation(const int VERBOSE,
     Ny = 2*Ny-1;
     Nz = 2*Nz-1;
   }
+  // alpha(x, y, z) and alpha(y, x, z) are related through the x <-> y symmetry.
+  // If the phi sampling allows it, we only store the translations with x >= y.
+  const int NxyMin = min(Nx, Ny);
+  alphaTranslationsIndexesSwapXY.free();
+  const bool SWAP_XY = (this->DIRECTIONS_PARALLELIZATION!=1) && (alphaTranslationIndexConstructionSwapXY(alphaTranslationsIndexesSwapXY, NThetas, NPhis)==1);
+  if (SWAP_XY) Nx = (Ny = max(Nx, Ny));
 
   blitz::Array<float, 2> thetasPhis_all_directions(NThetas * NPhis, 2), thetasPhis;
   blitz::Array<float, 1> weightsThetasPhis_all_directions(NThetas * NPhis), weightsThetasPhis;
@@ -354,6 +420,7 @@ void Level::alphaTranslationsComputation(const int VERBOSE,
   if ( (my_id==0) && (VERBOSE==1) ) {
     cout << "\n    Process " << my_id << ", Level " << this->level << " alpha translations computation" << endl;
     cout << "    alpha.shape() = " << Nx << ", " << Ny << ", " << Nz << ", " << N_directions << endl;
+    if (SWAP_XY) cout << "    x <-> y symmetry used: only alpha(x, y, z) with x >= y are computed" << endl;
     flush(cout);
   }
 
@@ -362,6 +429,7 @@ void Level::alphaTranslationsComputation(const int VERBOSE,
     if ( (my_id==0) && (VERBOSE==1) ) cout << "\r    " << (x+1)*100/Nx << " % computed";
     flush(cout);
     for (int y = 0 ; y<Ny ; ++y) {
+      if ( SWAP_XY && ((y>x) || (y>=NxyMin)) ) continue; // obtained by symmetry, or never used
       for (int z = 0 ; z<Nz ; ++z) {
         r_mn[0] = static_cast<double> (x-this->offsetAlphaIndexX);
         r_mn[1] = static_cast<double> (y-this->offsetAlphaIndexY);
@@ -446,6 +514,83 @@ void Level::alphaTranslationsComputation(const int VERBOSE,
   }
 }
 
+void Level::setAlphaTranslationsInterpolation(const int NOrder,
+                                              const float oversampling)
+{
+  alphaTranslationsInterpolation = 1;
+  alphaTranslationsInterpolationOrder = min(max(NOrder, 2), 16);
+  alphaTranslationsInterpolationOversampling = max(oversampling, static_cast<float>(1.5));
+}
+
+void Level::alphaTranslationsInterpolatedComputation(const int VERBOSE,
+                                                     const float alphaTranslation_smoothing_factor)
+/**
+ * The \f$ \alpha \f$ translation only depends on \f$ | \mathbf{r}_{mn} | \f$ and on the angle
+ * \f$ \gamma \f$ between \f$ \mathbf{\hat{k}} \f$ and \f$ \mathbf{r}_{mn} \f$, and is a trigonometric
+ * polynomial of degree \f$ L' \f$ in \f$ \gamma \f$. We therefore only store, for each translation,
+ * its samples on a regular (oversampled) grid of \f$ \gamma \in \left[ 0, \pi \right] \f$, padded on
+ * both sides for the interpolation stencil. The translations with offsets equal up to signs and
+ * permutations share the same samples, so only the offsets with \f$ x \geq y \geq z \geq 0 \f$ are stored.
+ * The directions values are interpolated on the fly in Octtree::SupAlphaMultiplicationInterpolated.
+ */
+{
+  const int translationOrder = getN(), NThetas = getNThetas(), NPhis = getNPhis();
+  const int translationOrder_prime = static_cast<int>(ceil(translationOrder * alphaTranslation_smoothing_factor));
+  const int my_id = MPI::COMM_WORLD.Get_rank();
+  const int Nx = (this->getCeiling()) ? NCubesX : min(NCubesX, 4);
+  const int Ny = (this->getCeiling()) ? NCubesY : min(NCubesY, 4);
+  const int Nz = (this->getCeiling()) ? NCubesZ : min(NCubesZ, 4);
+  const int NMax = max(Nx, max(Ny, Nz));
+
+  // the directions and their weights
+  alphaTranslationsKHats.resize(NThetas * NPhis, 3);
+  alphaTranslationsWeights.resize(NThetas * NPhis);
+  for (int i=0 ; i<NThetas ; ++i) {
+    const float sin_theta = sin(thetas(i)), cos_theta = cos(thetas(i));
+    for (int j=0 ; j<NPhis ; ++j) {
+      const int index = i + j*NThetas;
+      alphaTranslationsKHats(index, 0) = sin_theta * cos(phis(j));
+      alphaTranslationsKHats(index, 1) = sin_theta * sin(phis(j));
+      alphaTranslationsKHats(index, 2) = cos_theta;
+      alphaTranslationsWeights(index) = weightsThetas(i) * weightsPhis(j);
+    }
+  }
+
+  // the gamma samples. With r_mn along z and phi = 0, theta is gamma.
+  const int NPadding = alphaTranslationsInterpolationOrder/2;
+  const int NGamma = static_cast<int>(ceil(alphaTranslationsInterpolationOversampling * (translationOrder_prime + 1)));
+  const int NSamples = NGamma + 1 + 2*NPadding;
+  alphaTranslationsDeltaGamma = M_PI/NGamma;
+  blitz::Array<double, 2> gammasPhis(NSamples, 2);
+  for (int j=0 ; j<NSamples ; ++j) {
+    gammasPhis(j, 0) = (j-NPadding) * M_PI/NGamma;
+    gammasPhis(j, 1) = 0.0;
+  }
+
+  this->alphaTranslations.resize(NMax, NMax, NMax);
+  this->alphaTranslationsIndexesNonZeros.resize(NMax, NMax, NMax);
+  blitz::Array<std::complex<double>, 1> alpha(NSamples);
+  if ( (my_id==0) && (VERBOSE==1) ) {
+    cout << "\n    Process " << my_id << ", Level " << this->level << " interpolated alpha translations computation" << endl;
+    cout << "    alpha.shape() = " << NMax << ", " << NMax << ", " << NMax << ", " << NSamples << " (x >= y >= z only)" << endl;
+    flush(cout);
+  }
+  double r_mn[3] = {0.0, 0.0, 0.0};
+  for (int x = 0 ; x<NMax ; ++x) {
+    for (int y = 0 ; y<=x ; ++y) {
+      for (int z = 0 ; z<=y ; ++z) {
+        if (x > 1) { /// if cartesian distance is sufficient
+          r_mn[2] = sqrt(static_cast<double>(x*x + y*y + z*z)) * this->cubeSideLength;
+          IT_theta_IT_phi_alpha_C2 (alpha, r_mn, getK(), translationOrder, translationOrder_prime, gammasPhis);
+          this->alphaTranslations(x, y, z).resize(NSamples);
+          for (int j=0 ; j<NSamples ; ++j) this->alphaTranslations(x, y, z)(j) = static_cast<std::complex<float> >(alpha(j));
+          this->alphaTranslationsIndexesNonZeros(x, y, z).resize(0);
+        }
+      }
+    }
+  }
+}
+
 void Level::alphaTranslationIndexConstructionZ(blitz::Array<int, 1>& newAlphaIndex,
                                                const blitz::Array<int, 1>& oldAlphaIndex,
                                                const int alphaCartesianCoordZ,
@@ -522,6 +667,135 @@ void Level::alphaTranslationIndexConstructionX(blitz::Array<int, 1>& newAlphaInd
   else newAlphaIndex = oldAlphaIndex;
 }
 
+int Level::alphaTranslationIndexConstructionSwapXY(blitz::Array<int, 1>& swapAlphaIndex,
+                                                   const int N_theta,
+                                                   const int N_phi)
+/**
+ * Symmetry with respect to the \f$ x = y \f$ plane of symmetry. Since \f$ \alpha \f$ only
+ * depends on \f$ \mathbf{\hat{s}} \cdot \mathbf{\hat{r}}_{mn} \f$, we have that
+ * \f[
+ * \alpha_{\left(x, y, z\right)} \left( \theta, \phi \right) = \alpha_{\left(y, x, z\right)} \left( \theta, \pi/2 - \phi \right)
+ * \f]
+ * which, in indexes terms, is a permutation of the phis. This permutation exists only if the
+ * phi sampling is invariant under \f$ \phi \rightarrow \pi/2 - \phi \f$ (modulo \f$ 2 \pi \f$),
+ * which is the case of the PONCELET (midpoint, \f$ j_{swap} = N_{\phi}/4 - 1 - j \f$) and
+ * TRAP (\f$ j_{swap} = N_{\phi}/4 - j \f$) samplings with N_phi multiple of 4. The matching
+ * phi is therefore searched for among all the phis, so that any such sampling is handled.
+ * Returns 1 if the permutation has been constructed, 0 otherwise.
+ */
+{
+  swapAlphaIndex.free();
+  if ( (N_phi<4) || (N_phi%4!=0) ) return 0;
+  std::vector<int> swapPhiIndex(N_phi);
+  for (int j=0; j<N_phi; ++j) {
+    const double phiSwap = M_PI/2.0 - phis(j);
+    int jSwap = -1;
+    for (int k=0; k<N_phi; ++k) {
+      if ( abs(remainder(phis(k) - phiSwap, 2.0*M_PI)) <= 1.0e-4 ) {jSwap = k; break;}
+    }
+    if (jSwap<0) return 0;
+    swapPhiIndex[j] = jSwap;
+  }
+  swapAlphaIndex.resize(N_theta * N_phi);
+  for (int i=0; i<N_theta; ++i) {
+    for (int j=0; j<N_phi; ++j) swapAlphaIndex(i + j*N_theta) = i + swapPhiIndex[j] * N_theta;
+  }
+  return 1;
+}
+
+void Level::alphaTranslationsCoarseComputation(const float thresholdRelValueMax)
+/**
+ * Prepares the alpha translations for the coarse MLFMA, which only uses, for each translation,
+ * the directions whose coefficient is above thresholdRelValueMax times the maximum coefficient.
+ * The elements of each translation (and their direction indexes) are sorted in place by
+ * decreasing magnitude, so that these directions are its alphaTranslationsCoarseCounts(x, y, z)
+ * leading elements: no second copy of the translations is kept. The dense translations are
+ * stored in the sparse form (values and direction indexes) for that.
+ *
+ * Interpolated levels only store the gamma samples and are left untouched: the coarse MLFMA
+ * then uses their full translations.
+ */
+{
+  if (this->alphaTranslationsInterpolation==1) return;
+  const int Nx = this->alphaTranslations.extent(0), Ny = this->alphaTranslations.extent(1), Nz = this->alphaTranslations.extent(2);
+  this->alphaTranslationsCoarseCounts.resize(Nx, Ny, Nz);
+  this->alphaTranslationsCoarseCounts = 0;
+  std::vector< std::pair<float, int> > magnitudes;
+  for (int x = 0 ; x<Nx ; ++x) {
+    for (int y = 0 ; y<Ny ; ++y) {
+      for (int z = 0 ; z<Nz ; ++z) {
+        blitz::Array<std::complex<float>, 1>& alpha = this->alphaTranslations(x, y, z);
+        blitz::Array<int, 1>& indexesNonZeros = this->alphaTranslationsIndexesNonZeros(x, y, z);
+        const int N_alpha = alpha.size();
+        // the max is global for directions-parallelized levels. All the processes go through
+        // the same (x, y, z), so that the collective call is matched.
+        double max_abs_alpha_local = (N_alpha>0) ? max(abs(alpha)) : 0.0;
+        double max_abs_alpha = max_abs_alpha_local;
+        if ( this->DIRECTIONS_PARALLELIZATION==1 ) MPI_Allreduce(&max_abs_alpha_local, &max_abs_alpha, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        if (N_alpha==0) continue; // |offset| <= 1, never translated
+        magnitudes.resize(N_alpha);
+        for (int i=0 ; i<N_alpha ; ++i) magnitudes[i] = std::make_pair(-abs(alpha(i)), i);
+        std::sort(magnitudes.begin(), magnitudes.end());
+        blitz::Array<std::complex<float>, 1> alphaSorted(N_alpha);
+        blitz::Array<int, 1> indexesSorted(N_alpha);
+        int countNonZero = 0;
+        for (int i=0 ; i<N_alpha ; ++i) {
+          const int j = magnitudes[i].second;
+          alphaSorted(i) = alpha(j);
+          indexesSorted(i) = (indexesNonZeros.size()>0) ? indexesNonZeros(j) : j;
+          countNonZero += (abs(alpha(j)) >= thresholdRelValueMax * max_abs_alpha);
+        }
+        alpha = alphaSorted;
+        indexesNonZeros.resize(N_alpha);
+        indexesNonZeros = indexesSorted;
+        // an empty translation would not be distinguishable from a dense one: we keep at least one element
+        this->alphaTranslationsCoarseCounts(x, y, z) = max(countNonZero, 1);
+      }
+    }
+  }
+}
+
+void Level::getAlphaTranslation(blitz::Array<std::complex<float>, 1>& alpha,
+                                blitz::Array<int, 1>& alphaIndexesNonZeros,
+                                const int x,
+                                const int y,
+                                const int z,
+                                const bool COARSE)
+/// references the alpha translation (x, y, z), restricted to the elements used by the coarse MLFMA if COARSE
+{
+  const int N_kept = (COARSE && getAlphaTranslationsCoarse()) ? this->alphaTranslationsCoarseCounts(x, y, z) : 0;
+  if (N_kept > 0) {
+    const blitz::Range kept(0, N_kept-1);
+    alpha.reference(this->alphaTranslations(x, y, z)(kept));
+    alphaIndexesNonZeros.reference(this->alphaTranslationsIndexesNonZeros(x, y, z)(kept));
+  }
+  else {
+    alpha.reference(this->alphaTranslations(x, y, z));
+    alphaIndexesNonZeros.reference(this->alphaTranslationsIndexesNonZeros(x, y, z));
+  }
+}
+
+bool Level::isAlphaTranslationStored(const int m,
+                                     const int n,
+                                     const int p) const
+{
+  int x = m, y = n, z = p;
+  if (this->alphaTranslationsInterpolation==1) {
+    // the samples are stored for the sorted offsets only
+    int mnp[3] = {m, n, p};
+    sort(mnp, mnp+3);
+    x = mnp[2];
+    y = mnp[1];
+    z = mnp[0];
+  }
+  else if ( (m<n) && getAlphaTranslationsSwapXY() ) {
+    x = n;
+    y = m;
+  }
+  if ( (x>=this->alphaTranslations.extent(0)) || (y>=this->alphaTranslations.extent(1)) || (z>=this->alphaTranslations.extent(2)) ) return false;
+  return (this->alphaTranslations(x, y, z).size() > 0);
+}
+
 double Level::getAlphaTranslationsSizeMB(void) const
 {
   const int Nx = this->alphaTranslations.extent(0), Ny = this->alphaTranslations.extent(1), Nz = this->alphaTranslations.extent(2);
@@ -533,7 +807,7 @@ double Level::getAlphaTranslationsSizeMB(void) const
       }
     }
   }
-  return N_alpha_elements * 2.0 * 4.0 / (1024.0 * 1024.0);
+  return (N_alpha_elements * 2.0 + alphaTranslationsKHats.size() + alphaTranslationsWeights.size()) * 4.0 / (1024.0 * 1024.0);
 }
 
 void Level::shiftingArraysComputation(void)
@@ -607,14 +881,44 @@ void Level::printCubesFathersNumbers(void)
   for (j=0 ; j<N ; ++j) cout << "Level " << l << " : father number of cube " << j << " = " << cubes[j].getFatherNumber() << endl;
 }
 
+void Level::computeSonsIndexes(const Level& sonLevel)
+/**
+ * The son level is sorted by fathers numbers: the sons of a cube are consecutive in it, and
+ * the cubes own these runs of sons in the increasing order of their numbers.
+ */
+{
+  const int N_cubes = getLevelSize(), N_sons = sonLevel.getLevelSize();
+  std::vector< std::pair<int, int> > numbersAndIndexes(N_cubes);
+  for (int i=0 ; i<N_cubes ; ++i) numbersAndIndexes[i] = std::make_pair(cubes[i].getNumber(), i);
+  sort(numbersAndIndexes.begin(), numbersAndIndexes.end());
+  std::vector<int> firstSon(N_cubes), NSons(N_cubes);
+  int j = 0;
+  for (int n=0 ; n<N_cubes ; ++n) {
+    const int i = numbersAndIndexes[n].second;
+    firstSon[i] = j;
+    while ( (j<N_sons) && (sonLevel.cubes[j].getFatherNumber() == cubes[i].getNumber()) ) j++;
+    NSons[i] = j - firstSon[i];
+  }
+  if (j != N_sons) {
+    cout << "Level::computeSonsIndexes: the sons of level " << sonLevel.getLevel() << " are not sorted by fathers!" << endl;
+    exit(1);
+  }
+  cubesSonsOffsets.resize(N_cubes + 1);
+  cubesSonsIndexes.resize(N_sons);
+  cubesSonsOffsets[0] = 0;
+  for (int i=0 ; i<N_cubes ; ++i) {
+    for (int m=0 ; m<NSons[i] ; ++m) cubesSonsIndexes[cubesSonsOffsets[i] + m] = firstSon[i] + m;
+    cubesSonsOffsets[i+1] = cubesSonsOffsets[i] + NSons[i];
+  }
+}
+
 void Level::printCubesSonsIndexes(void) 
 {
   int j, N = getLevelSize(), l = getLevel();
-  vector<int> sonsIndexes;
   for (j=0 ; j<N ; ++j) {
     cout << "Level " << l << " : sons indexes of cube " << j << " = ";
-    sonsIndexes = getCube(j).sonsIndexes;
-    for (unsigned int i=0; i<sonsIndexes.size(); ++i) cout << sonsIndexes[i] << " ";
+    const int * sonsIndexes = getSonsIndexes(j);
+    for (int i=0; i<getNumberOfSons(j); ++i) cout << sonsIndexes[i] << " ";
     cout << endl;
   }
 }
@@ -630,18 +934,17 @@ void Level::printCubesRWG_numbers(void)
   int N = getLevelSize(), l = getLevel();
   for (int j=0 ; j<N ; ++j) {
     std::cout << "Level " << l << " : RWG of cube " << j << " = ";
-    for (unsigned int i=0 ; i<cubes[j].RWG_numbers.size() ; ++i) cout << cubes[j].RWG_numbers[i] << ", ";
+    for (int i=0 ; i<cubes[j].N_RWG ; ++i) cout << cubesRWG_numbers[cubes[j].RWG_startIndex + i] << ", ";
     cout << endl;
   }
 }
 
 void Level::updateFatherIndexes(const Level& fatherLevel)
 {
-  vector<int> sonsIndexes;
   for (int i=0 ; i<fatherLevel.getLevelSize() ; ++i) {
-    sonsIndexes = fatherLevel.getCube(i).sonsIndexes;
-    for (unsigned int j=0 ; j<sonsIndexes.size() ; ++j) {
-      if (cubes[sonsIndexes[j]].getFatherNumber() != fatherLevel.getCube(i).getNumber()) {
+    const int * sonsIndexes = fatherLevel.getSonsIndexes(i);
+    for (int j=0 ; j<fatherLevel.getNumberOfSons(i) ; ++j) {
+      if (cubes[sonsIndexes[j]].getFatherNumber() != fatherLevel.cubes[i].getNumber()) {
         cout << "Level::updateFatherIndexes: father number in sons and father do not match!" << endl;
         exit(1);
       }
@@ -653,17 +956,31 @@ void Level::updateFatherIndexes(const Level& fatherLevel)
 void Level::setNumbersToIndexes(void)
 {
   const int N_cubes = getLevelSize();
-  int i, n;
-  numbersToIndexes.reserve(N_cubes);
-  for (i=0 ; i<N_cubes ; ++i) {
-    n = getCube(i).getNumber();
-    numbersToIndexes.push_back(Dictionary<int, int>(n, i));
+  const double N_cartesianCubes = pow(static_cast<double>(getMaxNumberCubes1D()), 3);
+  numbersToIndexesKeys.clear();
+  numbersToIndexesVals.clear();
+  if (N_cartesianCubes <= 8.0 * N_cubes) {
+    // coarse level: dense table directly indexed by the cube number
+    numbersToIndexesShift = 32;
+    numbersToIndexesVals.resize(static_cast<int>(N_cartesianCubes), -1);
+    for (int i=0 ; i<N_cubes ; ++i) numbersToIndexesVals[cubes[i].getNumber()] = i;
+  }
+  else {
+    // hash table of size 2^p >= 2*N_cubes, so that the load factor stays below 1/2
+    int p = 1;
+    while ((1 << p) < 2 * N_cubes) p++;
+    numbersToIndexesShift = 32 - p;
+    const unsigned int mask = (1u << p) - 1;
+    numbersToIndexesKeys.resize(1 << p, -1);
+    numbersToIndexesVals.resize(1 << p, -1);
+    for (int i=0 ; i<N_cubes ; ++i) {
+      const int n = cubes[i].getNumber();
+      unsigned int slot = (static_cast<unsigned int>(n) * 2654435761u) >> numbersToIndexesShift;
+      while (numbersToIndexesKeys[slot] != -1) slot = (slot + 1) & mask;
+      numbersToIndexesKeys[slot] = n;
+      numbersToIndexesVals[slot] = i;
+    }
   }
-}
-
-void Level::sortNumbersToIndexes(void)
-{
-  sort(numbersToIndexes.begin(), numbersToIndexes.end());
 }
 
 void Level::printNumbersToIndexes(void)
@@ -671,18 +988,20 @@ void Level::printNumbersToIndexes(void)
   const int N_cubes = getLevelSize();
   const int l = getLevel();
   for (int i=0 ; i<N_cubes ; ++i) {
-    cout << "Level " << l << " : numbersToIndexes[" << i << "] = " << numbersToIndexes[i].getKey() << ", " << numbersToIndexes[i].getVal() << endl;
+    const int n = cubes[i].getNumber();
+    cout << "Level " << l << " : numbersToIndexes[" << n << "] = " << getIndexOfNumber(n) << endl;
   }
 }
 
 void Level::searchCubesNeighborsIndexes(void)
 {
   setNumbersToIndexes();
-  sortNumbersToIndexes();
   const int N_cubes = getLevelSize();
+  cubesNeighborsOffsets.resize(N_cubes + 1);
+  cubesNeighborsOffsets[0] = 0;
+  cubesNeighborsIndexes.clear();
   for (int i=0 ; i<N_cubes ; ++i) {
     const float * absCartCoord(cubes[i].absoluteCartesianCoord);
-    std::vector<int> neighborsIndexes;
     // we find the neighbors
     for (int x=-1 ; x<2 ; ++x) {
       for (int y=-1 ; y<2 ; ++y) {
@@ -699,35 +1018,30 @@ void Level::searchCubesNeighborsIndexes(void)
             int candidate_number = static_cast<int>( CandidateAbsCartCoord[0] * pow2(getMaxNumberCubes1D()) + CandidateAbsCartCoord[1] * getMaxNumberCubes1D() + CandidateAbsCartCoord[2] );
             index = getIndexOfNumber(candidate_number);
           }
-          if (index>-1) neighborsIndexes.push_back(index);
+          if (index>-1) cubesNeighborsIndexes.push_back(index);
         }
       }
     }
-    // we now trim the excess capacity of neighborsIndexes
-    cubes[i].neighborsIndexes.resize(neighborsIndexes.size());
-    for (unsigned int j=0 ; j<neighborsIndexes.size() ; ++j) cubes[i].neighborsIndexes[j] = neighborsIndexes[j];
+    cubesNeighborsOffsets[i+1] = cubesNeighborsIndexes.size();
   }
+  // we now trim the excess capacity of cubesNeighborsIndexes
+  std::vector<int>(cubesNeighborsIndexes).swap(cubesNeighborsIndexes);
 }
 
-int Level::getIndexOfNumber(const int number) const // "numbersToIndexes" must be ordered
+int Level::getIndexOfNumber(const int number) const // "numbersToIndexes" must have been set
                                                     // this is done in the calling function...
 {
-  int ind_inf, ind_sup, ind_mid, index;
-  const int N = getNumbersToIndexesSize();
-  if ( (number < getNumberToIndex(0)) || (number > getNumberToIndex(N-1)) ) index = -1;
-  else {
-    ind_inf = 0;
-    ind_sup = N-1;
-    while(ind_sup-ind_inf > 1) {
-      ind_mid = (ind_sup+ind_inf)/2;
-      if (number > getNumberToIndex(ind_mid)) ind_inf = ind_mid;
-      else ind_sup = ind_mid;
-    }
-    if (number == getNumberToIndex(ind_inf)) index = getIndexToIndex(ind_inf);
-    else if (number == getNumberToIndex(ind_sup)) index = getIndexToIndex(ind_sup);
-    else index = -1;
+  if (numbersToIndexesKeys.empty()) {
+    if ( (number < 0) || (number >= static_cast<int>(numbersToIndexesVals.size())) ) return -1;
+    return numbersToIndexesVals[number];
   }
-  return index;
+  const unsigned int mask = numbersToIndexesKeys.size() - 1;
+  unsigned int slot = (static_cast<unsigned int>(number) * 2654435761u) >> numbersToIndexesShift;
+  while (numbersToIndexesKeys[slot] != -1) {
+    if (numbersToIndexesKeys[slot] == number) return numbersToIndexesVals[slot];
+    slot = (slot + 1) & mask;
+  }
+  return -1;
 }
 
 void Level::computeLocalCubesIndexes(const int procNumber) {
@@ -777,6 +1091,22 @@ void Level::computeLevelReduction(void) {
   }
   // now reduction!!
   cubes.swap(newCubes);
+  // the sons of the kept cubes, in the same order. The neighbors are not needed anymore
+  if (cubesSonsOffsets.size() > 0) {
+    std::vector<int> newSonsOffsets(cubesToKeep.size() + 1), newSonsIndexes, newSonsProcNumbers;
+    newSonsOffsets[0] = 0;
+    for (unsigned int i=0 ; i<cubesToKeep.size() ; ++i) {
+      const int start = cubesSonsOffsets[cubesToKeep[i]], stop = cubesSonsOffsets[cubesToKeep[i] + 1];
+      newSonsIndexes.insert(newSonsIndexes.end(), cubesSonsIndexes.begin() + start, cubesSonsIndexes.begin() + stop);
+      if (cubesSonsProcNumbers.size() > 0) newSonsProcNumbers.insert(newSonsProcNumbers.end(), cubesSonsProcNumbers.begin() + start, cubesSonsProcNumbers.begin() + stop);
+      newSonsOffsets[i+1] = newSonsIndexes.size();
+    }
+    cubesSonsOffsets.swap(newSonsOffsets);
+    cubesSonsIndexes.swap(newSonsIndexes);
+    cubesSonsProcNumbers.swap(newSonsProcNumbers);
+  }
+  std::vector<int>().swap(cubesNeighborsOffsets);
+  std::vector<int>().swap(cubesNeighborsIndexes);
 }
 
 void Level::computeOldIndexesOfCubes(blitz::Array<int, 1>& oldIndexesOfCubes) {
@@ -799,16 +1129,199 @@ void Level::computeGaussLocatedArguments(const blitz::Array<int, 1>& local_cubes
 {
   if ( getLeaf() ) {
     const int N_local_cubes = localCubesIndexes.size();
+    // each RWG has 2 (triangle, RWG) pairs, and there are at most as many triangles
+    const int N_local_RWG = local_RWG_numbers.size();
+    N_GaussOnTriangle = N_Gauss;
+    cubesRWG_numbers.clear();
+    cubesRWG_numbers_CFIE_OK.clear();
+    cubesTriangle_numberOfRWGs.clear();
+    cubesTriangleToRWGindex.clear();
+    cubesTriangleToRWGweight.clear();
+    cubesTriangleToRWG_ropp.clear();
+    cubesTriangle_GaussCoord.clear();
+    cubesTriangle_nHat.clear();
+    cubesRWG_numbers.reserve(N_local_RWG);
+    cubesRWG_numbers_CFIE_OK.reserve(N_local_RWG);
+    cubesTriangle_numberOfRWGs.reserve(2*N_local_RWG);
+    cubesTriangleToRWGindex.reserve(2*N_local_RWG);
+    cubesTriangleToRWGweight.reserve(2*N_local_RWG);
+    cubesTriangleToRWG_ropp.reserve(2*N_local_RWG*3);
+    cubesTriangle_GaussCoord.reserve(2*N_local_RWG*N_Gauss*3);
+    cubesTriangle_nHat.reserve(2*N_local_RWG*3);
     int startIndex_in_localArrays = 0;
     for (int i=0 ; i<N_local_cubes ; ++i) {
       const int indexLocalCube = cubesIndexesAfterReduction[localCubesIndexes[i]];      
       const int NRWG = local_cubes_NRWG(i);
-      cubes[indexLocalCube].computeGaussLocatedArguments(local_RWG_numbers, local_RWG_Numbers_CFIE_OK, local_RWGNumbers_signedTriangles, local_RWGNumbers_trianglesCoord, startIndex_in_localArrays, NRWG, N_Gauss);
+      computeCubeGaussLocatedArguments(cubes[indexLocalCube], local_RWG_numbers, local_RWG_Numbers_CFIE_OK, local_RWGNumbers_signedTriangles, local_RWGNumbers_trianglesCoord, startIndex_in_localArrays, NRWG, N_Gauss);
       startIndex_in_localArrays += NRWG;
     }
+    // the triangles shared by RWGs of the same cube are counted once: we trim the excess capacity
+    std::vector<int>(cubesTriangle_numberOfRWGs).swap(cubesTriangle_numberOfRWGs);
+    std::vector<float>(cubesTriangle_GaussCoord).swap(cubesTriangle_GaussCoord);
+    std::vector<float>(cubesTriangle_nHat).swap(cubesTriangle_nHat);
   } 
 }
 
+void Level::computeCubeGaussLocatedArguments(Cube & cube,
+                                             const blitz::Array<int, 1>& local_RWG_numbers,
+                                             const blitz::Array<int, 1>& local_RWG_Numbers_CFIE_OK,
+                                             const blitz::Array<int, 2>& local_RWGNumbers_signedTriangles,
+                                             const blitz::Array<float, 2>& local_RWGNumbers_trianglesCoord,
+                                             const int startIndex_in_localArrays,
+                                             const int NRWG,
+                                             const int N_Gauss)
+{
+  // the data of the cube is appended to the flat arrays of the level
+  cube.RWG_startIndex = cubesRWG_numbers.size();
+  cube.N_RWG = NRWG;
+  for (int j=0 ; j<NRWG ; ++j) cubesRWG_numbers.push_back(local_RWG_numbers(startIndex_in_localArrays + j));
+  for (int j=0 ; j<NRWG ; ++j) cubesRWG_numbers_CFIE_OK.push_back(local_RWG_Numbers_CFIE_OK(startIndex_in_localArrays + j));
+
+  double sum_weigths;
+  const double *xi, *eta, *weigths;
+  IT_points (xi, eta, weigths, sum_weigths, N_Gauss);
+  
+  std::vector< Dictionary2<int, int, float> > DictTriangleToRWG;
+  DictTriangleToRWG.reserve(NRWG*2);
+
+  for (int j=0 ; j<NRWG ; j++) {
+    const int triangle_number1 = abs(local_RWGNumbers_signedTriangles(startIndex_in_localArrays + j, 0));
+    const int triangle_number2 = abs(local_RWGNumbers_signedTriangles(startIndex_in_localArrays + j, 1));
+    DictTriangleToRWG.push_back(Dictionary2<int, int, float> (triangle_number1, j, 1.0));
+    DictTriangleToRWG.push_back(Dictionary2<int, int, float> (triangle_number2, j, -1.0));
+  }
+  sort(DictTriangleToRWG.begin(), DictTriangleToRWG.end());
+  // we count the number of triangles
+  unsigned int T = 1;
+  for (unsigned int j=1; j<DictTriangleToRWG.size(); j++) {
+    if (DictTriangleToRWG[j].getKey() != DictTriangleToRWG[j-1].getKey()) T++;
+  }
+  // we now construct a matrix linking triangles and RWGs
+  std::vector< std::vector<int> > TriangleToRWGindexTmp;
+  std::vector< std::vector<float> > TriangleToRWGweightTmp, TriangleToRWG_roppTmp;
+  TriangleToRWGindexTmp.reserve(T);
+  TriangleToRWGweightTmp.reserve(T);
+  TriangleToRWG_roppTmp.reserve(T);
+  std::vector<int> index_tmp;
+  std::vector<float> sign_tmp;
+  // init
+  index_tmp.push_back(DictTriangleToRWG[0].getVal1());
+  sign_tmp.push_back(DictTriangleToRWG[0].getVal2());
+  // loop
+  for (unsigned int j=1; j<DictTriangleToRWG.size(); j++) {
+    if (DictTriangleToRWG[j].getKey() != DictTriangleToRWG[j-1].getKey()) {
+      std::vector<int>(index_tmp).swap(index_tmp);
+      std::vector<float>(sign_tmp).swap(sign_tmp);
+      TriangleToRWGindexTmp.push_back(index_tmp);
+      TriangleToRWGweightTmp.push_back(sign_tmp);
+      index_tmp.resize(0);
+      sign_tmp.resize(0);
+    }
+    index_tmp.push_back(DictTriangleToRWG[j].getVal1());
+    sign_tmp.push_back(DictTriangleToRWG[j].getVal2());
+  }
+  if (TriangleToRWGindexTmp.size() < T) {
+    if (index_tmp.size()!=0) {
+      std::vector<int>(index_tmp).swap(index_tmp);
+      std::vector<float>(sign_tmp).swap(sign_tmp);
+      TriangleToRWGindexTmp.push_back(index_tmp);
+      TriangleToRWGweightTmp.push_back(sign_tmp);
+    }
+    else {
+      std::cout << "Error in the construction of cubes. Aborting" << std::endl;
+      exit(1);
+    }
+  } 
+  // construction of the Gauss points coordinates and of the normals of the triangles
+  cube.triangle_startIndex = cubesTriangle_numberOfRWGs.size();
+  cube.N_triangles = T;
+  const int startIndex_GaussCoord = cubesTriangle_GaussCoord.size(), startIndex_nHat = cubesTriangle_nHat.size();
+  cubesTriangle_GaussCoord.resize(startIndex_GaussCoord + T*N_Gauss*3);
+  cubesTriangle_nHat.resize(startIndex_nHat + T*3);
+  for (unsigned int j=0; j<T; j++) {
+    const int RWG_index = TriangleToRWGindexTmp[j][0];
+    const float sign = TriangleToRWGweightTmp[j][0];
+    double r[3], r0[3], r1[3], r2[3], n_hat[3], r1_r0[3], r2_r0[3];
+    if (sign>0.0) {
+      for (int i=0; i<3; i++) {
+        r0[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i);
+        r1[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+3);
+        r2[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+6);
+        r1_r0[i] = r1[i] - r0[i];
+        r2_r0[i] = r2[i] - r0[i];
+      }
+    }
+    else {
+      for (int i=0; i<3; i++) {
+        r0[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+9);
+        r1[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+6);
+        r2[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+3);
+        r1_r0[i] = r1[i] - r0[i];
+        r2_r0[i] = r2[i] - r0[i];
+      }
+    }
+    // triangle normal computation
+    n_hat[0] = r1_r0[1]*r2_r0[2] - r1_r0[2]*r2_r0[1];
+    n_hat[1] = r1_r0[2]*r2_r0[0] - r1_r0[0]*r2_r0[2];
+    n_hat[2] = r1_r0[0]*r2_r0[1] - r1_r0[1]*r2_r0[0];
+    const double Area = 0.5*sqrt(n_hat[0]*n_hat[0] + n_hat[1]*n_hat[1] + n_hat[2]*n_hat[2]);
+    for (int i=0; i<3; i++) cubesTriangle_nHat[startIndex_nHat + j*3 + i] = n_hat[i] * 1.0/(2.0*Area);
+    // Gauss coord in triangles computation
+    for (int i=0 ; i<N_Gauss ; ++i) {
+      r[0] = r0[0] * xi[i] + r1[0] * eta[i] + r2[0] * (1.0-xi[i]-eta[i]);
+      r[1] = r0[1] * xi[i] + r1[1] * eta[i] + r2[1] * (1.0-xi[i]-eta[i]);
+      r[2] = r0[2] * xi[i] + r1[2] * eta[i] + r2[2] * (1.0-xi[i]-eta[i]);
+      cubesTriangle_GaussCoord[startIndex_GaussCoord + j*N_Gauss*3 + i*3] = r[0];
+      cubesTriangle_GaussCoord[startIndex_GaussCoord + j*N_Gauss*3 + i*3 + 1] = r[1];
+      cubesTriangle_GaussCoord[startIndex_GaussCoord + j*N_Gauss*3 + i*3 + 2] = r[2];
+    }
+  }
+
+  // computation of the weights and opposite vector for each RWG
+  for (unsigned int j=0; j<T; j++) {
+    const int n_rwg = TriangleToRWGindexTmp[j].size();
+    cubesTriangle_numberOfRWGs.push_back(n_rwg);
+    std::vector<float> r_p;
+    for (int p=0; p<n_rwg; p++) {
+      const int RWG_index = TriangleToRWGindexTmp[j][p];
+      const float sign = TriangleToRWGweightTmp[j][p];
+      double r0[3], r1[3], r2[3], r2_r1[3];
+      if (sign>0.0) {
+        for (int i=0; i<3; i++) {
+          r0[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i);
+          r1[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+3);
+          r2[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+6);
+          r2_r1[i] = r2[i] - r1[i];
+        }
+      }
+      else {
+        for (int i=0; i<3; i++) {
+          r0[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+9);
+          r1[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+6);
+          r2[i] = local_RWGNumbers_trianglesCoord(startIndex_in_localArrays + RWG_index, i+3);
+          r2_r1[i] = r2[i] - r1[i];
+        }
+      }
+      for (int i=0; i<3; i++) r_p.push_back(r0[i]);
+      const float l_p = sqrt(r2_r1[0]*r2_r1[0] + r2_r1[1]*r2_r1[1] + r2_r1[2]*r2_r1[2]);
+      const float RWG_weight = sign * l_p/2.0/sum_weigths;
+      TriangleToRWGweightTmp[j][p] = RWG_weight;
+    }
+    std::vector<float>(r_p).swap(r_p);
+    TriangleToRWG_roppTmp.push_back(r_p);
+  }
+  // now filling the level values
+  cube.triangleToRWG_startIndex = cubesTriangleToRWGindex.size();
+  for (unsigned int j=0; j<T; j++) {
+    const int n_rwg = TriangleToRWGindexTmp[j].size();
+    for (int p=0; p<n_rwg; p++) {
+      cubesTriangleToRWGindex.push_back(TriangleToRWGindexTmp[j][p]);
+      cubesTriangleToRWGweight.push_back(TriangleToRWGweightTmp[j][p]);
+      for (int i=0; i<3; i++) cubesTriangleToRWG_ropp.push_back(TriangleToRWG_roppTmp[j][p*3+i]);
+    }
+  }
+}
+
 void Level::RWGs_renumbering(void)
 {
   if ( getLeaf() ) {
@@ -816,9 +1329,9 @@ void Level::RWGs_renumbering(void)
     int startIndex = 0;
     for (int i=0 ; i<N_local_cubes ; ++i) {
       const int indexLocalCube = cubesIndexesAfterReduction[localCubesIndexes[i]];      
-      const int NRWG = cubes[indexLocalCube].RWG_numbers.size();
-      for (int j=0; j<NRWG; j++) cubes[indexLocalCube].RWG_numbers[j] = startIndex + j;
-      startIndex += NRWG;
+      const Cube & cube = cubes[indexLocalCube];
+      for (int j=0; j<cube.N_RWG; j++) cubesRWG_numbers[cube.RWG_startIndex + j] = startIndex + j;
+      startIndex += cube.N_RWG;
     }
   } 
 }
@@ -830,7 +1343,7 @@ void Level::computeSup(blitz::Array<std::complex<float>, 2> & Sup,
                        const blitz::Array<float, 1>& thetas,
                        const blitz::Array<float, 1>& phis)
 {
-  const int NThetas = thetas.size(), NPhis = phis.size(), NGauss = cube.triangle_GaussCoord.extent(1)/3;
+  const int NThetas = thetas.size(), NPhis = phis.size(), NGauss = N_GaussOnTriangle;
 
   // A. Francavilla (29-05-2013)
   double sum_weigths;
@@ -864,22 +1377,29 @@ void Level::computeSup(blitz::Array<std::complex<float>, 2> & Sup,
   // computation of FC3Components array
   const std::complex<float> I_k(static_cast<std::complex<float> >(I*k));
   const float * rCenter = cube.rCenter;
-  const int T = cube.Triangle_numberOfRWGs.size();
+  // the views of the cube in the flat arrays of the level
+  const int T = cube.N_triangles;
+  const int * Triangle_numberOfRWGs = &cubesTriangle_numberOfRWGs[cube.triangle_startIndex];
+  const float * triangle_GaussCoord = &cubesTriangle_GaussCoord[cube.triangle_startIndex * NGauss*3];
+  const int * TriangleToRWGindex = &cubesTriangleToRWGindex[cube.triangleToRWG_startIndex];
+  const float * TriangleToRWGweight = &cubesTriangleToRWGweight[cube.triangleToRWG_startIndex];
+  const float * TriangleToRWG_ropp = &cubesTriangleToRWG_ropp[cube.triangleToRWG_startIndex * 3];
+  const int * RWG_numbers = &cubesRWG_numbers[cube.RWG_startIndex];
   int startIndex = 0, startIndex_r_opp = 0;
   for (int i=0; i<T; i++) {
-    const int n_rwg = cube.Triangle_numberOfRWGs[i];
+    const int n_rwg = Triangle_numberOfRWGs[i];
     for (int j=0; j<NGauss; j++) {
-      const float r[3] = {cube.triangle_GaussCoord(i, j*3), cube.triangle_GaussCoord(i, j*3+1), cube.triangle_GaussCoord(i, j*3+2)};
+      const float * r = &triangle_GaussCoord[(i*NGauss + j)*3];
       std::complex<float> fj[3] = {0.0, 0.0, 0.0};
       // loop on the RWGs for triangle i
       for (int rwg=0; rwg<n_rwg; rwg++) {
-        const int RWG_index = cube.TriangleToRWGindex[startIndex + rwg];
-        const float weight = cube.TriangleToRWGweight[startIndex + rwg] * weigths[j];
-        const std::complex<float> i_pq = I_PQ(cube.RWG_numbers[RWG_index]) * weight;
+        const int RWG_index = TriangleToRWGindex[startIndex + rwg];
+        const float weight = TriangleToRWGweight[startIndex + rwg] * weigths[j];
+        const std::complex<float> i_pq = I_PQ(RWG_numbers[RWG_index]) * weight;
         const int index = startIndex_r_opp + rwg*3;
-        fj[0] += i_pq*(r[0]-cube.TriangleToRWG_ropp[index]);
-        fj[1] += i_pq*(r[1]-cube.TriangleToRWG_ropp[index + 1]);
-        fj[2] += i_pq*(r[2]-cube.TriangleToRWG_ropp[index + 2]);
+        fj[0] += i_pq*(r[0]-TriangleToRWG_ropp[index]);
+        fj[1] += i_pq*(r[1]-TriangleToRWG_ropp[index + 1]);
+        fj[2] += i_pq*(r[2]-TriangleToRWG_ropp[index + 2]);
       } // end loop RWGs
       const float expArg[3] = {r[0]-rCenter[0], r[1]-rCenter[1], r[2]-rCenter[2]};
       for (int q=0 ; q<NPhis/2 ; q++) {// for phi>pi, kHat = -kHat(pi-theta, phi-pi)
@@ -928,7 +1448,7 @@ void Level::sphericalIntegration(blitz::Array<std::complex<float>, 1>& ZI,
   const std::complex<float> nJEFIE_factor(static_cast<std::complex<float> >(-I*mu_0)  * w * mu_r * CFIE(1)); // k²/(j*w*eps) factor
   const std::complex<float> tJMFIE_factor(static_cast<std::complex<float> >(I*k) * CFIE(2)); // j*k factor
   const std::complex<float> nJMFIE_factor(static_cast<std::complex<float> >(I*k) * CFIE(3)); // j*k factor
-  const int NThetas = thetas.size(), NPhis = phis.size(), NGauss = cube.triangle_GaussCoord.extent(1)/3;
+  const int NThetas = thetas.size(), NPhis = phis.size(), NGauss = N_GaussOnTriangle;
 
   // A. Francavilla (29-05-2013)
   double sum_weigths;
@@ -961,13 +1481,22 @@ void Level::sphericalIntegration(blitz::Array<std::complex<float>, 1>& ZI,
   // defining local arrays used for faster computations
   const std::complex<float> minus_I_k(static_cast<std::complex<float> >(-I*k));
   const float * rCenter = cube.rCenter;
-  const int T = cube.Triangle_numberOfRWGs.size();
+  // the views of the cube in the flat arrays of the level
+  const int T = cube.N_triangles;
+  const int * Triangle_numberOfRWGs = &cubesTriangle_numberOfRWGs[cube.triangle_startIndex];
+  const float * triangle_GaussCoord = &cubesTriangle_GaussCoord[cube.triangle_startIndex * NGauss*3];
+  const float * triangle_nHat = &cubesTriangle_nHat[cube.triangle_startIndex * 3];
+  const int * TriangleToRWGindex = &cubesTriangleToRWGindex[cube.triangleToRWG_startIndex];
+  const float * TriangleToRWGweight = &cubesTriangleToRWGweight[cube.triangleToRWG_startIndex];
+  const float * TriangleToRWG_ropp = &cubesTriangleToRWG_ropp[cube.triangleToRWG_startIndex * 3];
+  const int * RWG_numbers = &cubesRWG_numbers[cube.RWG_startIndex];
+  const int * RWG_numbers_CFIE_OK = &cubesRWG_numbers_CFIE_OK[cube.RWG_startIndex];
   int startIndex = 0, startIndex_r_opp = 0;
   for (int i=0; i<T; i++) {
-    const int n_rwg = cube.Triangle_numberOfRWGs[i];
-    const float nHat[3] = {cube.triangle_nHat(i, 0), cube.triangle_nHat(i, 1), cube.triangle_nHat(i, 2)};
+    const int n_rwg = Triangle_numberOfRWGs[i];
+    const float * nHat = &triangle_nHat[i*3];
     for (int j=0; j<NGauss; j++) {
-      const float r[3] = {cube.triangle_GaussCoord(i, j*3), cube.triangle_GaussCoord(i, j*3+1), cube.triangle_GaussCoord(i, j*3+2)};
+      const float * r = &triangle_GaussCoord[(i*NGauss + j)*3];
       // computation of the shifting terms
       const float expArg[3] = {r[0]-rCenter[0], r[1]-rCenter[1], r[2]-rCenter[2]};
       std::complex<float> EJ[3] = {0.0, 0.0, 0.0};
@@ -1009,13 +1538,13 @@ void Level::sphericalIntegration(blitz::Array<std::complex<float>, 1>& ZI,
       // loop on the RWGs for triangle i
       for (int rwg=0; rwg<n_rwg; rwg++) {
         // common EFIE and MFIE
-        const int RWG_index = cube.TriangleToRWGindex[startIndex + rwg];
-        const float weight = cube.TriangleToRWGweight[startIndex + rwg] * weigths[j];
-        const int RWGNumber = cube.RWG_numbers[RWG_index];
-        const int CFIE_OK = cube.RWG_numbers_CFIE_OK[RWG_index];
+        const int RWG_index = TriangleToRWGindex[startIndex + rwg];
+        const float weight = TriangleToRWGweight[startIndex + rwg] * weigths[j];
+        const int RWGNumber = RWG_numbers[RWG_index];
+        const int CFIE_OK = RWG_numbers_CFIE_OK[RWG_index];
         // EFIE
         const int index = startIndex_r_opp + rwg*3;
-        const float fj[3] = {(r[0]-cube.TriangleToRWG_ropp[index]), (r[1]-cube.TriangleToRWG_ropp[index + 1]), (r[2]-cube.TriangleToRWG_ropp[index + 2])};
+        const float fj[3] = {(r[0]-TriangleToRWG_ropp[index]), (r[1]-TriangleToRWG_ropp[index + 1]), (r[2]-TriangleToRWG_ropp[index + 2])};
         ZI(RWGNumber) += tJEFIE_factor * (EJ[0]*fj[0] + EJ[1]*fj[1] + EJ[2]*fj[2]) * weight;
         // we see if we need n x f_m
         const bool tH = tH_tmp * CFIE_OK;
@@ -18,7 +18,7 @@ using namespace std;
 
     The Level class is composed of:
       - <strong> vector<Cube> cubes </strong>: a vector container holding all the cubes of the level
-      - <strong> vector<Dictionary> numbersToIndexes </strong>:  object that returns the index for a given cube number
+      - <strong> vector<int> numbersToIndexesKeys, numbersToIndexesVals </strong>:  hash table that returns the index for a given cube number
       - <strong> vector<int> localCubesIndexes </strong>: the list of the cubes local to the current process
       - <strong> vector< vector<int> > listOfFcToBeReceived </strong>: a list of radiation functions to be received from each process
       - <strong> vector< vector<int> > listOfFcToBeSent </strong>: a list of radiation functions to be sent to each process
@@ -52,8 +52,15 @@ class Level {
   public:
     //! a list of the cubes that belong to the current level 
     std::vector<Cube> cubes;
-    //! a cube cartesian number to cube index array. Necessary to quickly find its neighbours
-    std::vector< Dictionary<int, int> > numbersToIndexes;
+    //! a cube cartesian number to cube index hash table (open addressing, linear probing). Necessary to quickly find its neighbours.
+    /*!
+      At the coarse levels, where the total number of cartesian cubes is small, numbersToIndexesKeys is empty and
+      numbersToIndexesVals is a dense table directly indexed by the cube number. Empty slots hold -1.
+    */
+    std::vector<int> numbersToIndexesKeys;
+    std::vector<int> numbersToIndexesVals;
+    //! the shift of the multiplicative hash: the table size is 2^(32-numbersToIndexesShift)
+    int numbersToIndexesShift;
     //! a list of the indexes of the cubes that are on the same process 
     std::vector<int> localCubesIndexes;
     //! the list of indexes of the cubes whose radiation functions must be received
@@ -68,6 +75,39 @@ class Level {
     std::vector< std::vector<int> > listOfFcToBeSent;
     //! the indexes of the cubes that remain after the level has been resized to hold only the local cubes
     std::vector<int> cubesIndexesAfterReduction;
+    //! \brief the alpha translations participants of all the local cubes, stored one cube after the other.
+    //! A cube only holds where its participants start, and how many of them are local/non-local (see Cube)
+    std::vector<int> alphaTransParticipantsIndexes;
+    //! \brief the sons of the cubes, as indexes in the son level before its reduction, stored one cube after the other.
+    /*!
+      The sons of cube i are cubesSonsIndexes[cubesSonsOffsets[i]] to cubesSonsIndexes[cubesSonsOffsets[i+1]-1].
+      cubesSonsProcNumbers holds their process numbers, with the same offsets. It is only filled at the
+      directions-parallelized level: below, the sons are on the process of their father.
+      The neighbors of the cubes are stored the same way, as indexes in the level before its reduction.
+      They are only needed for finding the alpha translations participants, and freed by the reduction.
+    */
+    std::vector<int> cubesSonsOffsets;
+    std::vector<int> cubesSonsIndexes;
+    std::vector<int> cubesSonsProcNumbers;
+    std::vector<int> cubesNeighborsOffsets;
+    std::vector<int> cubesNeighborsIndexes;
+    //! \brief the RWGs and triangles data of all the local leaf cubes, stored one cube after the other.
+    /*!
+      A cube has N_RWG entries in cubesRWG_numbers and cubesRWG_numbers_CFIE_OK, starting at RWG_startIndex;
+      N_triangles entries in cubesTriangle_numberOfRWGs starting at triangle_startIndex (times N_GaussOnTriangle*3
+      in cubesTriangle_GaussCoord and times 3 in cubesTriangle_nHat); and one entry per (triangle, RWG) pair in
+      cubesTriangleToRWGindex and cubesTriangleToRWGweight starting at triangleToRWG_startIndex (times 3 in
+      cubesTriangleToRWG_ropp). The RWG indexes in cubesTriangleToRWGindex are relative to the cube.
+    */
+    std::vector<int> cubesRWG_numbers;
+    std::vector<int> cubesRWG_numbers_CFIE_OK;
+    std::vector<int> cubesTriangle_numberOfRWGs;
+    std::vector<int> cubesTriangleToRWGindex;
+    std::vector<float> cubesTriangleToRWGweight;
+    std::vector<float> cubesTriangleToRWG_ropp;
+    std::vector<float> cubesTriangle_GaussCoord;
+    std::vector<float> cubesTriangle_nHat;
+    int N_GaussOnTriangle;
     //! the theta sampling of the current level 
     blitz::Array<float, 1> thetas;
     //! the phi sampling of the current level 
@@ -80,6 +120,24 @@ class Level {
     blitz::Array< blitz::Array<std::complex<float>, 1>, 3> alphaTranslations;
     blitz::Array< blitz::Array<int, 1>, 3> alphaTranslationsIndexesNonZeros;
     blitz::Array<int, 4> alphaTranslationsIndexes; // necessary due to the use of symmetry
+    //! directions permutation for the x <-> y symmetry. Empty if the symmetry is not used at this level
+    blitz::Array<int, 1> alphaTranslationsIndexesSwapXY;
+    //! 1 if the alpha translations are interpolated on the fly from their samples in \f$ \gamma = \arccos ( \mathbf{\hat{k}} \cdot \mathbf{\hat{r}}_{mn} ) \f$
+    int alphaTranslationsInterpolation;
+    //! the number of points of the on-the-fly Lagrange interpolation
+    int alphaTranslationsInterpolationOrder;
+    //! the oversampling factor of the \f$ \gamma \f$ samples with respect to the band limit of alpha
+    float alphaTranslationsInterpolationOversampling;
+    //! the \f$ \gamma \f$ sampling step
+    float alphaTranslationsDeltaGamma;
+    //! the directions unit vectors, needed for the on-the-fly interpolation
+    blitz::Array<float, 2> alphaTranslationsKHats;
+    //! the directions integration weights, needed for the on-the-fly interpolation
+    blitz::Array<float, 1> alphaTranslationsWeights;
+    /*! for the coarse MLFMA of the two-level preconditioner, the number of leading elements of each
+        alpha translation that it uses. The translations are then sorted by decreasing magnitude.
+        Empty if not computed */
+    blitz::Array<int, 3> alphaTranslationsCoarseCounts;
     LagrangeFastInterpolator2D lfi2D; // the interpolator for the next level
     blitz::Array< blitz::Array<std::complex<float>, 2>, 1> Sdown;
     //! tells if we have parallelization by directions (currently only for the ceiling level)
@@ -229,20 +287,29 @@ class Level {
     void addNode(Cube cube) {cubes.push_back(cube);}
     Cube getCube(const int i) const {return cubes[i];}
     double getCubesSizeMB(void) const {return cubes.size() * (thetas.size()*phis.size()) *  2 * 2.0*4.0/(1024.0*1024.0);}
-    std::vector< Dictionary<int, int> > getNumbersToIndexes(void) const {return numbersToIndexes;}
+    std::vector<int> getNumbersToIndexesKeys(void) const {return numbersToIndexesKeys;}
+    std::vector<int> getNumbersToIndexesVals(void) const {return numbersToIndexesVals;}
+    int getNumbersToIndexesShift(void) const {return numbersToIndexesShift;}
     std::vector<int> getLocalCubesIndexes(void) const {return localCubesIndexes;}
     std::vector< std::vector<int> > getListOfFcToBeReceived(void) const {return listOfFcToBeReceived;}
     std::vector< std::vector<int> > getListOfFcToBeSent(void) const {return listOfFcToBeSent;}
     std::vector<int> getCubesIndexesAfterReduction(void) const {return cubesIndexesAfterReduction;}
     void computeOldIndexesOfCubes(blitz::Array<int, 1>& /*oldIndexesOfCubes*/); 
     void computeLevelReduction(void);
-    int getNumbersToIndexesSize(void) const {return numbersToIndexes.size();}
-    int getNumberToIndex(const int i) const {return numbersToIndexes[i].getKey();}
-    int getIndexToIndex(const int i) const {return numbersToIndexes[i].getVal();}
     int getIndexOfNumber(const int) const;
     int getLevelSize(void) const {return cubes.size();}
-    int getSizeOfAlphaTransParticipantsIndexes(void) const {int result = 0; for (unsigned int i=0; i<cubes.size(); ++i) result += (cubes[i].localAlphaTransParticipantsIndexes.size() + cubes[i].nonLocalAlphaTransParticipantsIndexes.size()); return result;}
+    int getSizeOfAlphaTransParticipantsIndexes(void) const {return alphaTransParticipantsIndexes.size();}
+    //! the alpha translations participants of a cube that are on its process, then those that are not
+    const int * getLocalAlphaTransParticipants(const Cube & cube) const {return (alphaTransParticipantsIndexes.size() > 0) ? &alphaTransParticipantsIndexes[cube.alphaTransParticipantsStartIndex] : 0;}
+    const int * getNonLocalAlphaTransParticipants(const Cube & cube) const {return (alphaTransParticipantsIndexes.size() > 0) ? &alphaTransParticipantsIndexes[cube.alphaTransParticipantsStartIndex + cube.N_localAlphaTransParticipants] : 0;}
     float getSizeMBOfAlphaTransParticipantsIndexes(void) const {return getSizeOfAlphaTransParticipantsIndexes()*4.0/(1024.0*1024.0);}
+    //! the sons of the cube of index i, and their process numbers
+    int getNumberOfSons(const int i) const {return (cubesSonsOffsets.size() > 0) ? cubesSonsOffsets[i+1] - cubesSonsOffsets[i] : 0;}
+    const int * getSonsIndexes(const int i) const {return (cubesSonsIndexes.size() > 0) ? &cubesSonsIndexes[0] + cubesSonsOffsets[i] : 0;}
+    const int * getSonsProcNumbers(const int i) const {return (cubesSonsProcNumbers.size() > 0) ? &cubesSonsProcNumbers[0] + cubesSonsOffsets[i] : 0;}
+    //! the neighbors of the cube of index i, before the level reduction
+    int getNumberOfNeighbors(const int i) const {return (cubesNeighborsOffsets.size() > 0) ? cubesNeighborsOffsets[i+1] - cubesNeighborsOffsets[i] : 0;}
+    const int * getNeighborsIndexes(const int i) const {return (cubesNeighborsIndexes.size() > 0) ? &cubesNeighborsIndexes[0] + cubesNeighborsOffsets[i] : 0;}
     blitz::Array<float, 1> getThetas(void) const {return thetas;}
     blitz::Array<float, 1> getPhis(void) const {return phis;}
     int getNThetas(void) const {return thetas.size();}
@@ -253,17 +320,46 @@ class Level {
                                       const blitz::Array<int, 2>& /*local_RWGNumbers_signedTriangles*/,
                                       const blitz::Array<float, 2>& /*local_RWGNumbers_trianglesCoord*/,
                                       const int /*N_Gauss*/);
+    //! \brief computes the points locations and values for the arguments for the complex exponentials
+    //! that will be used in computing the radiation function of a leaf cube, and appends them to the level arrays
+    void computeCubeGaussLocatedArguments(Cube & /*cube*/,
+                                          const blitz::Array<int, 1>& /*local_RWG_numbers*/,
+                                          const blitz::Array<int, 1>& /*local_RWG_Numbers_CFIE_OK*/,
+                                          const blitz::Array<int, 2>& /*local_RWGNumbers_signedTriangles*/,
+                                          const blitz::Array<float, 2>& /*local_RWGNumbers_trianglesCoord*/,
+                                          const int /*startIndex_in_localArrays*/,
+                                          const int /*NRWG*/,
+                                          const int /*N_Gauss*/);
     void RWGs_renumbering(void);
     void shiftingArraysComputation(void);
     double getShiftingArraysSizeMB(void) const {return shiftingArrays.size() * shiftingArrays[0].size() *  2.0*4.0/(1024.0*1024.0);}
     blitz::Array<int, 1> getAlphaTranslationsExtents(void) const;
     blitz::Array< blitz::Array<std::complex<float>, 1>, 3> getAlphaTranslations(void) const {return alphaTranslations;}
     double getAlphaTranslationsSizeMB(void) const;
-    double getAlphaTranslationsIndexesSizeMB(void) const {return alphaTranslationsIndexes.size() * 4.0/(1024.0*1024.0);}
+    double getAlphaTranslationsIndexesSizeMB(void) const {return (alphaTranslationsIndexes.size() + alphaTranslationsIndexesSwapXY.size()) * 4.0/(1024.0*1024.0);}
+    //! true if only the alphaTranslations(x, y, z) with x >= y are stored
+    bool getAlphaTranslationsSwapXY(void) const {return (alphaTranslationsIndexesSwapXY.size() > 0);}
     void alphaTranslationsComputation(const int VERBOSE,
                                       const float alphaTranslation_smoothing_factor,
                                       const float alphaTranslation_thresholdRelValueMax,
                                       const float alphaTranslation_RelativeCountAboveThreshold);
+    void setAlphaTranslationsInterpolation(const int /*NOrder*/,
+                                           const float /*oversampling*/);
+    void alphaTranslationsInterpolatedComputation(const int VERBOSE,
+                                                  const float alphaTranslation_smoothing_factor);
+    void alphaTranslationsCoarseComputation(const float /*thresholdRelValueMax*/);
+    //! true if the coarse alpha translations have been computed for this level
+    bool getAlphaTranslationsCoarse(void) const {return (alphaTranslationsCoarseCounts.size() > 0);}
+    void getAlphaTranslation(blitz::Array<std::complex<float>, 1>& /*alpha*/,
+                             blitz::Array<int, 1>& /*alphaIndexesNonZeros*/,
+                             const int /*x*/,
+                             const int /*y*/,
+                             const int /*z*/,
+                             const bool /*COARSE*/);
+    //! true if the translation for the offset (+-m, +-n, +-p) is stored (levels not parallelized by directions)
+    bool isAlphaTranslationStored(const int /*m*/,
+                                  const int /*n*/,
+                                  const int /*p*/) const;
     void alphaTranslationIndexConstructionZ(blitz::Array<int, 1>& newAlphaIndex,
                                             const blitz::Array<int, 1>& oldAlphaIndex,
                                             const int alphaCartesianCoordZ,
@@ -279,18 +375,21 @@ class Level {
                                             const int /*alphaCartesianCoordX*/,
                                             const int /*N_theta*/,
                                             const int /*N_phi*/);
+    int alphaTranslationIndexConstructionSwapXY(blitz::Array<int, 1>& /*swapAlphaIndex*/,
+                                                const int /*N_theta*/,
+                                                const int /*N_phi*/);
     blitz::Array<float, 1> getWeightsThetas(void) const {return weightsThetas;} 
     blitz::Array<float, 1> getWeightsPhis(void) const {return weightsPhis;} 
     LagrangeFastInterpolator2D getLfi2D(void) const {return lfi2D;}
 
     void sortCubesByParents(void);
+    void computeSonsIndexes(const Level& sonLevel);
     void printCubesSonsIndexes(void);
     void printCubesFathersNumbers(void);
     void printCubesRCenters(void);
     void printCubesRWG_numbers(void);
     void updateFatherIndexes(const Level& fatherLevel);
     void setNumbersToIndexes(void);
-    void sortNumbersToIndexes(void);
     void printNumbersToIndexes(void);
     void searchCubesNeighborsIndexes(void);
     void computeLocalCubesIndexes(const int /*procNumber*/);
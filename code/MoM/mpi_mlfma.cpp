@@ -8,6 +8,8 @@
 #include <blitz/array.h>
 #include <vector>
 #include <algorithm>
+#include <map>
+#include <set>
 #include <mpi.h>
 
 using namespace std;
@@ -34,6 +36,17 @@ void gatherAndRedistribute(blitz::Array<std::complex<float>, 1>& x, const int my
   MPI_Bcast(x.data(), N_RWG, MPI_COMPLEX, 0, MPI_COMM_WORLD);
 }
 
+void gatherAndRedistribute(blitz::Array<std::complex<float>, 2>& X, const int my_id, const int num_procs)
+/// same as above for a block of vectors, in one reduction
+{
+  int N = X.size();
+  blitz::Array<std::complex<float>, 2> recvBuf;
+  if (my_id==0) recvBuf.resize(X.extent(0), X.extent(1));
+  MPI_Reduce(X.data(), recvBuf.data(), N, MPI_COMPLEX, MPI_SUM, 0, MPI_COMM_WORLD);
+  if (my_id==0) X = recvBuf;
+  MPI_Bcast(X.data(), N, MPI_COMPLEX, 0, MPI_COMM_WORLD);
+}
+
 class MatvecMLFMA {
 
   public:
@@ -43,13 +56,16 @@ class MatvecMLFMA {
     int N_RWG;
     blitz::Array<int, 1> localRWGnumbers;
     string simuDir;
+    //! 1 for the low-accuracy MLFMA of the two-level preconditioner
+    int COARSE;
 
     // constructors
     MatvecMLFMA(void){}
     MatvecMLFMA(Octtree & /*octtree*/,
                 const int /*numberOfRWG*/,
                 const blitz::Array<int, 1>& /*localRWGindexes*/,
-		const string & /*simuDir*/);
+		const string & /*simuDir*/,
+                const int /*COARSE*/ = 0);
     // destructor
     ~MatvecMLFMA(void){localRWGnumbers.free();}
     // copy operators
@@ -65,13 +81,17 @@ class MatvecMLFMA {
     int getN_RWG(void) const {return N_RWG;}
     void matvecZnear(blitz::Array<std::complex<float>, 1> & /*y*/,
                      const blitz::Array<std::complex<float>, 1> & /*x*/);
+    void matvecZnear(blitz::Array<std::complex<float>, 2> & /*Y*/,
+                     const blitz::Array<std::complex<float>, 2> & /*X*/);
     blitz::Array<std::complex<float>, 1> matvec(const blitz::Array<std::complex<float>, 1> & /*x*/);
+    blitz::Array<std::complex<float>, 2> matvecBlock(const blitz::Array<std::complex<float>, 2> & /*X*/);
 };
 
 MatvecMLFMA::MatvecMLFMA(Octtree & octtree,
                          const int numberOfRWG,
                          const blitz::Array<int, 1>& localRWGindexes,
-                         const string & simu_dir)
+                         const string & simu_dir,
+                         const int coarse)
 
 {
   pOcttree = &octtree;
@@ -81,6 +101,7 @@ MatvecMLFMA::MatvecMLFMA(Octtree & octtree,
   localRWGnumbers.resize(localRWGindexes.size());
   localRWGnumbers = localRWGindexes;
   simuDir = simu_dir;
+  COARSE = coarse;
 }
 
 void MatvecMLFMA::copyMatvecMLFMA(const MatvecMLFMA& matvecMLFMAtoCopy) // copy member function
@@ -92,6 +113,7 @@ void MatvecMLFMA::copyMatvecMLFMA(const MatvecMLFMA& matvecMLFMAtoCopy) // copy
   localRWGnumbers.resize(matvecMLFMAtoCopy.localRWGnumbers.size());
   localRWGnumbers = matvecMLFMAtoCopy.localRWGnumbers;
   simuDir = matvecMLFMAtoCopy.simuDir;
+  COARSE = matvecMLFMAtoCopy.COARSE;
 }
 
 MatvecMLFMA::MatvecMLFMA(const MatvecMLFMA& matvecMLFMAtoCopy) // copy constructor
@@ -118,14 +140,31 @@ void MatvecMLFMA::matvecZnear(blitz::Array<std::complex<float>, 1> & y, const bl
   }
 }
 
+void MatvecMLFMA::matvecZnear(blitz::Array<std::complex<float>, 2> & Y, const blitz::Array<std::complex<float>, 2> & X)
+/// near-field product of a block of vectors, one per column: each chunk is read once for all of them
+{
+  const int my_id = MPI::COMM_WORLD.Get_rank();
+  const string pathToReadFrom = simuDir + "/tmp" + intToString(my_id) + "/Z_near/", Z_name = "Z_CFIE_near";
+  blitz::Array<int, 1> chunkNumbers;
+  readIntBlitzArray1DFromASCIIFile(pathToReadFrom + "chunkNumbers.txt", chunkNumbers);
+  Z_sparse_MLFMA Z_near;
+  for (unsigned int i=0 ; i<chunkNumbers.size() ; i++) {
+    int number = chunkNumbers(i);
+    Z_near.setZ_sparse_MLFMAFromFile(pathToReadFrom, Z_name, number);
+    Z_near.matvec_Z_PQ_near(Y, X);
+  }
+}
+
 blitz::Array<std::complex<float>, 1> MatvecMLFMA::matvec(const blitz::Array<std::complex<float>, 1> & x)
 {
   // creation of a local solution vector for MLFMA
   blitz::Array<std::complex<float>, 1> y_local_MLFMA(this->localRWGnumbers.size());
   y_local_MLFMA = 0.0;
 
-  // far-field multiplication
+  // far-field multiplication. The tree is shared by the outer and coarse matvecs
+  pOcttree->setCoarseAlphaTranslations(COARSE);
   pOcttree->ZIFarComputation(y_local_MLFMA, x);
+  pOcttree->setCoarseAlphaTranslations(0);
   
   // distribution of x among processes
   blitz::Array<std::complex<float>, 1> x_global(this->N_RWG);
@@ -172,6 +211,76 @@ blitz::Array<std::complex<float>, 1> MatvecMLFMA::matvec(const blitz::Array<std:
   return yTmp;
 }
 
+blitz::Array<std::complex<float>, 2> MatvecMLFMA::matvecBlock(const blitz::Array<std::complex<float>, 2> & X)
+/**
+ * matvec of a block of vectors, one per row of X. The far field is computed vector by vector,
+ * but the near-field chunks are read once for the whole block and the redistributions
+ * among the processes are made in one message per block.
+ */
+{
+  blitz::Range all = blitz::Range::all();
+  const int K = X.extent(0), N_local = this->localRWGnumbers.size();
+  // far-field multiplication. The tree is shared by the outer and coarse matvecs
+  blitz::Array<std::complex<float>, 2> Y_local_MLFMA(K, N_local);
+  blitz::Array<std::complex<float>, 1> x(N_local), y(N_local);
+  pOcttree->setCoarseAlphaTranslations(COARSE);
+  for (int l=0 ; l<K ; ++l) {
+    x = X(l, all);
+    y = 0.0;
+    pOcttree->ZIFarComputation(y, x);
+    Y_local_MLFMA(l, all) = y;
+  }
+  pOcttree->setCoarseAlphaTranslations(0);
+
+  // distribution of X among processes. The K values of an RWG are contiguous
+  blitz::Array<std::complex<float>, 2> X_global(this->N_RWG, K);
+  X_global = 0.0;
+  for (int i=0 ; i<N_local ; ++i) {
+    for (int l=0 ; l<K ; ++l) X_global(this->localRWGnumbers(i), l) = X(l, i);
+  }
+  gatherAndRedistribute(X_global, getProcNumber(), getTotalProcNumber());
+
+  // near-field multiplication
+  const int my_id = MPI::COMM_WORLD.Get_rank();
+  const string pathToReadFrom = simuDir + "/tmp" + intToString(my_id) + "/Z_near/";
+  int local_N_src_RWG;
+  string filename = pathToReadFrom + "local_N_src_RWG.txt";
+  readIntFromASCIIFile(filename, local_N_src_RWG);
+  blitz::Array<int, 1> local_src_RWG_numbers(local_N_src_RWG);
+  filename = pathToReadFrom + "local_src_RWG_numbers.txt";
+  readIntBlitzArray1DFromBinaryFile(filename, local_src_RWG_numbers);
+  blitz::Array<std::complex<float>, 2> X_local_Z(local_N_src_RWG, K);
+  for (int i=0; i<local_N_src_RWG; i++) X_local_Z(i, all) = X_global(local_src_RWG_numbers(i), all);
+  X_global.free();
+
+  int local_N_test_RWG;
+  filename = pathToReadFrom + "local_N_test_RWG.txt";
+  readIntFromASCIIFile(filename, local_N_test_RWG);
+  blitz::Array<int, 1> local_test_RWG_numbers(local_N_test_RWG);
+  filename = pathToReadFrom + "local_test_RWG_numbers.txt";
+  readIntBlitzArray1DFromBinaryFile(filename, local_test_RWG_numbers);
+  blitz::Array<std::complex<float>, 2> Y_local_Z(local_N_test_RWG, K);
+  Y_local_Z = 0.0;
+  matvecZnear(Y_local_Z, X_local_Z);
+  X_local_Z.free();
+  // we add the near and far results before redistributing them
+  blitz::Array<std::complex<float>, 2> Y_global(this->N_RWG, K);
+  Y_global = 0.0;
+  for (int i=0; i<local_N_test_RWG; i++) Y_global(local_test_RWG_numbers(i), all) += Y_local_Z(i, all);
+  Y_local_Z.free();
+  for (int i=0 ; i<N_local ; ++i) {
+    for (int l=0 ; l<K ; ++l) Y_global(this->localRWGnumbers(i), l) += Y_local_MLFMA(l, i);
+  }
+  Y_local_MLFMA.free();
+  gatherAndRedistribute(Y_global, getProcNumber(), getTotalProcNumber());
+  // we now select only the elements to return
+  blitz::Array<std::complex<float>, 2> YTmp(K, N_local);
+  for (int i=0 ; i<N_local ; ++i) {
+    for (int l=0 ; l<K ; ++l) YTmp(l, i) = Y_global(this->localRWGnumbers(i), l);
+  }
+  return YTmp;
+}
+
 /****************************************************************************/
 /******************************* Left Frob precond **************************/
 /****************************************************************************/
@@ -198,6 +307,7 @@ class LeftFrobPsolveMLFMA {
 
     // function
     blitz::Array<std::complex<float>, 1> psolve(const blitz::Array<std::complex<float>, 1> & /*x*/);
+    blitz::Array<std::complex<float>, 2> psolveBlock(const blitz::Array<std::complex<float>, 2> & /*X*/);
 };
 
 LeftFrobPsolveMLFMA::LeftFrobPsolveMLFMA(const int numberOfRWG,
@@ -281,6 +391,61 @@ blitz::Array<std::complex<float>, 1> LeftFrobPsolveMLFMA::psolve(const blitz::Ar
   return yTmp;
 }
 
+blitz::Array<std::complex<float>, 2> LeftFrobPsolveMLFMA::psolveBlock(const blitz::Array<std::complex<float>, 2> & X)
+/// psolve of a block of vectors, one per row of X: the Mg_LeftFrob chunks are read once for all of them
+{
+  blitz::Range all = blitz::Range::all();
+  const int my_id = MPI::COMM_WORLD.Get_rank();
+  const int K = X.extent(0), N_local = localRWGnumbers.size();
+  blitz::Array<std::complex<float>, 2> X_global(this->N_RWG, K);
+  X_global = 0.0;
+  for (int i=0 ; i<N_local ; ++i) {
+    for (int l=0 ; l<K ; ++l) X_global(localRWGnumbers(i), l) = X(l, i);
+  }
+  gatherAndRedistribute(X_global, procNumber, totalProcNumber);
+
+  const string pathToReadFrom = simuDir + "/tmp" + intToString(my_id) + "/Mg_LeftFrob/", Z_name = "Mg_LeftFrob";
+  int local_N_src_RWG;
+  string filename = pathToReadFrom + "local_N_src_RWG.txt";
+  readIntFromASCIIFile(filename, local_N_src_RWG);
+  blitz::Array<int, 1> local_src_RWG_numbers(local_N_src_RWG);
+  filename = pathToReadFrom + "local_src_RWG_numbers.txt";
+  readIntBlitzArray1DFromBinaryFile(filename, local_src_RWG_numbers);
+  blitz::Array<std::complex<float>, 2> X_local_Y(local_N_src_RWG, K);
+  for (int i=0; i<local_N_src_RWG; i++) X_local_Y(i, all) = X_global(local_src_RWG_numbers(i), all);
+  X_global.free();
+
+  int local_N_test_RWG;
+  filename = pathToReadFrom + "local_N_test_RWG.txt";
+  readIntFromASCIIFile(filename, local_N_test_RWG);
+  blitz::Array<int, 1> local_test_RWG_numbers(local_N_test_RWG);
+  filename = pathToReadFrom + "local_test_RWG_numbers.txt";
+  readIntBlitzArray1DFromBinaryFile(filename, local_test_RWG_numbers);
+  blitz::Array<std::complex<float>, 2> Y_local_Y(local_N_test_RWG, K);
+  Y_local_Y = 0.0;
+  blitz::Array<int, 1> chunkNumbers;
+  readIntBlitzArray1DFromASCIIFile(pathToReadFrom + "chunkNumbers.txt", chunkNumbers);
+  Z_sparse_MLFMA Mg_LeftFrob;
+  for (unsigned int i=0 ; i<chunkNumbers.size() ; i++) {
+    int number = chunkNumbers(i);
+    Mg_LeftFrob.setZ_sparse_MLFMAFromFile(pathToReadFrom, Z_name, number);
+    Mg_LeftFrob.matvec_Z_PQ_near(Y_local_Y, X_local_Y);
+  }
+  X_local_Y.free();
+  // we should now gather and redistribute the result among the processes
+  blitz::Array<std::complex<float>, 2> Y_global(this->N_RWG, K);
+  Y_global = 0.0;
+  for (int i=0; i<local_N_test_RWG; i++) Y_global(local_test_RWG_numbers(i), all) += Y_local_Y(i, all);
+  Y_local_Y.free();
+  gatherAndRedistribute(Y_global, procNumber, totalProcNumber);
+  // we now select only the elements to return
+  blitz::Array<std::complex<float>, 2> YTmp(K, N_local);
+  for (int i=0 ; i<N_local ; ++i) {
+    for (int l=0 ; l<K ; ++l) YTmp(l, i) = Y_global(localRWGnumbers(i), l);
+  }
+  return YTmp;
+}
+
 /****************************************************************************/
 /*************************** AMLFMA Preconditioner **************************/
 /****************************************************************************/
@@ -358,16 +523,32 @@ blitz::Array<std::complex<float>, 1> PsolveAMLFMA::psolve(const blitz::Array<std
 void computeE_obs(blitz::Array<std::complex<double>, 2>& E_obs,
                   blitz::Array<std::complex<double>, 2>& H_obs,
                   const blitz::Array<double, 2>& r_obs,
+                  Octtree & octtree,
                   const LocalMesh &  local_target_mesh,
                   const blitz::Array<std::complex<float>, 1>& ZI,
                   const std::complex<float> eps_r,
                   const std::complex<float> mu_r,
-                  const float w)
+                  const float w,
+                  const int E_OBS_OCTTREE)
 {
   int FULL_PRECISION = 1;
   blitz::Range all = blitz::Range::all();
   E_obs.resize(r_obs.extent(0), r_obs.extent(1));
   H_obs.resize(r_obs.extent(0), r_obs.extent(1));
+  if (E_OBS_OCTTREE==1) {
+    // all the points at once, and a single reduction
+    blitz::Array<std::complex<float>, 2> local_E(r_obs.extent(0), 3), local_H(r_obs.extent(0), 3), E(r_obs.extent(0), 3), H(r_obs.extent(0), 3);
+    octtree.computeObservationFields(local_E, local_H, r_obs, ZI, local_target_mesh, FULL_PRECISION);
+    MPI_Allreduce(local_E.data(), E.data(), local_E.size(), MPI_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(local_H.data(), H.data(), local_H.size(), MPI_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+    for (int j=0 ; j<r_obs.extent(0) ; ++j) {
+      for (int i=0 ; i<3 ; ++i) {
+        E_obs(j, i) = E(j, i);
+        H_obs(j, i) = H(j, i);
+      }
+    }
+    return;
+  }
   for (int j=0 ; j<r_obs.extent(0) ; ++j) {
     blitz::Array<std::complex<float>, 1> E_tmp(3), H_tmp(3);
     local_compute_E_obs(E_tmp, H_tmp, r_obs(j, all), ZI, local_target_mesh, w, eps_r, mu_r, FULL_PRECISION);
@@ -384,6 +565,38 @@ void computeE_obs(blitz::Array<std::complex<double>, 2>& E_obs,
   }
 }
 
+void readInnerSolverParameters(string & INNER_SOLVER,
+                               double & INNER_TOL,
+                               int & INNER_MAXITER,
+                               int & INNER_RESTART,
+                               int & INNER_COARSE_MLFMA,
+                               Octtree & octtree,
+                               const string SOLVER,
+                               const string ITERATIVE_DATA_PATH)
+/**
+ * the parameters of the inner solver of FGMRES. With the other solvers the inner solver is
+ * never called, and they keep neutral values. If the inner solver uses the coarse MLFMA of the
+ * two-level preconditioner, its alpha translations are set up here.
+ */
+{
+  INNER_SOLVER = "GMRES";
+  INNER_TOL = 1.0;
+  INNER_MAXITER = 1;
+  INNER_RESTART = 1;
+  INNER_COARSE_MLFMA = 0;
+  if (SOLVER!="FGMRES") return;
+  readStringFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_SOLVER.txt", INNER_SOLVER);
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_MAXITER.txt", INNER_MAXITER);
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_RESTART.txt", INNER_RESTART);
+  readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_TOL.txt", INNER_TOL);
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_COARSE_MLFMA.txt", INNER_COARSE_MLFMA);
+  if (INNER_COARSE_MLFMA==1) {
+    double INNER_COARSE_ALPHA_THRESHOLD = 0.0;
+    readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_COARSE_ALPHA_THRESHOLD.txt", INNER_COARSE_ALPHA_THRESHOLD);
+    octtree.alphaTranslationsCoarseComputation(INNER_COARSE_ALPHA_THRESHOLD);
+  }
+}
+
 void computeForOneExcitation(Octtree & octtree,
                              LocalMesh & local_target_mesh,
                              const string SOLVER,
@@ -426,6 +639,8 @@ void computeForOneExcitation(Octtree & octtree,
   readFloatBlitzArray1DFromASCIIFile( V_CFIE_DATA_PATH + "r_phase_center.txt", r_phase_center);
 
   if (DIPOLES_EXCITATION==1) {
+    int V_DIPOLES_OCTTREE;
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_DIPOLES_OCTTREE.txt", V_DIPOLES_OCTTREE);
     blitz::Array<std::complex<double>, 2> J_dip, M_dip;
     blitz::Array<double, 2> r_J_dip, r_M_dip;
     int J_DIPOLES_EXCITATION, M_DIPOLES_EXCITATION;
@@ -436,7 +651,8 @@ void computeForOneExcitation(Octtree & octtree,
       readDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "r_J_dip.txt", r_J_dip);
       blitz::Array<std::complex<float>, 1> V_CFIE_tmp;
       const char CURRENT_TYPE = 'J';
-      local_V_CFIE_dipole_array (V_CFIE_tmp, J_dip, r_J_dip, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, CURRENT_TYPE, V_FULL_PRECISION);
+      if (V_DIPOLES_OCTTREE==1) octtree.computeDipolesExcitation(V_CFIE_tmp, J_dip, r_J_dip, CURRENT_TYPE, local_target_mesh, V_FULL_PRECISION);
+      else local_V_CFIE_dipole_array (V_CFIE_tmp, J_dip, r_J_dip, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, CURRENT_TYPE, V_FULL_PRECISION);
       V_CFIE += V_CFIE_tmp;
     }
     // magnetic dipoles
@@ -450,7 +666,8 @@ void computeForOneExcitation(Octtree & octtree,
       //}
       blitz::Array<std::complex<float>, 1> V_CFIE_tmp;
       const char CURRENT_TYPE = 'M';
-      local_V_CFIE_dipole_array (V_CFIE_tmp, J_dip, r_J_dip, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, CURRENT_TYPE, V_FULL_PRECISION);
+      if (V_DIPOLES_OCTTREE==1) octtree.computeDipolesExcitation(V_CFIE_tmp, M_dip, r_M_dip, CURRENT_TYPE, local_target_mesh, V_FULL_PRECISION);
+      else local_V_CFIE_dipole_array (V_CFIE_tmp, M_dip, r_M_dip, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, CURRENT_TYPE, V_FULL_PRECISION);
       V_CFIE += V_CFIE_tmp;
     }
   }
@@ -494,20 +711,26 @@ void computeForOneExcitation(Octtree & octtree,
     PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
     fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
   } 
+  else if (SOLVER=="GCRODR") {
+    PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
+    // single right-hand side: the recycled subspace only deflates the restarts
+    int GCRODR_RECYCLED_DIMENSION;
+    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GCRODR_RECYCLED_DIMENSION.txt", GCRODR_RECYCLED_DIMENSION);
+    RecycledSubspace< std::complex<float> > recycledSubspace(N_local_RWG, GCRODR_RECYCLED_DIMENSION);
+    gcrodr(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
+  }
   else if (SOLVER=="FGMRES") {
     string INNER_SOLVER;
-    readStringFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_SOLVER.txt", INNER_SOLVER);
-    int INNER_MAXITER, INNER_RESTART;
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_MAXITER.txt", INNER_MAXITER);
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_RESTART.txt", INNER_RESTART);
     double INNER_TOL;
-    readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_TOL.txt", INNER_TOL);
-    PsolveAMLFMA psolveAMLFMA(matvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
+    int INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA;
+    readInnerSolverParameters(INNER_SOLVER, INNER_TOL, INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA, octtree, SOLVER, ITERATIVE_DATA_PATH);
+    MatvecMLFMA innerMatvecMLFMA(octtree, N_RWG, localRWGNumbers, SIMU_DIR, INNER_COARSE_MLFMA);
+    PsolveAMLFMA psolveAMLFMA(innerMatvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
     PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolve(&psolveAMLFMA, &PsolveAMLFMA::psolve);
     fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
   }
   else {
-    cout << "Bad solver choice!! Solver is BICGSTAB or (F)GMRES, and you chose " << SOLVER << endl;
+    cout << "Bad solver choice!! Solver is BICGSTAB, (F)GMRES or GCRODR, and you chose " << SOLVER << endl;
     exit(1);
   }
   octtree.resizeSdownLevelsToZero();
@@ -518,9 +741,11 @@ void computeForOneExcitation(Octtree & octtree,
   if (BISTATIC_R_OBS==1) {
     blitz::Array<double, 2> r_obs;
     readDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "r_obs.txt", r_obs);
+    int E_OBS_OCTTREE;
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "E_OBS_OCTTREE.txt", E_OBS_OCTTREE);
     blitz::Array<std::complex<double>, 2> E_obs, H_obs;
     local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
-    computeE_obs(E_obs, H_obs, r_obs, local_target_mesh, ZI, eps_r, mu_r, w);
+    computeE_obs(E_obs, H_obs, r_obs, octtree, local_target_mesh, ZI, eps_r, mu_r, w, E_OBS_OCTTREE);
     local_target_mesh.resizeToZero();
     if (my_id==master) { // we write the scattered electric field to a file
       ofstream ofs ((RESULT_DATA_PATH + "E_obs_scatt.txt").c_str());
@@ -692,6 +917,468 @@ void computeForOneExcitation(Octtree & octtree,
   }
 }
 
+void writeE_obsToASCIIFile(const string filename,
+                           const blitz::Array<double, 2>& r_obs,
+                           const blitz::Array<std::complex<double>, 2>& E_obs)
+{
+  ofstream ofs (filename.c_str());
+  ofs << "r_obs_x[m] r_obs_y[m] r_obs_z[m] re(Ex)[V/m] im(Ex)[V/m] re(Ey)[V/m] im(Ey)[V/m] re(Ez)[V/m] im(Ez)[V/m]\n";
+  for (int i=0 ; i<r_obs.extent(0) ; i++) {
+    ofs << r_obs(i,0) << " " << r_obs(i,1) << " " << r_obs(i,2) << " ";
+    ofs << real(E_obs(i,0)) << " " << imag(E_obs(i,0)) << " ";
+    ofs << real(E_obs(i,1)) << " " << imag(E_obs(i,1)) << " ";
+    ofs << real(E_obs(i,2)) << " " << imag(E_obs(i,2)) << "\n";
+  }
+  ofs.close();
+}
+
+template <typename TClassB>
+void solveForExcitation(blitz::Array<std::complex<float>, 1>& ZI,
+                        double & error,
+                        int & iter,
+                        int & flag,
+                        MatvecFunctor< std::complex<float>, MatvecMLFMA > matvec,
+                        PrecondFunctor< std::complex<float>, TClassB > psolve,
+                        const blitz::Array<std::complex<float>, 1>& V_CFIE,
+                        const string SOLVER,
+                        const double TOL,
+                        const int RESTART,
+                        const int MAXITER,
+                        RecycledSubspace< std::complex<float> >& recycledSubspace,
+                        const string convergenceDetailedOutput)
+/// one solve with the chosen iterative solver
+{
+  int num_procs = MPI::COMM_WORLD.Get_size(), my_id = MPI::COMM_WORLD.Get_rank();
+  if (SOLVER=="BICGSTAB") bicgstab(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, MAXITER, my_id, num_procs, convergenceDetailedOutput);
+  else if (SOLVER=="GMRES") gmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, convergenceDetailedOutput);
+  else if ((SOLVER=="RGMRES") || (SOLVER=="FGMRES")) fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, convergenceDetailedOutput);
+  else if (SOLVER=="GCRODR") gcrodr(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, recycledSubspace, convergenceDetailedOutput);
+  else {
+    cout << "Bad solver choice!! Solver is BICGSTAB, (F)GMRES or GCRODR, and you chose " << SOLVER << endl;
+    exit(1);
+  }
+}
+
+void solveForExcitationsGMRES(blitz::Array<std::complex<float>, 2>& ZI,
+                              blitz::Array<double, 1>& errors,
+                              blitz::Array<int, 1>& iters,
+                              blitz::Array<int, 1>& flags,
+                              int & N_matvecs,
+                              BlockMatvecFunctor< std::complex<float>, MatvecMLFMA > blockMatvec,
+                              BlockPrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > blockPsolve,
+                              Octtree & octtree,
+                              const blitz::Array<std::complex<float>, 2>& V_CFIE,
+                              const double TOL,
+                              const int RESTART,
+                              const int MAXITER,
+                              const int BATCH_SIZE,
+                              const std::vector<string>& names,
+                              const std::vector<string>& convergenceDetailedOutputs)
+/**
+ * GMRES solves of the right-hand sides V_CFIE, one per row, by batches of BATCH_SIZE solved
+ * in lockstep with gmresMultipleRHS. ZI holds the initial guesses on input and the solutions
+ * on output. The error, iterations and flag of each right-hand side are returned, and printed
+ * under names[r], with a warning for those that did not converge.
+ */
+{
+  blitz::Range all = blitz::Range::all();
+  int num_procs = MPI::COMM_WORLD.Get_size(), my_id = MPI::COMM_WORLD.Get_rank();
+  const int N_rhs = V_CFIE.extent(0), N_local_RWG = V_CFIE.extent(1);
+  if (BATCH_SIZE < 1) {
+    cout << "GMRES_MULTIPLE_RHS_BATCH_SIZE must be at least 1, and is " << BATCH_SIZE << endl;
+    exit(1);
+  }
+  errors.resize(N_rhs);
+  iters.resize(N_rhs);
+  flags.resize(N_rhs);
+  for (int start=0 ; start<N_rhs ; start+=BATCH_SIZE) {
+    const int stop = min(start + BATCH_SIZE, N_rhs);
+    const blitz::Range batch(start, stop-1);
+    blitz::Array<std::complex<float>, 2> ZI_batch(stop - start, N_local_RWG), V_CFIE_batch(stop - start, N_local_RWG);
+    ZI_batch = ZI(batch, all);
+    V_CFIE_batch = V_CFIE(batch, all);
+    const std::vector<string> batchOutputs(convergenceDetailedOutputs.begin() + start, convergenceDetailedOutputs.begin() + stop);
+    blitz::Array<double, 1> batchErrors;
+    blitz::Array<int, 1> batchIters, batchFlags;
+    octtree.resizeSdownLevelsToZero();
+    octtree.setNumberOfUpdates(0);
+    gmresMultipleRHS(ZI_batch, batchErrors, batchIters, batchFlags, blockMatvec, blockPsolve, V_CFIE_batch, TOL, RESTART, MAXITER, my_id, num_procs, batchOutputs);
+    N_matvecs += octtree.getNumberOfUpdates();
+    octtree.resizeSdownLevelsToZero();
+    ZI(batch, all) = ZI_batch;
+    for (int r=start ; r<stop ; ++r) {
+      errors(r) = batchErrors(r - start);
+      iters(r) = batchIters(r - start);
+      flags(r) = batchFlags(r - start);
+      if (my_id==0) {
+        cout << names[r] << ": error = " << errors(r) << ", iterations = " << iters(r) << endl;
+        if (flags(r)!=0) cout << "WARNING: " << names[r] << " did not converge to TOL = " << TOL << " in " << MAXITER << " iterations" << endl;
+      }
+    }
+  }
+}
+
+void computeForMultipleExcitations(Octtree & octtree,
+                                   LocalMesh & local_target_mesh,
+                                   const string SOLVER,
+                                   const string SIMU_DIR,
+                                   const string TMP,
+                                   const string OCTTREE_DATA_PATH,
+                                   const string MESH_DATA_PATH,
+                                   const string V_CFIE_DATA_PATH,
+                                   const string RESULT_DATA_PATH,
+                                   const string ITERATIVE_DATA_PATH)
+/**
+ * Bistatic computation for a list of independent excitations: each electric dipole, each
+ * magnetic dipole and each plane wave direction is solved separately. The octtree, the
+ * near-field matrix and the preconditioner are set up once for all of them. With GMRES the
+ * excitations are solved by batches of GMRES_MULTIPLE_RHS_BATCH_SIZE with gmresMultipleRHS,
+ * and with GCRODR the deflation subspace is recycled from one excitation to the next. The currents and
+ * fields of excitation e are written with the prefix "excitation<e>_".
+ */
+{
+  blitz::Range all = blitz::Range::all();
+  int my_id = MPI::COMM_WORLD.Get_rank();
+  const int master = 0, N_local_RWG = local_target_mesh.N_local_RWG;
+  const float w = octtree.w;
+  const std::complex<float> eps_r = octtree.eps_r, mu_r = octtree.mu_r;
+  const std::complex<double> eps = static_cast<float>(eps_0) * eps_r;
+  const std::complex<double> mu = static_cast<float>(mu_0) * mu_r;
+  const std::complex<double> k(static_cast<double>(w) * sqrt(eps * mu));
+  blitz::Array<int, 1> localRWGNumbers(local_target_mesh.localRWGNumbers.size());
+  localRWGNumbers = local_target_mesh.localRWGNumbers;
+  int N_RWG, iter, RESTART, MAXITER, V_FULL_PRECISION;
+  double TOL;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "N_RWG.txt", N_RWG);
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_FULL_PRECISION.txt", V_FULL_PRECISION);
+  readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "TOL.txt", TOL);
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "RESTART.txt", RESTART);
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "MAXITER.txt", MAXITER);
+  int GMRES_MULTIPLE_RHS_BATCH_SIZE;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GMRES_MULTIPLE_RHS_BATCH_SIZE.txt", GMRES_MULTIPLE_RHS_BATCH_SIZE);
+
+  // functors declarations, shared by all the excitations
+  MatvecMLFMA matvecMLFMA(octtree, N_RWG, localRWGNumbers, SIMU_DIR);
+  MatvecFunctor< std::complex<float>, MatvecMLFMA > matvec(&matvecMLFMA, &MatvecMLFMA::matvec);
+  LeftFrobPsolveMLFMA leftFrobPsolveMLFMA(N_RWG, localRWGNumbers, SIMU_DIR);
+  PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
+  int GCRODR_RECYCLED_DIMENSION;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GCRODR_RECYCLED_DIMENSION.txt", GCRODR_RECYCLED_DIMENSION);
+  RecycledSubspace< std::complex<float> > recycledSubspace(N_local_RWG, (SOLVER=="GCRODR") ? GCRODR_RECYCLED_DIMENSION : 0);
+  string INNER_SOLVER;
+  double INNER_TOL;
+  int INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA;
+  readInnerSolverParameters(INNER_SOLVER, INNER_TOL, INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA, octtree, SOLVER, ITERATIVE_DATA_PATH);
+  MatvecMLFMA innerMatvecMLFMA(octtree, N_RWG, localRWGNumbers, SIMU_DIR, INNER_COARSE_MLFMA);
+  PsolveAMLFMA psolveAMLFMA(innerMatvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
+  PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolveFGMRES(&psolveAMLFMA, &PsolveAMLFMA::psolve);
+
+  // the list of excitations
+  int DIPOLES_EXCITATION, PLANE_WAVE_EXCITATION, J_DIPOLES_EXCITATION = 0, M_DIPOLES_EXCITATION = 0;
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "DIPOLES_EXCITATION.txt", DIPOLES_EXCITATION);
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "PLANE_WAVE_EXCITATION.txt", PLANE_WAVE_EXCITATION);
+  blitz::Array<std::complex<double>, 2> J_dip, M_dip;
+  blitz::Array<double, 2> r_J_dip, r_M_dip;
+  int N_J_dipoles = 0, N_M_dipoles = 0, N_plane_waves = 0;
+  if (DIPOLES_EXCITATION==1) {
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "J_DIPOLES_EXCITATION.txt", J_DIPOLES_EXCITATION);
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "M_DIPOLES_EXCITATION.txt", M_DIPOLES_EXCITATION);
+    if (J_DIPOLES_EXCITATION==1) {
+      readComplexDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "J_dip.txt", J_dip);
+      readDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "r_J_dip.txt", r_J_dip);
+      N_J_dipoles = J_dip.rows();
+    }
+    if (M_DIPOLES_EXCITATION==1) {
+      readComplexDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "M_dip.txt", M_dip);
+      readDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "r_M_dip.txt", r_M_dip);
+      N_M_dipoles = M_dip.rows();
+    }
+  }
+  blitz::Array<double, 2> plane_waves_angles;
+  blitz::Array<std::complex<double>, 1> E_inc_components(2);
+  if (PLANE_WAVE_EXCITATION==1) {
+    int PLANE_WAVES_FROM_FILE;
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "PLANE_WAVES_FROM_FILE.txt", PLANE_WAVES_FROM_FILE);
+    if (PLANE_WAVES_FROM_FILE==1) {
+      readDoubleBlitzArray2DFromASCIIFile(V_CFIE_DATA_PATH + "plane_waves_angles.txt", plane_waves_angles);
+      plane_waves_angles *= M_PI/180.0;
+    }
+    else {
+      plane_waves_angles.resize(1, 2);
+      readDoubleFromASCIIFile(V_CFIE_DATA_PATH + "theta_inc.txt", plane_waves_angles(0, 0));
+      readDoubleFromASCIIFile(V_CFIE_DATA_PATH + "phi_inc.txt", plane_waves_angles(0, 1));
+    }
+    N_plane_waves = plane_waves_angles.extent(0);
+    readComplexDoubleBlitzArray1DFromASCIIFile( V_CFIE_DATA_PATH + "E_inc.txt", E_inc_components);
+  }
+  const int N_excitations = N_J_dipoles + N_M_dipoles + N_plane_waves;
+  if (my_id==master) cout << "number of independent excitations = " << N_excitations << endl;
+
+  // observation data
+  blitz::Array<float, 1> r_phase_center(3);
+  readFloatBlitzArray1DFromASCIIFile( V_CFIE_DATA_PATH + "r_phase_center.txt", r_phase_center);
+  blitz::Array<double, 1> r_ref(3);
+  for (int i=0; i<3; i++) r_ref(i) = r_phase_center(i);
+  int BISTATIC_R_OBS;
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "BISTATIC_R_OBS.txt", BISTATIC_R_OBS);
+  blitz::Array<double, 2> r_obs;
+  if (BISTATIC_R_OBS==1) readDoubleBlitzArray2DFromASCIIFile( V_CFIE_DATA_PATH + "r_obs.txt", r_obs);
+  int E_OBS_OCTTREE;
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "E_OBS_OCTTREE.txt", E_OBS_OCTTREE);
+  blitz::Array<float, 1> octtreeXthetas_coarsest, octtreeXphis_coarsest;
+  readFloatBlitzArray1DFromASCIIFile(OCTTREE_DATA_PATH + "octtreeXphis_coarsest.txt", octtreeXphis_coarsest);
+  readFloatBlitzArray1DFromASCIIFile(OCTTREE_DATA_PATH + "octtreeXthetas_coarsest.txt", octtreeXthetas_coarsest);
+
+  int V_DIPOLES_OCTTREE;
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_DIPOLES_OCTTREE.txt", V_DIPOLES_OCTTREE);
+  // the mesh is loaded once, for the excitation vectors and the fields at r_obs
+  local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
+  // the excitation vectors, one row per excitation. Those of the dipoles of a type, and those
+  // of the plane waves, are each computed in one pass over the mesh
+  blitz::Array<std::complex<float>, 2> V_CFIE_excitations(max(N_excitations, 1), N_local_RWG);
+  for (int t=0 ; t<2 ; ++t) {
+    const bool J_TYPE = (t==0);
+    const int N_dipoles = J_TYPE ? N_J_dipoles : N_M_dipoles, startRow = J_TYPE ? 0 : N_J_dipoles;
+    if (N_dipoles==0) continue;
+    const blitz::Array<std::complex<double>, 2>& dip = J_TYPE ? J_dip : M_dip;
+    const blitz::Array<double, 2>& r_dip = J_TYPE ? r_J_dip : r_M_dip;
+    if (V_DIPOLES_OCTTREE==1) {
+      // the octtree gathers the dipoles of an excitation: one call per dipole
+      for (int i=0 ; i<N_dipoles ; ++i) {
+        blitz::Array<std::complex<float>, 1> V_CFIE;
+        octtree.computeDipolesExcitation(V_CFIE, dip(blitz::Range(i, i), all), r_dip(blitz::Range(i, i), all), J_TYPE ? 'J' : 'M', local_target_mesh, V_FULL_PRECISION);
+        V_CFIE_excitations(startRow + i, all) = V_CFIE;
+      }
+    }
+    else {
+      blitz::Array<std::complex<float>, 2> V_CFIE_dipoles;
+      local_V_CFIE_dipole_array (V_CFIE_dipoles, dip, r_dip, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, J_TYPE ? 'J' : 'M', V_FULL_PRECISION);
+      V_CFIE_excitations(blitz::Range(startRow, startRow + N_dipoles - 1), all) = V_CFIE_dipoles;
+    }
+  }
+  if (N_plane_waves>0) {
+    int V_CFIE_N_THREADS;
+    readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_CFIE_N_THREADS.txt", V_CFIE_N_THREADS);
+    blitz::Array<std::complex<double>, 2> E_0(N_plane_waves, 3);
+    blitz::Array<double, 2> k_hat(N_plane_waves, 3);
+    for (int i=0 ; i<N_plane_waves ; ++i) {
+      const double theta_inc = plane_waves_angles(i, 0), phi_inc = plane_waves_angles(i, 1);
+      const double r_hat[3] = {sin(theta_inc)*cos(phi_inc), sin(theta_inc)*sin(phi_inc), cos(theta_inc)};
+      const double theta_hat[3] = {cos(theta_inc)*cos(phi_inc), cos(theta_inc)*sin(phi_inc), -sin(theta_inc)};
+      const double phi_hat[3] = {-sin(phi_inc), cos(phi_inc), 0.0};
+      for (int m=0 ; m<3 ; m++) {
+        k_hat(i, m) = -r_hat[m];
+        E_0(i, m) = E_inc_components(0) * theta_hat[m] + E_inc_components(1) * phi_hat[m];
+      }
+    }
+    blitz::Array<std::complex<float>, 2> V_CFIE_plane_waves;
+    local_V_CFIE_plane_array (V_CFIE_plane_waves, E_0, k_hat, r_ref, local_target_mesh, octtree.w, octtree.eps_r, octtree.mu_r, octtree.CFIE, V_FULL_PRECISION, V_CFIE_N_THREADS);
+    V_CFIE_excitations(blitz::Range(N_J_dipoles + N_M_dipoles, N_excitations - 1), all) = V_CFIE_plane_waves;
+  }
+
+  // solving. With GMRES the excitations are solved by batches, in lockstep, so that
+  // the near-field and preconditioner products are made for a whole batch at once
+  blitz::Array<std::complex<float>, 2> ZI_excitations(max(N_excitations, 1), N_local_RWG);
+  ZI_excitations = 0.0;
+  blitz::Array<double, 1> errors(max(N_excitations, 1));
+  blitz::Array<int, 1> iters(max(N_excitations, 1)), flags(max(N_excitations, 1));
+  iters = 0;
+  int N_matvecs = 0;
+  std::vector<string> names, convergenceDetailedOutputs;
+  for (int e=0 ; e<N_excitations ; ++e) {
+    names.push_back("excitation " + intToString(e));
+    convergenceDetailedOutputs.push_back(ITERATIVE_DATA_PATH + "/excitation" + intToString(e) + "_convergence.txt");
+  }
+  if (SOLVER=="GMRES") {
+    BlockMatvecFunctor< std::complex<float>, MatvecMLFMA > blockMatvec(&matvecMLFMA, &MatvecMLFMA::matvecBlock);
+    BlockPrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > blockPsolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolveBlock);
+    if (my_id==master) cout << "\nsolving the excitations by batches of " << GMRES_MULTIPLE_RHS_BATCH_SIZE << endl;
+    if (N_excitations>0) solveForExcitationsGMRES(ZI_excitations, errors, iters, flags, N_matvecs, blockMatvec, blockPsolve, octtree, V_CFIE_excitations, TOL, RESTART, MAXITER, GMRES_MULTIPLE_RHS_BATCH_SIZE, names, convergenceDetailedOutputs);
+  }
+  else {
+    for (int e=0 ; e<N_excitations ; ++e) {
+      if (my_id==master) cout << "\nsolving excitation " << e << endl;
+      blitz::Array<std::complex<float>, 1> V_CFIE(N_local_RWG), ZI(N_local_RWG);
+      V_CFIE = V_CFIE_excitations(e, all);
+      ZI = 0.0;
+      octtree.resizeSdownLevelsToZero();
+      octtree.setNumberOfUpdates(0);
+      if (SOLVER=="FGMRES") solveForExcitation(ZI, errors(e), iters(e), flags(e), matvec, psolveFGMRES, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, convergenceDetailedOutputs[e]);
+      else solveForExcitation(ZI, errors(e), iters(e), flags(e), matvec, psolve, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, convergenceDetailedOutputs[e]);
+      N_matvecs += octtree.getNumberOfUpdates();
+      octtree.resizeSdownLevelsToZero();
+      ZI_excitations(e, all) = ZI;
+      if ((my_id==master) && (flags(e)!=0)) cout << "WARNING: " << names[e] << " did not converge to TOL = " << TOL << " in " << MAXITER << " iterations" << endl;
+    }
+  }
+  V_CFIE_excitations.free();
+  iter = max(iters);
+
+  for (int e=0 ; e<N_excitations ; ++e) {
+    const string prefix = "excitation" + intToString(e) + "_";
+    // the incoming field at the observation points, for the total field
+    blitz::Array<std::complex<double>, 2> E_inc_obs(max(r_obs.extent(0), 1), 3);
+    E_inc_obs = 0.0;
+    if (e < N_J_dipoles + N_M_dipoles) {
+      const bool J_TYPE = (e < N_J_dipoles);
+      const int i = J_TYPE ? e : e - N_J_dipoles;
+      const blitz::Array<std::complex<double>, 2> dip = J_TYPE ? J_dip(blitz::Range(i, i), all) : M_dip(blitz::Range(i, i), all);
+      const blitz::Array<double, 2> r_dip = J_TYPE ? r_J_dip(blitz::Range(i, i), all) : r_M_dip(blitz::Range(i, i), all);
+      if (my_id==master) cout << "\nexcitation " << e << ": " << (J_TYPE ? "J" : "M") << " dipole at " << r_dip(0, 0) << " " << r_dip(0, 1) << " " << r_dip(0, 2) << endl;
+      std::vector< std::vector < std::complex<double> > > G_EJ(3, std::vector< std::complex<double> >(3)), G_HJ(3, std::vector< std::complex<double> >(3));
+      const double r_src[3] = {r_dip(0, 0), r_dip(0, 1), r_dip(0, 2)};
+      for (int j=0; j<r_obs.extent(0); j++) {
+        const double r_obs_tmp[3] = {r_obs(j, 0), r_obs(j, 1), r_obs(j, 2)};
+        G_EJ_G_HJ (G_EJ, G_HJ, r_src, r_obs_tmp, eps, mu, k);
+        // we use reciprocity for the magnetic dipoles: G_EM = -G_HJ
+        for (int m=0 ; m<3 ; m++) E_inc_obs(j, m) = J_TYPE ? (G_EJ[m][0] * dip(0, 0) + G_EJ[m][1] * dip(0, 1) + G_EJ[m][2] * dip(0, 2)) : -(G_HJ[m][0] * dip(0, 0) + G_HJ[m][1] * dip(0, 1) + G_HJ[m][2] * dip(0, 2));
+      }
+    }
+    else {
+      const int i = e - N_J_dipoles - N_M_dipoles;
+      const double theta_inc = plane_waves_angles(i, 0), phi_inc = plane_waves_angles(i, 1);
+      if (my_id==master) cout << "\nexcitation " << e << ": plane wave, theta = " << theta_inc * 180.0/M_PI << ", phi = " << phi_inc * 180.0/M_PI << endl;
+      blitz::Array<std::complex<double>, 1> E_inc_cart(3);
+      for (int j=0; j<r_obs.extent(0); j++) {
+        E_plane (E_inc_cart, E_inc_components, theta_inc, phi_inc, r_ref, r_obs(j, all), k);
+        E_inc_obs(j, all) = E_inc_cart;
+      }
+    }
+
+    blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
+    ZI = ZI_excitations(e, all);
+
+    // fields at the user-supplied r_obs
+    if (BISTATIC_R_OBS==1) {
+      blitz::Array<std::complex<double>, 2> E_obs, H_obs;
+      computeE_obs(E_obs, H_obs, r_obs, octtree, local_target_mesh, ZI, eps_r, mu_r, w, E_OBS_OCTTREE);
+      if (my_id==master) writeE_obsToASCIIFile(RESULT_DATA_PATH + prefix + "E_obs_scatt.txt", r_obs, E_obs);
+      E_obs += E_inc_obs(blitz::Range(0, r_obs.extent(0)-1), all);
+      if (my_id==master) writeE_obsToASCIIFile(RESULT_DATA_PATH + prefix + "E_obs_tot.txt", r_obs, E_obs);
+    }
+    // far fields
+    blitz::Array<std::complex<float>, 2> e_theta_far, e_phi_far;
+    octtree.computeFarField(e_theta_far, e_phi_far, r_phase_center, octtreeXthetas_coarsest, octtreeXphis_coarsest, ZI, OCTTREE_DATA_PATH);
+    if (my_id==master) {
+      writeComplexFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + prefix + "scatt_e_theta_far_ASCII.txt", e_theta_far);
+      writeComplexFloatBlitzArray2DToBinaryFile(RESULT_DATA_PATH + prefix + "scatt_e_theta_far_Binary.txt", e_theta_far);
+      writeComplexFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + prefix + "scatt_e_phi_far_ASCII.txt", e_phi_far);
+      writeComplexFloatBlitzArray2DToBinaryFile(RESULT_DATA_PATH + prefix + "scatt_e_phi_far_Binary.txt", e_phi_far);
+    }
+    // the current
+    blitz::Array<std::complex<float>, 1> ZI_global(N_RWG), recvBuf;
+    ZI_global = 0.0;
+    if ( my_id == master ) {
+      recvBuf.resize(N_RWG);
+      recvBuf = 0.0;
+    }
+    for (unsigned int i=0 ; i<localRWGNumbers.size() ; ++i) ZI_global(localRWGNumbers(i)) = ZI(i);
+    MPI_Reduce(ZI_global.data(), recvBuf.data(), N_RWG, MPI_COMPLEX, MPI_SUM, 0, MPI_COMM_WORLD);
+    if ( my_id == master ) {
+      string filename = RESULT_DATA_PATH + prefix + "ZI.txt";
+      ofstream ofs(filename.c_str(), blitz::ios::binary);
+      ofs.write((char *)(recvBuf.data()), recvBuf.size()*8);
+      ofs.close();
+    }
+  }
+  local_target_mesh.resizeToZero();
+  if (my_id==master) {
+    writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "phis_far_field_ASCII.txt", octtreeXphis_coarsest);
+    writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "thetas_far_field_ASCII.txt", octtreeXthetas_coarsest);
+    writeIntToASCIIFile(RESULT_DATA_PATH + "N_excitations.txt", N_excitations);
+    writeIntToASCIIFile(ITERATIVE_DATA_PATH + "numberOfMatvecs.txt", N_matvecs);
+    writeIntToASCIIFile(ITERATIVE_DATA_PATH + "iter.txt", iter);
+    // the convergence of each excitation
+    blitz::Array<float, 1> errorsFloat(errors.size());
+    for (int e=0 ; e<errors.size() ; ++e) errorsFloat(e) = errors(e);
+    writeFloatBlitzArray1DToASCIIFile(ITERATIVE_DATA_PATH + "excitations_error.txt", errorsFloat);
+    writeIntBlitzArray1DToASCIIFile(ITERATIVE_DATA_PATH + "excitations_iter.txt", iters);
+    writeIntBlitzArray1DToASCIIFile(ITERATIVE_DATA_PATH + "excitations_flag.txt", flags);
+    cout << endl;
+  }
+}
+
+void monostaticExcitationVectors(blitz::Array<std::complex<float>, 2>& V_CFIE,
+                                  const blitz::Array<float, 1>& thetas,
+                                  const blitz::Array<float, 1>& phis,
+                                  const double amplitude,
+                                  const bool H_EXCITATION,
+                                  const bool V_EXCITATION,
+                                  const blitz::Array<double, 1>& r_ref,
+                                  const LocalMesh & local_target_mesh,
+                                  const Octtree & octtree,
+                                  const int V_FULL_PRECISION,
+                                  const int V_CFIE_N_THREADS)
+/**
+ * the excitation vectors of the monostatic plane waves coming from the directions
+ * (thetas(i), phis(i)), in one pass over the mesh: the N rows of the H polarization
+ * (incoming field amplitude * phi_hat) if H_EXCITATION, followed by the N rows of the
+ * V polarization (-amplitude * theta_hat) if V_EXCITATION. Both polarizations share
+ * the directions, hence the phase integrals over the mesh.
+ */
+{
+  const int N = thetas.size();
+  const int N_pol = (H_EXCITATION ? 1 : 0) + (V_EXCITATION ? 1 : 0);
+  if (N_pol==0) return;
+  blitz::Array<std::complex<double>, 2> E_0(N_pol * N, 3);
+  blitz::Array<double, 2> k_hat(N_pol * N, 3);
+  for (int i=0 ; i<N ; ++i) {
+    const float theta = thetas(i), phi = phis(i);
+    const double r_hat[3] = {sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta)};
+    const double theta_hat[3] = {cos(theta)*cos(phi), cos(theta)*sin(phi), -sin(theta)};
+    const double phi_hat[3] = {-sin(phi), cos(phi), 0.0};
+    int row = i;
+    if (H_EXCITATION) {
+      for (int m=0 ; m<3 ; m++) {
+        k_hat(row, m) = -r_hat[m];
+        E_0(row, m) = amplitude * phi_hat[m];
+      }
+      row += N;
+    }
+    if (V_EXCITATION) {
+      for (int m=0 ; m<3 ; m++) {
+        k_hat(row, m) = -r_hat[m];
+        E_0(row, m) = -amplitude * theta_hat[m];
+      }
+    }
+  }
+  local_V_CFIE_plane_array (V_CFIE, E_0, k_hat, r_ref, local_target_mesh, octtree.w, octtree.eps_r, octtree.mu_r, octtree.CFIE, V_FULL_PRECISION, V_CFIE_N_THREADS);
+}
+
+void solveMonostaticBatchGMRES(blitz::Array<std::complex<float>, 2>& ZI_batch,
+                               int & iter,
+                               BlockMatvecFunctor< std::complex<float>, MatvecMLFMA > blockMatvec,
+                               BlockPrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > blockPsolve,
+                               Octtree & octtree,
+                               const blitz::Array<std::complex<float>, 2>& V_CFIE_batch,
+                               const std::vector<bool>& polarizationIsH,
+                               const int firstIncidence,
+                               const double TOL,
+                               const int RESTART,
+                               const int MAXITER,
+                               const int GMRES_MULTIPLE_RHS_BATCH_SIZE,
+                               const string ITERATIVE_DATA_PATH)
+/**
+ * lockstep GMRES solve of the rows of monostaticExcitationVectors for a batch of incidences
+ * numbered from firstIncidence. iter is the largest number of iterations of the batch.
+ */
+{
+  const int N_rhs = V_CFIE_batch.extent(0);
+  if (N_rhs==0) return;
+  const int N_batch = N_rhs/polarizationIsH.size();
+  std::vector<string> names, convergenceDetailedOutputs;
+  for (int r=0 ; r<N_rhs ; ++r) {
+    names.push_back(string(polarizationIsH[r/N_batch] ? "H" : "V") + " incidence " + intToString(firstIncidence + r%N_batch));
+    convergenceDetailedOutputs.push_back(ITERATIVE_DATA_PATH + "/convergence_rhs" + intToString(r) + ".txt");
+  }
+  blitz::Array<double, 1> errors;
+  blitz::Array<int, 1> iters, flags;
+  int N_matvecs = 0;
+  solveForExcitationsGMRES(ZI_batch, errors, iters, flags, N_matvecs, blockMatvec, blockPsolve, octtree, V_CFIE_batch, TOL, RESTART, MAXITER, GMRES_MULTIPLE_RHS_BATCH_SIZE, names, convergenceDetailedOutputs);
+  octtree.setNumberOfUpdates(N_matvecs);
+  iter = max(iters);
+}
+
 void computeMonostaticRCS(Octtree & octtree,
                           LocalMesh & local_target_mesh,
                           const string SOLVER,
@@ -703,7 +1390,7 @@ void computeMonostaticRCS(Octtree & octtree,
                           const string RESULT_DATA_PATH,
                           const string ITERATIVE_DATA_PATH)
 {
-  int num_procs = MPI::COMM_WORLD.Get_size(), my_id = MPI::COMM_WORLD.Get_rank();
+  int my_id = MPI::COMM_WORLD.Get_rank();
   const int master = 0, N_local_RWG = local_target_mesh.N_local_RWG;
   
   blitz::Array<int, 1> localRWGNumbers(local_target_mesh.localRWGNumbers.size());
@@ -728,18 +1415,22 @@ void computeMonostaticRCS(Octtree & octtree,
   MatvecFunctor< std::complex<float>, MatvecMLFMA > matvec(&matvecMLFMA, &MatvecMLFMA::matvec);
   LeftFrobPsolveMLFMA leftFrobPsolveMLFMA(N_RWG, localRWGNumbers, SIMU_DIR);
   PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
-  if (SOLVER=="FGMRES") {
-    string INNER_SOLVER;
-    readStringFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_SOLVER.txt", INNER_SOLVER);
-    int INNER_MAXITER, INNER_RESTART;
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_MAXITER.txt", INNER_MAXITER);
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_RESTART.txt", INNER_RESTART);
-    double INNER_TOL;
-    readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_TOL.txt", INNER_TOL);
-    PsolveAMLFMA psolveAMLFMA(matvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
-    PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolve(&psolveAMLFMA, &PsolveAMLFMA::psolve);
-  }
-  else PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
+  // with GMRES, the incidences of a batch that do not start from the previous solution are solved in lockstep
+  BlockMatvecFunctor< std::complex<float>, MatvecMLFMA > blockMatvec(&matvecMLFMA, &MatvecMLFMA::matvecBlock);
+  BlockPrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > blockPsolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolveBlock);
+  int GMRES_MULTIPLE_RHS_BATCH_SIZE;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GMRES_MULTIPLE_RHS_BATCH_SIZE.txt", GMRES_MULTIPLE_RHS_BATCH_SIZE);
+  // GCRO-DR recycles a deflation subspace from one incidence angle to the next
+  int GCRODR_RECYCLED_DIMENSION;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GCRODR_RECYCLED_DIMENSION.txt", GCRODR_RECYCLED_DIMENSION);
+  RecycledSubspace< std::complex<float> > recycledSubspace(N_local_RWG, (SOLVER=="GCRODR") ? GCRODR_RECYCLED_DIMENSION : 0);
+  string INNER_SOLVER;
+  double INNER_TOL;
+  int INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA;
+  readInnerSolverParameters(INNER_SOLVER, INNER_TOL, INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA, octtree, SOLVER, ITERATIVE_DATA_PATH);
+  MatvecMLFMA innerMatvecMLFMA(octtree, N_RWG, localRWGNumbers, SIMU_DIR, INNER_COARSE_MLFMA);
+  PsolveAMLFMA psolveAMLFMA(innerMatvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
+  PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolveFGMRES(&psolveAMLFMA, &PsolveAMLFMA::psolve);
   // what do we compute?
   int COMPUTE_RCS_HH, COMPUTE_RCS_HV, COMPUTE_RCS_VH, COMPUTE_RCS_VV;
   readIntFromASCIIFile(TMP + "/COMPUTE_RCS_HH.txt", COMPUTE_RCS_HH);
@@ -752,10 +1443,26 @@ void computeMonostaticRCS(Octtree & octtree,
   // r_ref for where the plane wave is evaluated
   blitz::Array<double, 1> r_ref(3);
   for (int i=0 ; i<3 ; ++i) r_ref(i) = r_phase_center(i);
+  // the excitation vectors are computed by batches of incidence angles, one pass over the mesh per batch
+  int V_CFIE_N_THREADS, V_CFIE_PLANE_WAVES_BATCH_SIZE;
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_CFIE_N_THREADS.txt", V_CFIE_N_THREADS);
+  readIntFromASCIIFile(V_CFIE_DATA_PATH + "V_CFIE_PLANE_WAVES_BATCH_SIZE.txt", V_CFIE_PLANE_WAVES_BATCH_SIZE);
+  if (V_CFIE_PLANE_WAVES_BATCH_SIZE < 1) {
+    cout << "V_CFIE_PLANE_WAVES_BATCH_SIZE must be at least 1, and is " << V_CFIE_PLANE_WAVES_BATCH_SIZE << endl;
+    exit(1);
+  }
   // getting the angles at which monostatic RCS must be computed
   int ANGLES_FROM_FILE;
   readIntFromASCIIFile(V_CFIE_DATA_PATH + "ANGLES_FROM_FILE.txt", ANGLES_FROM_FILE);
+  // the polarizations of the incoming plane waves: H first, then V
+  const bool H_EXCITATION = ((COMPUTE_RCS_HH==1) || (COMPUTE_RCS_HV==1));
+  const bool V_EXCITATION = ((COMPUTE_RCS_VH==1) || (COMPUTE_RCS_VV==1));
+  std::vector<bool> polarizationIsH;
+  if (H_EXCITATION) polarizationIsH.push_back(true);
+  if (V_EXCITATION) polarizationIsH.push_back(false);
+  const int N_polarizations = polarizationIsH.size();
   if (ANGLES_FROM_FILE==1) {
+    const bool BLOCK_SOLVE = (SOLVER=="GMRES");
     blitz::Array<float, 2> angles;
     readFloatBlitzArray2DFromASCIIFile(V_CFIE_DATA_PATH + "monostatic_angles.txt", angles);
     // transformation in radians
@@ -767,49 +1474,50 @@ void computeMonostaticRCS(Octtree & octtree,
     RCS_HH = 1.0;
     RCS_HV = 1.0;
     RCS_VH = 1.0;
-    // loop for monostatic sigma computation
-    for (int excitation=0 ; excitation<2 ; ++excitation) { // 0 for H, 1 for V
-      const bool HH = ((excitation==0) && (COMPUTE_RCS_HH==1));
-      const bool HV = ((excitation==0) && (COMPUTE_RCS_HV==1));
-      const bool VH = ((excitation==1) && (COMPUTE_RCS_VH==1));
-      const bool VV = ((excitation==1) && (COMPUTE_RCS_VV==1));
-      const bool cond = (HH || HV || VH || VV);
-      if (cond) {
-        for (int i=0 ; i<N_angles ; i++) {
+    // loop for monostatic sigma computation, by batches of angles
+    for (int startAngle=0 ; startAngle<N_angles ; startAngle+=V_CFIE_PLANE_WAVES_BATCH_SIZE) {
+      const int N_batch = min(V_CFIE_PLANE_WAVES_BATCH_SIZE, N_angles - startAngle);
+      const blitz::Range batch(startAngle, startAngle + N_batch - 1);
+      // the excitation vectors of both polarizations in one pass over the mesh
+      blitz::Array<std::complex<float>, 2> V_CFIE_batch;
+      monostaticExcitationVectors(V_CFIE_batch, angles(batch, 0), angles(batch, 1), 1.0, H_EXCITATION, V_EXCITATION, r_ref, local_target_mesh, octtree, V_FULL_PRECISION, V_CFIE_N_THREADS);
+      blitz::Array<std::complex<float>, 2> ZI_batch;
+      if (BLOCK_SOLVE) {
+        ZI_batch.resize(N_polarizations * N_batch, N_local_RWG);
+        ZI_batch = 0.0;
+        solveMonostaticBatchGMRES(ZI_batch, iter, blockMatvec, blockPsolve, octtree, V_CFIE_batch, polarizationIsH, startAngle, TOL, RESTART, MAXITER, GMRES_MULTIPLE_RHS_BATCH_SIZE, ITERATIVE_DATA_PATH);
+      }
+      for (int pol=0 ; pol<N_polarizations ; ++pol) {
+        const bool H_POLARIZATION = polarizationIsH[pol];
+        for (int b=0 ; b<N_batch ; b++) {
+          const int i = startAngle + b;
           blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
           ZI = 0.0;
           const float theta = angles(i, 0);
           const float phi = angles(i, 1);
           octtree.resizeSdownLevelsToZero();
           if (my_id==master) {
-            if (HH || HV) cout << "\nHH and HV, theta = "<< theta * 180.0/M_PI << ", phi = " << phi * 180.0/M_PI << endl;
+            if (H_POLARIZATION) cout << "\nHH and HV, theta = "<< theta * 180.0/M_PI << ", phi = " << phi * 180.0/M_PI << endl;
             else cout << "\nVV and VH, theta = "<< theta * 180.0/M_PI << ", phi = " << phi * 180.0/M_PI << endl;
             flush(cout);
           }
           // local coordinate system
-          blitz::Array<double, 1> r_hat(3), theta_hat(3), phi_hat(3);
-          r_hat = sin(theta)*cos(phi), sin(theta)*sin(phi), cos(theta);
+          blitz::Array<double, 1> theta_hat(3), phi_hat(3);
           theta_hat = cos(theta)*cos(phi), cos(theta)*sin(phi), -sin(theta);
           phi_hat = -sin(phi), cos(phi), 0.0;
-          blitz::Array<double, 1> k_hat(-1.0 * r_hat);
 
           // excitation field
           blitz::Array<std::complex<double>, 1> E_0(3);
-          if (HH || HV) E_0 = 1.0 * (phi_hat + I * 0.0);
+          if (H_POLARIZATION) E_0 = 1.0 * (phi_hat + I * 0.0);
           else E_0 = -1.0 * (theta_hat + I * 0.0);
-          blitz::Array<std::complex<float>, 1> V_CFIE;
-          local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
-          local_V_CFIE_plane (V_CFIE, E_0, k_hat, r_ref, local_target_mesh, octtree.w, octtree.eps_r, octtree.mu_r, octtree.CFIE, V_FULL_PRECISION);
-          local_target_mesh.resizeToZero();
+          blitz::Array<std::complex<float>, 1> V_CFIE(N_local_RWG);
+          V_CFIE = V_CFIE_batch(pol * N_batch + b, blitz::Range::all());
           // solving
-          octtree.setNumberOfUpdates(0);
-          if (USE_PREVIOUS_SOLUTION != 1) ZI = 0.0;
-          if (SOLVER=="BICGSTAB") bicgstab(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-          else if (SOLVER=="GMRES") gmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-          else if ((SOLVER=="RGMRES") || (SOLVER=="FGMRES")) fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
+          if (BLOCK_SOLVE) ZI = ZI_batch(pol * N_batch + b, blitz::Range::all());
           else {
-            cout << "Bad solver choice!! Solver is BICGSTAB or (F)GMRES, and you chose " << SOLVER << endl;
-            exit(1);
+            octtree.setNumberOfUpdates(0);
+            if (SOLVER=="FGMRES") solveForExcitation(ZI, error, iter, flag, matvec, psolveFGMRES, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
+            else solveForExcitation(ZI, error, iter, flag, matvec, psolve, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
           }
           // far field computation
           blitz::Array<std::complex<float>, 2> e_theta_far, e_phi_far;
@@ -820,7 +1528,7 @@ void computeMonostaticRCS(Octtree & octtree,
           // (E_theta, E_phi) = exp(-j*k*R)/R * (e_theta_far, e_phi_far)
           octtree.computeFarField(e_theta_far, e_phi_far, r_phase_center, thetas, phis, ZI, OCTTREE_DATA_PATH);
           // filling of the RCS Arrays
-          if (HH || HV) {
+          if (H_POLARIZATION) {
             RCS_HH(i) = 4.0*M_PI * real(e_phi_far(0, 0) * conj(e_phi_far(0, 0)))/real(sum(E_0 * conj(E_0)));
             RCS_HV(i) = 4.0*M_PI * real(e_theta_far(0, 0) * conj(e_theta_far(0, 0)))/real(sum(E_0 * conj(E_0)));
             // JPA : we also keep the monostatic fields
@@ -879,54 +1587,69 @@ void computeMonostaticRCS(Octtree & octtree,
     const int BetaPoints = static_cast<int>(floor(Beta/Delta_Phi)) + 1;
     Beta = (BetaPoints-1) * Delta_Phi;
     if (my_id==master) cout << "number of BetaPoints for monostatic-bistatic approximation = " << BetaPoints << endl;
+    const bool BLOCK_SOLVE = ((SOLVER=="GMRES") && (USE_PREVIOUS_SOLUTION != 1));
     // loop for monostatic sigma computation
-    for (int excitation=0 ; excitation<2 ; ++excitation) { // 0 for H, 1 for V
-      const bool HH = ((excitation==0) && (COMPUTE_RCS_HH==1));
-      const bool HV = ((excitation==0) && (COMPUTE_RCS_HV==1));
-      const bool VH = ((excitation==1) && (COMPUTE_RCS_VH==1));
-      const bool VV = ((excitation==1) && (COMPUTE_RCS_VV==1));
-      const bool cond = (HH || HV || VH || VV);
-      if (cond) {
-        for (int t=0 ; t<N_theta ; ++t) {
+    for (int t=0 ; t<N_theta ; ++t) {
+      const float theta = octtreeXthetas_coarsest(t);
+      // the incidence angles phi_inc of this theta
+      const int N_phi_inc = (N_phi + BetaPoints - 1)/BetaPoints;
+      blitz::Array<float, 1> phis_inc(N_phi_inc), thetas_inc(N_phi_inc);
+      float phi_inc = octtreeXphis_coarsest(0) + Beta/2.0;
+      for (int p=0 ; p<N_phi_inc ; ++p) {
+        phis_inc(p) = phi_inc;
+        phi_inc += BetaPoints * Delta_Phi; // += Beta;
+      }
+      thetas_inc = theta;
+      // the previous solution of each polarization
+      blitz::Array<std::complex<float>, 2> ZI_previous(N_polarizations, N_local_RWG);
+      ZI_previous = 0.0;
+      for (int startPhiInc=0 ; startPhiInc<N_phi_inc ; startPhiInc+=V_CFIE_PLANE_WAVES_BATCH_SIZE) {
+        const int N_batch = min(V_CFIE_PLANE_WAVES_BATCH_SIZE, N_phi_inc - startPhiInc);
+        const blitz::Range batch(startPhiInc, startPhiInc + N_batch - 1);
+        // the excitation vectors of both polarizations in one pass over the mesh
+        blitz::Array<std::complex<float>, 2> V_CFIE_batch;
+        monostaticExcitationVectors(V_CFIE_batch, thetas_inc(batch), phis_inc(batch), 100.0, H_EXCITATION, V_EXCITATION, r_ref, local_target_mesh, octtree, V_FULL_PRECISION, V_CFIE_N_THREADS);
+        blitz::Array<std::complex<float>, 2> ZI_batch;
+        if (BLOCK_SOLVE) {
+          ZI_batch.resize(N_polarizations * N_batch, N_local_RWG);
+          ZI_batch = 0.0;
+          solveMonostaticBatchGMRES(ZI_batch, iter, blockMatvec, blockPsolve, octtree, V_CFIE_batch, polarizationIsH, t * N_phi_inc + startPhiInc, TOL, RESTART, MAXITER, GMRES_MULTIPLE_RHS_BATCH_SIZE, ITERATIVE_DATA_PATH);
+        }
+        for (int pol=0 ; pol<N_polarizations ; ++pol) {
+          const bool H_POLARIZATION = polarizationIsH[pol];
           blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
-          ZI = 0.0;
-          const float theta = octtreeXthetas_coarsest(t);
-          float phi_inc = octtreeXphis_coarsest(0) + Beta/2.0;
-          int startIndexPhi = 0;
-          while (startIndexPhi<N_phi) {
+          ZI = ZI_previous(pol, blitz::Range::all());
+          for (int b=0 ; b<N_batch ; b++) {
+            const int p = startPhiInc + b;
+            const int startIndexPhi = p * BetaPoints;
+            phi_inc = phis_inc(p);
             octtree.resizeSdownLevelsToZero();
             if (my_id==master) {
-              if (HH || HV) cout << "\nHH and HV, theta = "<< theta * 180.0/M_PI << ", phi = " << phi_inc * 180.0/M_PI << endl;
+              if (H_POLARIZATION) cout << "\nHH and HV, theta = "<< theta * 180.0/M_PI << ", phi = " << phi_inc * 180.0/M_PI << endl;
               else cout << "\nVV and VH, theta = "<< theta * 180.0/M_PI << ", phi = " << phi_inc * 180.0/M_PI << endl;
               flush(cout);
             }
             // local coordinate system
-            blitz::Array<double, 1> r_hat(3), theta_hat(3), phi_hat(3);
-            r_hat = sin(theta)*cos(phi_inc), sin(theta)*sin(phi_inc), cos(theta);
+            blitz::Array<double, 1> theta_hat(3), phi_hat(3);
             theta_hat = cos(theta)*cos(phi_inc), cos(theta)*sin(phi_inc), -sin(theta);
             phi_hat = -sin(phi_inc), cos(phi_inc), 0.0;
-            blitz::Array<double, 1> k_hat(-1.0 * r_hat);
 
             // excitation field
             blitz::Array<std::complex<double>, 1> E_0(3);
-            if (HH || HV) E_0 = 100.0 * (phi_hat + I * 0.0);
+            if (H_POLARIZATION) E_0 = 100.0 * (phi_hat + I * 0.0);
             else E_0 = -100.0 * (theta_hat + I * 0.0);
-            blitz::Array<std::complex<float>, 1> V_CFIE;
-            local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
-            local_V_CFIE_plane (V_CFIE, E_0, k_hat, r_ref, local_target_mesh, octtree.w, octtree.eps_r, octtree.mu_r, octtree.CFIE, V_FULL_PRECISION);
-            local_target_mesh.resizeToZero();
+            blitz::Array<std::complex<float>, 1> V_CFIE(N_local_RWG);
+            V_CFIE = V_CFIE_batch(pol * N_batch + b, blitz::Range::all());
             // solving
-            octtree.setNumberOfUpdates(0);
-            if (USE_PREVIOUS_SOLUTION != 1) ZI = 0.0;
+            if (BLOCK_SOLVE) ZI = ZI_batch(pol * N_batch + b, blitz::Range::all());
             else {
-              for (int pp=0; pp<V_CFIE.size(); pp++) ZI(pp) = (abs(V_CFIE(pp)) > 1e-15) ? ZI(pp) * V_CFIE(pp)/abs(V_CFIE(pp)) : ZI(pp);
-            }
-            if (SOLVER=="BICGSTAB") bicgstab(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-            else if (SOLVER=="GMRES") gmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-            else if ((SOLVER=="RGMRES") || (SOLVER=="FGMRES")) fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-            else {
-              cout << "Bad solver choice!! Solver is BICGSTAB or (F)GMRES, and you chose " << SOLVER << endl;
-              exit(1);
+              octtree.setNumberOfUpdates(0);
+              if (USE_PREVIOUS_SOLUTION != 1) ZI = 0.0;
+              else {
+                for (int pp=0; pp<V_CFIE.size(); pp++) ZI(pp) = (abs(V_CFIE(pp)) > 1e-15) ? ZI(pp) * V_CFIE(pp)/abs(V_CFIE(pp)) : ZI(pp);
+              }
+              if (SOLVER=="FGMRES") solveForExcitation(ZI, error, iter, flag, matvec, psolveFGMRES, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
+              else solveForExcitation(ZI, error, iter, flag, matvec, psolve, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
             }
             // far field computation
             blitz::Array<std::complex<float>, 2> e_theta_far, e_phi_far;
@@ -946,7 +1669,7 @@ void computeMonostaticRCS(Octtree & octtree,
             octtree.computeFarField(e_theta_far, e_phi_far, r_phase_center, thetas, phis, ZI, OCTTREE_DATA_PATH);
             for (int pp=0; pp<V_CFIE.size(); pp++) ZI(pp) = (abs(V_CFIE(pp)) > 1e-15) ? ZI(pp) * abs(V_CFIE(pp))/V_CFIE(pp) : ZI(pp);
             // filling of the RCS Arrays
-            if (HH || HV) {
+            if (H_POLARIZATION) {
               for (int j=0 ; j<BetaPoints ; ++j) {
                 RCS_HH(t, startIndexPhi + j) = 4.0*M_PI * real(e_phi_far(0, j) * conj(e_phi_far(0, j)))/real(sum(E_0 * conj(E_0)));
                 RCS_HV(t, startIndexPhi + j) = 4.0*M_PI * real(e_theta_far(0, j) * conj(e_theta_far(0, j)))/real(sum(E_0 * conj(E_0)));
@@ -966,16 +1689,14 @@ void computeMonostaticRCS(Octtree & octtree,
                 // end JPA
               }
             }
-            // phi update
-            startIndexPhi += BetaPoints;
-            phi_inc += BetaPoints * Delta_Phi; // += Beta;
-            if (my_id==master) {
-              writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_HH_ASCII.txt", RCS_HH);
-              writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_HV_ASCII.txt", RCS_HV);
-              writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_VV_ASCII.txt", RCS_VV);
-              writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_VH_ASCII.txt", RCS_VH);
-            }
           }
+          ZI_previous(pol, blitz::Range::all()) = ZI;
+        }
+        if (my_id==master) {
+          writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_HH_ASCII.txt", RCS_HH);
+          writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_HV_ASCII.txt", RCS_HV);
+          writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_VV_ASCII.txt", RCS_VV);
+          writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "RCS_VH_ASCII.txt", RCS_VH);
         }
       }
     }
@@ -998,6 +1719,7 @@ void computeMonostaticRCS(Octtree & octtree,
       writeIntToASCIIFile(ITERATIVE_DATA_PATH + "iter.txt", iter);
     }
   } // end if (ANGLES_FROM_FILE==1) else 
+  local_target_mesh.resizeToZero();
 }
 
 void computeMonostaticSAR(Octtree & octtree,
@@ -1035,18 +1757,23 @@ void computeMonostaticSAR(Octtree & octtree,
   MatvecFunctor< std::complex<float>, MatvecMLFMA > matvec(&matvecMLFMA, &MatvecMLFMA::matvec);
   LeftFrobPsolveMLFMA leftFrobPsolveMLFMA(N_RWG, localRWGNumbers, SIMU_DIR);
   PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
-  if (SOLVER=="FGMRES") {
-    string INNER_SOLVER;
-    readStringFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_SOLVER.txt", INNER_SOLVER);
-    int INNER_MAXITER, INNER_RESTART;
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_MAXITER.txt", INNER_MAXITER);
-    readIntFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_RESTART.txt", INNER_RESTART);
-    double INNER_TOL;
-    readDoubleFromASCIIFile(ITERATIVE_DATA_PATH + "INNER_TOL.txt", INNER_TOL);
-    PsolveAMLFMA psolveAMLFMA(matvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
-    PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolve(&psolveAMLFMA, &PsolveAMLFMA::psolve);
-  }
-  else PrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > psolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolve);
+  // with GMRES and no warm start, the positions of a batch are solved in lockstep
+  BlockMatvecFunctor< std::complex<float>, MatvecMLFMA > blockMatvec(&matvecMLFMA, &MatvecMLFMA::matvecBlock);
+  BlockPrecondFunctor< std::complex<float>, LeftFrobPsolveMLFMA > blockPsolve(&leftFrobPsolveMLFMA, &LeftFrobPsolveMLFMA::psolveBlock);
+  int GMRES_MULTIPLE_RHS_BATCH_SIZE;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GMRES_MULTIPLE_RHS_BATCH_SIZE.txt", GMRES_MULTIPLE_RHS_BATCH_SIZE);
+  const bool BLOCK_SOLVE = ((SOLVER=="GMRES") && (USE_PREVIOUS_SOLUTION != 1));
+  // GCRO-DR recycles a deflation subspace from one SAR position to the next
+  int GCRODR_RECYCLED_DIMENSION;
+  readIntFromASCIIFile(ITERATIVE_DATA_PATH + "GCRODR_RECYCLED_DIMENSION.txt", GCRODR_RECYCLED_DIMENSION);
+  RecycledSubspace< std::complex<float> > recycledSubspace(N_local_RWG, (SOLVER=="GCRODR") ? GCRODR_RECYCLED_DIMENSION : 0);
+  string INNER_SOLVER;
+  double INNER_TOL;
+  int INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA;
+  readInnerSolverParameters(INNER_SOLVER, INNER_TOL, INNER_MAXITER, INNER_RESTART, INNER_COARSE_MLFMA, octtree, SOLVER, ITERATIVE_DATA_PATH);
+  MatvecMLFMA innerMatvecMLFMA(octtree, N_RWG, localRWGNumbers, SIMU_DIR, INNER_COARSE_MLFMA);
+  PsolveAMLFMA psolveAMLFMA(innerMatvecMLFMA, leftFrobPsolveMLFMA, INNER_TOL, INNER_MAXITER, INNER_RESTART, N_RWG, INNER_SOLVER, SIMU_DIR);
+  PrecondFunctor< std::complex<float>, PsolveAMLFMA > psolveFGMRES(&psolveAMLFMA, &PsolveAMLFMA::psolve);
   // getting the positions at which monostatic SAR must be computed
   blitz::Array<double, 1> SAR_local_x_hat(3), SAR_local_y_hat(3), SAR_plane_origin(3);
   readDoubleBlitzArray1DFromASCIIFile(V_CFIE_DATA_PATH + "SAR_local_x_hat.txt", SAR_local_x_hat);
@@ -1095,29 +1822,33 @@ void computeMonostaticSAR(Octtree & octtree,
     const bool VV = ((excitation==1) && (COMPUTE_RCS_VV==1));
     const bool cond = (HH || HV || VH || VV);
     if (cond) {
+      // the SAR positions are solved by batches of one grid line. The line is swept in
+      // alternate directions, so that each solve starts from the solution at the adjacent
+      // position, and the mesh is loaded once per batch for the excitations and the fields.
+      blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
+      ZI = 0.0;
       for (int t=0 ; t<SAR_N_y_points ; ++t) {
-        blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
-        ZI = 0.0;
-        for (int s=0 ; s<SAR_N_x_points ; ++s) {
-          int index = t * SAR_N_x_points + s;
+        const int N_batch = SAR_N_x_points;
+        blitz::Array<int, 1> batchIndexes(N_batch);
+        blitz::Array<std::complex<float>, 2> V_CFIE_batch(N_batch, N_local_RWG), ZI_batch(N_batch, N_local_RWG);
+        blitz::Array<std::complex<double>, 2> E_0_batch(N_batch, 3);
+        // excitations of the batch
+        local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
+        for (int b=0 ; b<N_batch ; ++b) {
+          const int s = ((t%2)==0) ? b : N_batch-1-b;
+          const int index = t * SAR_N_x_points + s;
+          batchIndexes(b) = index;
           blitz::Array<double, 1> r_src(3);
           r_src = SAR_plane_origin + SAR_x_span_offset * SAR_local_x_hat + SAR_y_span_offset * SAR_local_y_hat;
           r_src += s * Delta_x * SAR_local_x_hat + t * Delta_y * SAR_local_y_hat;
           r_SAR(index, all) = 1.0 * r_src;
-          octtree.resizeSdownLevelsToZero();
-          if (my_id==master) {
-            if (HH || HV) blitz::cout << "\nHH and HV, r_ant = "<< r_src << blitz::endl;
-            else blitz::cout << "\nVV and VH, r_ant = "<< r_src << blitz::endl;
-            blitz::flush(blitz::cout);
-          }
           // excitation field
-          blitz::Array<std::complex<double>, 1> J_ant(3), E_0(3);
+          blitz::Array<std::complex<double>, 1> J_ant(3);
           if (HH || HV) J_ant = 100. * SAR_local_x_hat;
           else J_ant = 100. * SAR_local_y_hat;
           blitz::Array<std::complex<float>, 1> V_CFIE;
-          local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
           local_V_CFIE_dipole (V_CFIE, J_ant, r_src, local_target_mesh, w, eps_r, mu_r, octtree.CFIE, V_FULL_PRECISION);
-          local_target_mesh.resizeToZero();
+          V_CFIE_batch(b, all) = V_CFIE;
           // target incoming field: reference field for RCS computation
           std::vector< std::vector < std::complex<double> > > G_EJ, G_HJ;
           G_EJ.resize(3);
@@ -1132,46 +1863,77 @@ void computeMonostaticSAR(Octtree & octtree,
             r_obs2[m] = r_ref(m);
           }
           G_EJ_G_HJ (G_EJ, G_HJ, r_dip, r_obs2, eps, mu, k);
-          for (int m=0 ; m<3 ; m++) E_0(m) = G_EJ [m][0] * J_ant(0) + G_EJ[m][1] * J_ant(1) + G_EJ[m][2] * J_ant(2);
-          // solving
-          octtree.setNumberOfUpdates(0);
-          if (USE_PREVIOUS_SOLUTION != 1) ZI = 0.0;
-          if (SOLVER=="BICGSTAB") bicgstab(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-          else if (SOLVER=="GMRES") gmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-          else if ((SOLVER=="RGMRES") || (SOLVER=="FGMRES")) fgmres(ZI, error, iter, flag, matvec, psolve, V_CFIE, TOL, RESTART, MAXITER, my_id, num_procs, ITERATIVE_DATA_PATH + "/convergence.txt");
-          else {
-            cout << "Bad solver choice!! Solver is BICGSTAB or (F)GMRES, and you chose " << SOLVER << endl;
-            exit(1);
+          for (int m=0 ; m<3 ; m++) E_0_batch(b, m) = G_EJ [m][0] * J_ant(0) + G_EJ[m][1] * J_ant(1) + G_EJ[m][2] * J_ant(2);
+        }
+        local_target_mesh.resizeToZero();
+        // solving
+        if (BLOCK_SOLVE) {
+          std::vector<string> names, convergenceDetailedOutputs;
+          for (int b=0 ; b<N_batch ; ++b) {
+            names.push_back(string((HH || HV) ? "H" : "V") + " SAR position " + intToString(batchIndexes(b)));
+            convergenceDetailedOutputs.push_back(ITERATIVE_DATA_PATH + "/convergence_rhs" + intToString(b) + ".txt");
           }
-          // field computation (O(N) version)
-          blitz::Array<double, 2> r_obs(1, 3);
-          blitz::Array<std::complex<double>, 2> E_obs(1, 3), H_obs(1, 3);
-          r_obs(0, all) = r_ref;
-          local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
-          computeE_obs(E_obs, H_obs, r_obs, local_target_mesh, ZI, static_cast<complex<float> >(eps_r), static_cast<complex<float> >(mu_r), w);
-          local_target_mesh.resizeToZero();
-          // filling of the RCS Arrays
+          blitz::Array<double, 1> errors;
+          blitz::Array<int, 1> iters, flags;
+          int N_matvecs = 0;
+          ZI_batch = 0.0;
+          solveForExcitationsGMRES(ZI_batch, errors, iters, flags, N_matvecs, blockMatvec, blockPsolve, octtree, V_CFIE_batch, TOL, RESTART, MAXITER, GMRES_MULTIPLE_RHS_BATCH_SIZE, names, convergenceDetailedOutputs);
+          octtree.setNumberOfUpdates(N_matvecs);
+          iter = max(iters);
+        }
+        else {
+          for (int b=0 ; b<N_batch ; ++b) {
+            octtree.resizeSdownLevelsToZero();
+            if (my_id==master) {
+              if (HH || HV) blitz::cout << "\nHH and HV, r_ant = "<< r_SAR(batchIndexes(b), all) << blitz::endl;
+              else blitz::cout << "\nVV and VH, r_ant = "<< r_SAR(batchIndexes(b), all) << blitz::endl;
+              blitz::flush(blitz::cout);
+            }
+            octtree.setNumberOfUpdates(0);
+            if (USE_PREVIOUS_SOLUTION != 1) ZI = 0.0;
+            blitz::Array<std::complex<float>, 1> V_CFIE(N_local_RWG);
+            V_CFIE = V_CFIE_batch(b, all);
+            if (SOLVER=="FGMRES") solveForExcitation(ZI, error, iter, flag, matvec, psolveFGMRES, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
+            else solveForExcitation(ZI, error, iter, flag, matvec, psolve, V_CFIE, SOLVER, TOL, RESTART, MAXITER, recycledSubspace, ITERATIVE_DATA_PATH + "/convergence.txt");
+            ZI_batch(b, all) = ZI;
+          }
+        }
+        octtree.resizeSdownLevelsToZero();
+        // field computation (O(N) version) for the whole batch, with a single reduction
+        blitz::Array<std::complex<float>, 2> local_E_obs(N_batch, 3), E_obs(N_batch, 3);
+        local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
+        for (int b=0 ; b<N_batch ; ++b) {
+          blitz::Array<std::complex<float>, 1> E_tmp(3), H_tmp(3), ZI_tmp(N_local_RWG);
+          ZI_tmp = ZI_batch(b, all);
+          local_compute_E_obs(E_tmp, H_tmp, r_ref, ZI_tmp, local_target_mesh, w, eps_r, mu_r, 1);
+          local_E_obs(b, all) = E_tmp;
+        }
+        local_target_mesh.resizeToZero();
+        MPI_Allreduce(local_E_obs.data(), E_obs.data(), local_E_obs.size(), MPI_COMPLEX, MPI_SUM, MPI_COMM_WORLD);
+        // filling of the RCS Arrays
+        for (int b=0 ; b<N_batch ; ++b) {
+          const int index = batchIndexes(b);
+          blitz::Array<std::complex<double>, 1> E_0(3), E_obs_b(3);
+          E_0 = E_0_batch(b, all);
+          for (int m=0 ; m<3 ; m++) E_obs_b(m) = E_obs(b, m);
+          blitz::Array<std::complex<double>, 1> E_H(3), E_V(3);
+          E_H = sum(SAR_local_x_hat * E_obs_b);
+          E_V = sum(SAR_local_y_hat * E_obs_b);
           if (HH || HV) {
-            blitz::Array<std::complex<double>, 1> E_H(3), E_V(3);
-            E_H = sum(SAR_local_x_hat * E_obs(0, all));
-            E_V = sum(SAR_local_y_hat * E_obs(0, all));
             RCS_HH(index) = real(sum(E_H * conj(E_H)))/real(sum(E_0 * conj(E_0)) * 4.0*M_PI);
             RCS_HV(index) = real(sum(E_V * conj(E_V)))/real(sum(E_0 * conj(E_0)) * 4.0*M_PI);
           }
           else {
-            blitz::Array<std::complex<double>, 1> E_H(3), E_V(3);
-            E_H = sum(SAR_local_x_hat * E_obs(0, all));
-            E_V = sum(SAR_local_y_hat * E_obs(0, all));
             RCS_VV(index) = real(sum(E_V * conj(E_V)))/real(sum((E_0 * conj(E_0))) * 4.0*M_PI);
             RCS_VH(index) = real(sum(E_H * conj(E_H)))/real(sum(E_0 * conj(E_0)) * 4.0*M_PI);
           }
-          if (my_id==master) {
-            writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_HH_ASCII.txt", RCS_HH);
-            writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_HV_ASCII.txt", RCS_HV);
-            writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_VH_ASCII.txt", RCS_VH);
-            writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_VV_ASCII.txt", RCS_VV);
-            writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "r_SAR.txt", r_SAR);
-          }
+        }
+        if (my_id==master) {
+          writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_HH_ASCII.txt", RCS_HH);
+          writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_HV_ASCII.txt", RCS_HV);
+          writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_VH_ASCII.txt", RCS_VH);
+          writeFloatBlitzArray1DToASCIIFile(RESULT_DATA_PATH + "SAR_RCS_VV_ASCII.txt", RCS_VV);
+          writeFloatBlitzArray2DToASCIIFile(RESULT_DATA_PATH + "r_SAR.txt", r_SAR);
         }
       }
     }
@@ -1366,6 +2128,269 @@ void mesh_distribution(LocalMesh & local_target_mesh,
   RWGNumber_signedTriangles.free();
 }
 
+//! collective read of some rows of a binary (row-major, no header) array file
+/*!
+  Each process reads only the rows it asks for, through an MPI-IO file view. The
+  rows may be in any order and repeated: they are read once, in increasing order,
+  and then copied in the requested order to A (of size rows.size() * rowSize).
+*/
+template <typename T>
+void readRowsFromBinaryFileMPI_IO(std::vector<T>& A,
+                                  const string filename,
+                                  const std::vector<int>& rows,
+                                  const int rowSize,
+                                  MPI_Datatype itemType)
+{
+  std::vector<int> sortedRows(rows);
+  std::sort(sortedRows.begin(), sortedRows.end());
+  sortedRows.erase(std::unique(sortedRows.begin(), sortedRows.end()), sortedRows.end());
+  const int N_rows = sortedRows.size();
+  int dummy = 0;
+  MPI_Datatype rowType, fileType;
+  MPI_Type_contiguous(rowSize, itemType, &rowType);
+  MPI_Type_commit(&rowType);
+  MPI_Type_create_indexed_block(N_rows, 1, (N_rows>0) ? &sortedRows[0] : &dummy, rowType, &fileType);
+  MPI_Type_commit(&fileType);
+  MPI_File fh;
+  if (MPI_File_open(MPI_COMM_WORLD, const_cast<char*>(filename.c_str()), MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+    cout << "mpi_mlfma.cpp::readRowsFromBinaryFileMPI_IO: error opening " << filename << endl;
+    exit(1);
+  }
+  MPI_File_set_view(fh, 0, itemType, fileType, const_cast<char*>("native"), MPI_INFO_NULL);
+  std::vector<T> buffer(max(N_rows * rowSize, 1));
+  MPI_File_read_all(fh, &buffer[0], N_rows * rowSize, itemType, MPI_STATUS_IGNORE);
+  MPI_File_close(&fh);
+  MPI_Type_free(&fileType);
+  MPI_Type_free(&rowType);
+  A.resize(rows.size() * rowSize);
+  for (unsigned int i=0 ; i<rows.size() ; ++i) {
+    const int index = std::lower_bound(sortedRows.begin(), sortedRows.end(), rows[i]) - sortedRows.begin();
+    for (int j=0 ; j<rowSize ; ++j) A[i*rowSize + j] = buffer[index*rowSize + j];
+  }
+}
+
+//! each process reads its own part of the mesh, instead of receiving it from the master
+/*!
+  Same result as mesh_distribution. The files of the mesh of the master process
+  (GLOBAL_MESH_DATA_PATH) must be on a file system shared by all the processes.
+*/
+void mesh_distribution_MPI_IO(LocalMesh & local_target_mesh,
+                              blitz::Array<int, 1>& local_cubes_NRWG,
+                              const blitz::Array<int, 1>& oldIndexesOfCubes,
+                              const int C,
+                              const string GLOBAL_MESH_DATA_PATH)
+{
+  const int my_id = MPI::COMM_WORLD.Get_rank(), master = 0;
+  // the numbers of RWGs of the cubes are small enough to be broadcasted
+  blitz::Array<int, 1> cube_N_RWGs(C);
+  if (my_id==master) readIntBlitzArray1DFromBinaryFile(GLOBAL_MESH_DATA_PATH + "cube_N_RWGs.txt", cube_N_RWGs);
+  MPI_Bcast(cube_N_RWGs.data(), C, MPI_INT, master, MPI_COMM_WORLD);
+  std::vector<int> cube_startIndex_RWGs(C);
+  int startIndex = 0;
+  for (int i=0; i<C; i++) {
+    cube_startIndex_RWGs[i] = startIndex;
+    startIndex += cube_N_RWGs(i);
+  }
+  // the RWGs of the local cubes, read at the offsets of the cubes in cubes_RWGsNumbers
+  const int N_local_cubes = oldIndexesOfCubes.size();
+  local_cubes_NRWG.resize(N_local_cubes);
+  std::vector<int> positionsOfRWGs;
+  for (int i=0; i<N_local_cubes; i++) {
+    const int cubeNumber = oldIndexesOfCubes(i);
+    local_cubes_NRWG(i) = cube_N_RWGs(cubeNumber);
+    for (int j=0 ; j<cube_N_RWGs(cubeNumber) ; ++j) positionsOfRWGs.push_back(cube_startIndex_RWGs[cubeNumber] + j);
+  }
+  cube_N_RWGs.free();
+  std::vector<int> RWG_numbers, edgeVertexes, oppVertexes, signedTriangles, CFIE_OK;
+  readRowsFromBinaryFileMPI_IO(RWG_numbers, GLOBAL_MESH_DATA_PATH + "cubes_RWGsNumbers.txt", positionsOfRWGs, 1, MPI_INT);
+  positionsOfRWGs.clear();
+  readRowsFromBinaryFileMPI_IO(edgeVertexes, GLOBAL_MESH_DATA_PATH + "RWGNumber_edgeVertexes.txt", RWG_numbers, 2, MPI_INT);
+  readRowsFromBinaryFileMPI_IO(oppVertexes, GLOBAL_MESH_DATA_PATH + "RWGNumber_oppVertexes.txt", RWG_numbers, 2, MPI_INT);
+  readRowsFromBinaryFileMPI_IO(signedTriangles, GLOBAL_MESH_DATA_PATH + "RWGNumber_signedTriangles.txt", RWG_numbers, 2, MPI_INT);
+  readRowsFromBinaryFileMPI_IO(CFIE_OK, GLOBAL_MESH_DATA_PATH + "RWGNumber_CFIE_OK.txt", RWG_numbers, 1, MPI_INT);
+  // the vertexes of the local RWGs, in the order n0, n1, n2, n3 of localRWGNumber_trianglesCoord
+  const int NRWG = RWG_numbers.size();
+  std::vector<int> vertexesNumbers(NRWG * 4);
+  for (int i=0; i<NRWG; i++) {
+    vertexesNumbers[i*4] = oppVertexes[i*2];
+    vertexesNumbers[i*4 + 1] = edgeVertexes[i*2];
+    vertexesNumbers[i*4 + 2] = edgeVertexes[i*2 + 1];
+    vertexesNumbers[i*4 + 3] = oppVertexes[i*2 + 1];
+  }
+  std::vector<double> vertexes_coord;
+  readRowsFromBinaryFileMPI_IO(vertexes_coord, GLOBAL_MESH_DATA_PATH + "vertexes_coord.txt", vertexesNumbers, 3, MPI_DOUBLE);
+
+  local_target_mesh.N_local_RWG = NRWG;
+  local_target_mesh.localRWGNumbers.resize(NRWG);
+  local_target_mesh.localRWGNumber_CFIE_OK.resize(NRWG);
+  local_target_mesh.localRWGNumber_signedTriangles.resize(NRWG, 2);
+  local_target_mesh.localRWGNumber_trianglesCoord.resize(NRWG, 12);
+  for (int i=0; i<NRWG; i++) {
+    local_target_mesh.localRWGNumbers(i) = RWG_numbers[i];
+    local_target_mesh.localRWGNumber_CFIE_OK(i) = CFIE_OK[i];
+    local_target_mesh.localRWGNumber_signedTriangles(i, 0) = signedTriangles[i*2];
+    local_target_mesh.localRWGNumber_signedTriangles(i, 1) = signedTriangles[i*2 + 1];
+    for (int j=0; j<12; j++) local_target_mesh.localRWGNumber_trianglesCoord(i, j) = vertexes_coord[i*12 + j];
+  }
+  MPI_Barrier(MPI_COMM_WORLD);
+}
+
+//! key of a cube from its integer coordinates, ordered like the cube numbers
+long long cubeKey(const int x, const int y, const int z) {
+  return ( (static_cast<long long>(x) << 42) + (static_cast<long long>(y) << 21) + static_cast<long long>(z) );
+}
+
+//! each process gets only the leaf cubes that its tree needs, instead of all of them
+/*!
+  Each process reads a slice of cubes_centroids.txt with MPI-IO, and sends each leaf
+  cube of its slice to the processes that need it: the process owning the cube, and the
+  processes owning a cube whose father touches the father of an ancestor of the leaf
+  (at each level, one leaf per ancestor is enough to build the ancestor). One leaf per cube
+  of the level where the cubes are attributed is given to all the processes, so that
+  Octtree::assignCubesToProcessors gives the same attribution everywhere. That attribution
+  is reproduced here from the integer coordinates of the cubes, ordered as in Cube::operator<.
+  cubes_oldIndexes holds the rows of the received cubes in the files of the mesh.
+*/
+void distribute_cubes_centroids(blitz::Array<double, 2>& cubes_centroids,
+                                blitz::Array<int, 1>& cubes_oldIndexes,
+                                const int C,
+                                const string OCTTREE_DATA_PATH,
+                                const string GLOBAL_MESH_DATA_PATH)
+{
+  const int num_procs = MPI::COMM_WORLD.Get_size(), my_id = MPI::COMM_WORLD.Get_rank();
+  int N_levels, DIRECTIONS_PARALLELIZATION;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "N_active_levels.txt", N_levels);
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "DIRECTIONS_PARALLELIZATION.txt", DIRECTIONS_PARALLELIZATION);
+  double leaf_side_length;
+  readDoubleFromASCIIFile(OCTTREE_DATA_PATH + "leaf_side_length.txt", leaf_side_length);
+  blitz::Array<double, 1> bigCubeLowerCoord(3);
+  readDoubleBlitzArray1DFromASCIIFile(OCTTREE_DATA_PATH + "big_cube_lower_coord.txt", bigCubeLowerCoord);
+  // the level at which the cubes are attributed to the processes, the leaf level being 0
+  const int L_a = ( (DIRECTIONS_PARALLELIZATION==1) && (N_levels>1) ) ? N_levels-2 : N_levels-1;
+  // the slice of the leaf cubes read by this process
+  const int N_slice = C/num_procs + ( (my_id < C%num_procs) ? 1 : 0 );
+  const int startRow = (C/num_procs) * my_id + min(my_id, C%num_procs);
+  std::vector<int> rows(N_slice);
+  for (int i=0 ; i<N_slice ; ++i) rows[i] = startRow + i;
+  std::vector<double> slice;
+  readRowsFromBinaryFileMPI_IO(slice, GLOBAL_MESH_DATA_PATH + "cubes_centroids.txt", rows, 3, MPI_DOUBLE);
+  // integer coordinates of the leaf cubes, computed by the same function as in the Cube constructor
+  std::vector<int> coord(N_slice * 3);
+  for (int i=0 ; i<N_slice ; ++i) {
+    for (int m=0 ; m<3 ; ++m) {
+      coord[i*3 + m] = cubeCartesianCoord(slice[i*3 + m], bigCubeLowerCoord(m), leaf_side_length);
+    }
+  }
+
+  // one leaf of each cube of the attribution level, gathered by all the processes
+  std::map<long long, int> leafOfCube;
+  for (int i=0 ; i<N_slice ; ++i) leafOfCube.insert(std::make_pair(cubeKey(coord[i*3] >> L_a, coord[i*3+1] >> L_a, coord[i*3+2] >> L_a), i));
+  std::vector<double> localLeaves;
+  for (std::map<long long, int>::const_iterator it = leafOfCube.begin() ; it != leafOfCube.end() ; ++it) {
+    for (int m=0 ; m<3 ; ++m) localLeaves.push_back(slice[it->second * 3 + m]);
+    localLeaves.push_back(startRow + it->second);
+  }
+  int N_localLeaves = localLeaves.size();
+  std::vector<int> recvCounts(num_procs), displs(num_procs);
+  MPI_Allgather(&N_localLeaves, 1, MPI_INT, &recvCounts[0], 1, MPI_INT, MPI_COMM_WORLD);
+  int N_leaves = 0;
+  for (int i=0 ; i<num_procs ; ++i) {
+    displs[i] = N_leaves;
+    N_leaves += recvCounts[i];
+  }
+  std::vector<double> leaves(max(N_leaves, 1));
+  MPI_Allgatherv((N_localLeaves>0) ? &localLeaves[0] : 0, N_localLeaves, MPI_DOUBLE, &leaves[0], &recvCounts[0], &displs[0], MPI_DOUBLE, MPI_COMM_WORLD);
+  N_leaves /= 4;
+  // the attribution: round-robin on the cubes sorted by (fatherNumber, number)
+  std::vector< std::pair< std::pair<long long, long long>, int > > cubesOfLevel;
+  for (int i=0 ; i<N_leaves ; ++i) {
+    int c[3];
+    for (int m=0 ; m<3 ; ++m) c[m] = cubeCartesianCoord(leaves[i*4 + m], bigCubeLowerCoord(m), leaf_side_length) >> L_a;
+    cubesOfLevel.push_back(std::make_pair(std::make_pair(cubeKey(c[0] >> 1, c[1] >> 1, c[2] >> 1), cubeKey(c[0], c[1], c[2])), i));
+  }
+  std::sort(cubesOfLevel.begin(), cubesOfLevel.end());
+  std::map<long long, int> procOfCube;
+  std::vector<int> levelLeaves;
+  for (unsigned int i=0 ; i<cubesOfLevel.size() ; ++i) {
+    const long long key = cubesOfLevel[i].first.second;
+    if (procOfCube.find(key) == procOfCube.end()) {
+      const int procNumber = procOfCube.size() % num_procs;
+      procOfCube[key] = procNumber;
+      levelLeaves.push_back(cubesOfLevel[i].second);
+    }
+  }
+  if (static_cast<int>(procOfCube.size()) < num_procs) {
+    cout << "ERROR!! distribute_cubes_centroids: too few top-level cubes for the given number of processors" << endl;
+    exit(1);
+  }
+
+  // the processes needing each leaf of the slice
+  std::vector< std::vector<double> > buffToSend(num_procs);
+  std::set< std::pair< std::pair<int, long long>, int > > sentAncestors; // (level, ancestor key), process
+  for (int i=0 ; i<N_slice ; ++i) {
+    const int * c = &coord[i*3];
+    std::vector<int> procs;
+    procs.push_back(procOfCube[cubeKey(c[0] >> L_a, c[1] >> L_a, c[2] >> L_a)]);
+    for (int l=0 ; l<L_a ; ++l) {
+      // the processes owning a cube of level l whose father touches the father of the ancestor
+      const int f[3] = {c[0] >> (l+1), c[1] >> (l+1), c[2] >> (l+1)};
+      std::set<int> procsOfLevel;
+      for (int dx=-1 ; dx<2 ; ++dx) {
+        for (int dy=-1 ; dy<2 ; ++dy) {
+          for (int dz=-1 ; dz<2 ; ++dz) {
+            const int n[3] = {f[0] + dx, f[1] + dy, f[2] + dz};
+            if ( (n[0]<0) || (n[1]<0) || (n[2]<0) ) continue;
+            const int shift = L_a - (l+1);
+            std::map<long long, int>::const_iterator it = procOfCube.find(cubeKey(n[0] >> shift, n[1] >> shift, n[2] >> shift));
+            if (it != procOfCube.end()) procsOfLevel.insert(it->second);
+          }
+        }
+      }
+      const long long ancestorKey = cubeKey(c[0] >> l, c[1] >> l, c[2] >> l);
+      for (std::set<int>::const_iterator it = procsOfLevel.begin() ; it != procsOfLevel.end() ; ++it) {
+        if ( (l==0) || (sentAncestors.insert(std::make_pair(std::make_pair(l, ancestorKey), *it)).second) ) procs.push_back(*it);
+      }
+    }
+    std::sort(procs.begin(), procs.end());
+    procs.erase(std::unique(procs.begin(), procs.end()), procs.end());
+    for (unsigned int j=0 ; j<procs.size() ; ++j) {
+      for (int m=0 ; m<3 ; ++m) buffToSend[procs[j]].push_back(slice[i*3 + m]);
+      buffToSend[procs[j]].push_back(startRow + i);
+    }
+  }
+  std::vector<int> sendCounts(num_procs), sdispls(num_procs), rdispls(num_procs);
+  std::vector<double> sendBuff;
+  for (int i=0 ; i<num_procs ; ++i) {
+    sendCounts[i] = buffToSend[i].size();
+    sdispls[i] = sendBuff.size();
+    sendBuff.insert(sendBuff.end(), buffToSend[i].begin(), buffToSend[i].end());
+  }
+  MPI_Alltoall(&sendCounts[0], 1, MPI_INT, &recvCounts[0], 1, MPI_INT, MPI_COMM_WORLD);
+  int N_recv = 0;
+  for (int i=0 ; i<num_procs ; ++i) {
+    rdispls[i] = N_recv;
+    N_recv += recvCounts[i];
+  }
+  std::vector<double> recvBuff(max(N_recv, 1));
+  sendBuff.resize(max(static_cast<int>(sendBuff.size()), 1));
+  MPI_Alltoallv(&sendBuff[0], &sendCounts[0], &sdispls[0], MPI_DOUBLE, &recvBuff[0], &recvCounts[0], &rdispls[0], MPI_DOUBLE, MPI_COMM_WORLD);
+  N_recv /= 4;
+
+  // the received leaves and the leaves of the attribution level, without duplicates
+  std::map<int, const double *> neededLeaves;
+  for (int i=0 ; i<N_recv ; ++i) neededLeaves[static_cast<int>(recvBuff[i*4 + 3])] = &recvBuff[i*4];
+  for (unsigned int i=0 ; i<levelLeaves.size() ; ++i) neededLeaves[static_cast<int>(leaves[levelLeaves[i]*4 + 3])] = &leaves[levelLeaves[i]*4];
+  const int N_cubes = neededLeaves.size();
+  cubes_centroids.resize(N_cubes, 3);
+  cubes_oldIndexes.resize(N_cubes);
+  int j = 0;
+  for (std::map<int, const double *>::const_iterator it = neededLeaves.begin() ; it != neededLeaves.end() ; ++it, ++j) {
+    for (int m=0 ; m<3 ; ++m) cubes_centroids(j, m) = it->second[m];
+    cubes_oldIndexes(j) = it->first;
+  }
+  if (my_id==0) cout << "distributed octtree setup: process 0 holds " << N_cubes << " leaf cubes out of " << C << endl;
+}
+
 /****************************************************************************/
 /******************************* main ***************************************/
 /****************************************************************************/
@@ -1397,23 +2422,41 @@ int main(int argc, char* argv[]) {
   {
     string filename = MESH_DATA_PATH + "C.txt";
     readIntFromASCIIFile(filename, C);
-    cubes_centroids.resize(C, 3);
-    filename = MESH_DATA_PATH + "cubes_centroids.txt";
-    readDoubleBlitzArray2DFromBinaryFile(filename, cubes_centroids);
   }
   MPI_Bcast(&C, 1, MPI_INT, 0, MPI_COMM_WORLD);
-  if (my_id!=0) cubes_centroids.resize(C, 3);
-  MPI_Bcast(cubes_centroids.data(), cubes_centroids.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  // with DISTRIBUTED_OCTTREE, each process builds its tree only from the cubes it needs
+  int DISTRIBUTED_OCTTREE, ALLOW_CEILING_LEVEL;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "DISTRIBUTED_OCTTREE.txt", DISTRIBUTED_OCTTREE);
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "ALLOW_CEILING_LEVEL.txt", ALLOW_CEILING_LEVEL);
+  if ( (DISTRIBUTED_OCTTREE==1) && (ALLOW_CEILING_LEVEL==1) ) {
+    if (my_id==0) cout << "DISTRIBUTED_OCTTREE is not possible with ALLOW_CEILING_LEVEL: the cubes are broadcasted" << endl;
+    DISTRIBUTED_OCTTREE = 0;
+  }
+  blitz::Array<int, 1> cubes_oldIndexes;
+  if (DISTRIBUTED_OCTTREE==1) distribute_cubes_centroids(cubes_centroids, cubes_oldIndexes, C, OCTTREE_DATA_PATH, SIMU_DIR + "/tmp0/mesh/");
+  else {
+    cubes_centroids.resize(C, 3);
+    if (my_id==0) readDoubleBlitzArray2DFromBinaryFile(MESH_DATA_PATH + "cubes_centroids.txt", cubes_centroids);
+    MPI_Bcast(cubes_centroids.data(), cubes_centroids.size(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  }
   // Octtree creation based upon the cubes_centroids
   Octtree octtree(OCTTREE_DATA_PATH, cubes_centroids, my_id, num_procs);
   cubes_centroids.free();
   // partitioning of mesh
   blitz::Array<int, 1> oldIndexesOfCubes;
   octtree.computeIndexesOfCubesInOriginalMesh(oldIndexesOfCubes);
+  if (DISTRIBUTED_OCTTREE==1) {
+    // the tree only knows the indexes of the cubes in cubes_centroids
+    for (int i=0 ; i<oldIndexesOfCubes.size() ; ++i) oldIndexesOfCubes(i) = cubes_oldIndexes(oldIndexesOfCubes(i));
+    cubes_oldIndexes.free();
+  }
   LocalMesh local_target_mesh;
   blitz::Array<int, 1> local_cubes_NRWG;
 
-  mesh_distribution(local_target_mesh, local_cubes_NRWG, oldIndexesOfCubes, C, MESH_DATA_PATH);
+  int MESH_MPI_IO;
+  readIntFromASCIIFile(OCTTREE_DATA_PATH + "MESH_MPI_IO.txt", MESH_MPI_IO);
+  if (MESH_MPI_IO==1) mesh_distribution_MPI_IO(local_target_mesh, local_cubes_NRWG, oldIndexesOfCubes, C, SIMU_DIR + "/tmp0/mesh/");
+  else mesh_distribution(local_target_mesh, local_cubes_NRWG, oldIndexesOfCubes, C, MESH_DATA_PATH);
   oldIndexesOfCubes.free();
 
   // now let's construct the octtree cubes local meshes!
@@ -1435,8 +2478,11 @@ int main(int argc, char* argv[]) {
   if (my_id==0) cout << "SOLVER IS = " << SOLVER << endl;
   MPI_Barrier(MPI_COMM_WORLD);
   // bistatic computation
-  if (BISTATIC==1) computeForOneExcitation(octtree, local_target_mesh, SOLVER, SIMU_DIR, TMP, OCTTREE_DATA_PATH, MESH_DATA_PATH, V_CFIE_DATA_PATH, RESULT_DATA_PATH, ITERATIVE_DATA_PATH);
-  // monostatic RCS computation
+  int MULTIPLE_EXCITATIONS = 0;
+  if (BISTATIC==1) readIntFromASCIIFile(V_CFIE_DATA_PATH + "MULTIPLE_EXCITATIONS.txt", MULTIPLE_EXCITATIONS);
+  if ((BISTATIC==1) && (MULTIPLE_EXCITATIONS==1)) computeForMultipleExcitations(octtree, local_target_mesh, SOLVER, SIMU_DIR, TMP, OCTTREE_DATA_PATH, MESH_DATA_PATH, V_CFIE_DATA_PATH, RESULT_DATA_PATH, ITERATIVE_DATA_PATH);
+  else if (BISTATIC==1) computeForOneExcitation(octtree, local_target_mesh, SOLVER, SIMU_DIR, TMP, OCTTREE_DATA_PATH, MESH_DATA_PATH, V_CFIE_DATA_PATH, RESULT_DATA_PATH, ITERATIVE_DATA_PATH);
+  // monostatic RCS computation. The local mesh stays loaded for all the angles
   local_target_mesh.setLocalMeshFromFile(MESH_DATA_PATH);
   if (MONOSTATIC_RCS==1) computeMonostaticRCS(octtree, local_target_mesh, SOLVER, SIMU_DIR, TMP, OCTTREE_DATA_PATH, MESH_DATA_PATH, V_CFIE_DATA_PATH, RESULT_DATA_PATH, ITERATIVE_DATA_PATH);
   // monostatic SAR computation
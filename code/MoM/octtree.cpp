@@ -6,6 +6,7 @@
 #include <blitz/array.h>
 #include <vector>
 #include <algorithm>
+#include <map>
 #include <mpi.h>
 
 using namespace std;
@@ -13,6 +14,8 @@ using namespace std;
 #include "octtree.h"
 #include "readWriteBlitzArrayFromFile.h"
 #include "interpolation.h"
+#include "V_E_V_H.h"
+#include "./amos/zbesh/zbesh_interface.h"
 
 /****************************************************************************/
 /********************************** Octtree *********************************/
@@ -30,6 +33,7 @@ Octtree::Octtree(const string octtree_data_path, const blitz::Array<double, 2>&
   this->setTotalNumProcs(num_procs);
   if ( (proc_id==0) && (VERBOSE==1) ) cout << "creating the tree on process " << proc_id << " from disk data" << endl;
   numberOfUpdates = 0;
+  COARSE_ALPHA_TRANSLATIONS = 0;
   readIntFromASCIIFile(octtree_data_path + "N_active_levels.txt", N_levels);
   if ( (proc_id==0) && (VERBOSE==1) ) cout << "N active levels = " << N_levels << endl;
   readIntFromASCIIFile(octtree_data_path + "ALLOW_CEILING_LEVEL.txt", ALLOW_CEILING_LEVEL);
@@ -167,6 +171,7 @@ Octtree::Octtree(const string octtree_data_path, const blitz::Array<double, 2>&
                              XphisNextLevel,
                              VERBOSE ) );
     levels[j].sortCubesByParents();
+    levels[j].computeSonsIndexes(levels[j-1]);
     levels[j-1].updateFatherIndexes(levels[j]);
     if (levels[j].getCubesSizeMB() < minCubesArraysSize) {
       minCubesArraysSize = levels[j].getCubesSizeMB();
@@ -259,33 +264,24 @@ void Octtree::assignCubesToProcessors(const int num_procs, const int CUBES_DISTR
     if (procNumber<num_procs-1) procNumber++; // we assign the next cube to the next process
     else procNumber = 0; // we start over again
   }
-  // we need to set the sonsProcNumbers for the finest directions-parallelized level L+1
+  // we need to set the sons process numbers for the finest directions-parallelized level L+1
   // it is not necessary for the higher directions-parallelized levels
   if ( (this->DIRECTIONS_PARALLELIZATION==1)&&(CUBES_DISTRIBUTION==0) ) {
-    NCubes = levels[L+1].getLevelSize();
-    for (int i=0 ; i<NCubes ; ++i) {
-      std::vector<int> sonsIndexes = levels[L+1].cubes[i].sonsIndexes;
-      const int N_sons = sonsIndexes.size();
-      levels[L+1].cubes[i].sonsProcNumbers.resize(N_sons);
-      for (int j=0 ; j<N_sons ; j++) {
-        const int sonIndex = sonsIndexes[j];
-        levels[L+1].cubes[i].sonsProcNumbers[j] = levels[L].cubes[sonIndex].procNumber;
-      }
-    }
+    const std::vector<int> & sonsIndexes = levels[L+1].cubesSonsIndexes;
+    levels[L+1].cubesSonsProcNumbers.resize(sonsIndexes.size());
+    for (unsigned int j=0 ; j<sonsIndexes.size() ; j++) levels[L+1].cubesSonsProcNumbers[j] = levels[L].cubes[sonsIndexes[j]].procNumber;
   }
   // now we attribute the sons to processes for cell-parallelized levels
   // the sons have the same procNumber as their father
   for (int l=L ; l>0 ; l--) { // we go down the levels
     NCubes = levels[l].getLevelSize();
     for (int i=0 ; i<NCubes ; ++i) {
-      std::vector<int> sonsIndexes = levels[l].cubes[i].sonsIndexes;
-      const int N_sons = sonsIndexes.size();
-      levels[l].cubes[i].sonsProcNumbers.resize(N_sons);
+      const int * sonsIndexes = levels[l].getSonsIndexes(i);
+      const int N_sons = levels[l].getNumberOfSons(i);
       for (int j=0 ; j<N_sons ; j++) {
         const int sonIndex = sonsIndexes[j];
         levels[l-1].cubes[sonIndex].procNumber = levels[l].cubes[i].procNumber;
         levels[l-1].cubes[sonIndex].fatherProcNumber = levels[l].cubes[i].procNumber;
-        levels[l].cubes[i].sonsProcNumbers[j] = levels[l-1].cubes[sonIndex].procNumber;
       }
     }
   }
@@ -306,6 +302,30 @@ void Octtree::computeIndexesOfCubesInOriginalMesh(blitz::Array<int, 1>& oldIndex
   levels[0].computeOldIndexesOfCubes(oldIndexesOfCubes);
 }
 
+void Octtree::alphaTranslationsCoarseComputation(const float thresholdRelValueMax)
+{
+  // computed once, the tree can then switch between full and coarse translations at each matvec
+  if ( (getProcNumber()==0) && (VERBOSE==1) ) cout << "computing the coarse alpha translations, relative threshold = " << thresholdRelValueMax << endl;
+  for (unsigned int j=0 ; j<levels.size() ; ++j) {
+    if (!levels[j].getAlphaTranslationsCoarse()) levels[j].alphaTranslationsCoarseComputation(thresholdRelValueMax);
+  }
+  if ( (getProcNumber()==0) && (VERBOSE==1) ) {
+    for (unsigned int j=0 ; j<levels.size() ; ++j) {
+      if (!levels[j].getAlphaTranslationsCoarse()) continue;
+      int N_full = 0, N_coarse = 0;
+      for (int x=0 ; x<levels[j].alphaTranslations.extent(0) ; ++x) {
+        for (int y=0 ; y<levels[j].alphaTranslations.extent(1) ; ++y) {
+          for (int z=0 ; z<levels[j].alphaTranslations.extent(2) ; ++z) {
+            N_full += levels[j].alphaTranslations(x, y, z).size();
+            N_coarse += levels[j].alphaTranslationsCoarseCounts(x, y, z);
+          }
+        }
+      }
+      cout << "  level " << levels[j].getLevel() << ": coarse/full alpha translations ratio = " << N_coarse * 1.0/max(N_full, 1) << endl;
+    }
+  }
+}
+
 void Octtree::computeGaussLocatedArguments(const blitz::Array<int, 1>& local_cubes_NRWG, 
                                            const blitz::Array<int, 1>& local_RWG_numbers, 
                                            const blitz::Array<int, 1>& local_RWG_Numbers_CFIE_OK, 
@@ -333,6 +353,15 @@ void Octtree::constructArrays(void)
   if (alphaTranslation_smoothing_factor>2.0) alphaTranslation_smoothing_factor = 2.0;
   if (alphaTranslation_RelativeCountAboveThreshold > 1.0) alphaTranslation_RelativeCountAboveThreshold = 1.0;
   if (alphaTranslation_RelativeCountAboveThreshold < 0.0) alphaTranslation_RelativeCountAboveThreshold = 0.0;
+  // the coarsest levels can have their alpha translations interpolated on the fly
+  int alphaTranslation_N_interpolated_levels, alphaTranslation_interpolation_order;
+  float alphaTranslation_interpolation_oversampling;
+  readIntFromASCIIFile(this->octtreeDataPath + "alphaTranslation_N_interpolated_levels.txt", alphaTranslation_N_interpolated_levels);
+  readIntFromASCIIFile(this->octtreeDataPath + "alphaTranslation_interpolation_order.txt", alphaTranslation_interpolation_order);
+  readFloatFromASCIIFile(this->octtreeDataPath + "alphaTranslation_interpolation_oversampling.txt", alphaTranslation_interpolation_oversampling);
+  for (int j=0 ; j<N_levels ; ++j) {
+    if ( (j >= N_levels - alphaTranslation_N_interpolated_levels) && (levels[j].DIRECTIONS_PARALLELIZATION!=1) ) levels[j].setAlphaTranslationsInterpolation(alphaTranslation_interpolation_order, alphaTranslation_interpolation_oversampling);
+  }
   for (int j=0 ; j<N_levels ; ++j) {
     levels[j].NCubesXYZComputation(VERBOSE);
     levels[j].alphaTranslationsComputation(VERBOSE, alphaTranslation_smoothing_factor, alphaTranslation_thresholdRelValueMax, alphaTranslation_RelativeCountAboveThreshold);
@@ -381,6 +410,7 @@ void Octtree::copyOcttree(const Octtree& octtreeTocopy) /// copy constructor
   DIRECTIONS_PARALLELIZATION = octtreeTocopy.DIRECTIONS_PARALLELIZATION;
   N_levels = octtreeTocopy.N_levels;
   ALLOW_CEILING_LEVEL = octtreeTocopy.ALLOW_CEILING_LEVEL;
+  COARSE_ALPHA_TRANSLATIONS = octtreeTocopy.COARSE_ALPHA_TRANSLATIONS;
   VERBOSE = octtreeTocopy.VERBOSE;
   cout << "end of copying octtree... " << endl;
 }
@@ -403,12 +433,12 @@ Octtree::~Octtree()
 
 std::vector<int> Octtree::getNeighborsSonsIndexes(const int index, const int l) const
 {
-  std::vector<int> sonsOfNeighbors, sonsOfNeighborsTmp;
-  const std::vector<int> neighborsIndexes(getCubeLevel(index, l).neighborsIndexes);
-  for (unsigned int m=0 ; m<neighborsIndexes.size() ; ++m)
+  std::vector<int> sonsOfNeighbors;
+  const int * neighborsIndexes = levels[l].getNeighborsIndexes(index);
+  for (int m=0 ; m<levels[l].getNumberOfNeighbors(index) ; ++m)
   {
-    sonsOfNeighborsTmp = getCubeLevel(neighborsIndexes[m], l).sonsIndexes;
-    for (unsigned int n=0 ; n<sonsOfNeighborsTmp.size() ; ++n) sonsOfNeighbors.push_back(sonsOfNeighborsTmp[n]);
+    const int * sonsIndexes = levels[l].getSonsIndexes(neighborsIndexes[m]);
+    sonsOfNeighbors.insert(sonsOfNeighbors.end(), sonsIndexes, sonsIndexes + levels[l].getNumberOfSons(neighborsIndexes[m]));
   }
   return sonsOfNeighbors;
 }
@@ -430,6 +460,7 @@ void Octtree::findAlphaTransParticipantsIndexes(const int l)
   
   std::vector<int> localCubesIndexes(levels[l].getLocalCubesIndexes());
   const int N_local_cubes = localCubesIndexes.size();
+  levels[l].alphaTransParticipantsIndexes.clear();
   const int N_cubes = levels[l].getLevelSize();
   int N_to_send(0), N_to_receive(0);
   // we treat the ceiling level differently than the regular levels
@@ -459,11 +490,13 @@ void Octtree::findAlphaTransParticipantsIndexes(const int l)
           }
         }
       } // end for
-      // we now trim the excess capacity of alphaTransParticipantsIndexes
-      levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes.resize(localAlphaTransParticipantsIndexes.size());
-      for (unsigned int j=0 ; j<localAlphaTransParticipantsIndexes.size() ; ++j) levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes[j] = localAlphaTransParticipantsIndexes[j];
-      levels[l].cubes[indexLocalCube].nonLocalAlphaTransParticipantsIndexes.resize(nonLocalAlphaTransParticipantsIndexes.size());
-      for (unsigned int j=0 ; j<nonLocalAlphaTransParticipantsIndexes.size() ; ++j) levels[l].cubes[indexLocalCube].nonLocalAlphaTransParticipantsIndexes[j] = nonLocalAlphaTransParticipantsIndexes[j];
+      // we now append the participants to those of the level, the local ones first
+      Cube & cube = levels[l].cubes[indexLocalCube];
+      cube.alphaTransParticipantsStartIndex = levels[l].alphaTransParticipantsIndexes.size();
+      cube.N_localAlphaTransParticipants = localAlphaTransParticipantsIndexes.size();
+      cube.N_nonLocalAlphaTransParticipants = nonLocalAlphaTransParticipantsIndexes.size();
+      levels[l].alphaTransParticipantsIndexes.insert(levels[l].alphaTransParticipantsIndexes.end(), localAlphaTransParticipantsIndexes.begin(), localAlphaTransParticipantsIndexes.end());
+      levels[l].alphaTransParticipantsIndexes.insert(levels[l].alphaTransParticipantsIndexes.end(), nonLocalAlphaTransParticipantsIndexes.begin(), nonLocalAlphaTransParticipantsIndexes.end());
     }
   }
   else { // for the NON-CEILING level
@@ -493,11 +526,13 @@ void Octtree::findAlphaTransParticipantsIndexes(const int l)
           }
         }
       }
-      // we now trim the excess capacity of alphaTransParticipantsIndexes
-      levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes.resize(localAlphaTransParticipantsIndexes.size());
-      for (unsigned int j=0 ; j<localAlphaTransParticipantsIndexes.size() ; ++j) levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes[j] = localAlphaTransParticipantsIndexes[j];
-      levels[l].cubes[indexLocalCube].nonLocalAlphaTransParticipantsIndexes.resize(nonLocalAlphaTransParticipantsIndexes.size());
-      for (unsigned int j=0 ; j<nonLocalAlphaTransParticipantsIndexes.size() ; ++j) levels[l].cubes[indexLocalCube].nonLocalAlphaTransParticipantsIndexes[j] = nonLocalAlphaTransParticipantsIndexes[j];
+      // we now append the participants to those of the level, the local ones first
+      Cube & cube = levels[l].cubes[indexLocalCube];
+      cube.alphaTransParticipantsStartIndex = levels[l].alphaTransParticipantsIndexes.size();
+      cube.N_localAlphaTransParticipants = localAlphaTransParticipantsIndexes.size();
+      cube.N_nonLocalAlphaTransParticipants = nonLocalAlphaTransParticipantsIndexes.size();
+      levels[l].alphaTransParticipantsIndexes.insert(levels[l].alphaTransParticipantsIndexes.end(), localAlphaTransParticipantsIndexes.begin(), localAlphaTransParticipantsIndexes.end());
+      levels[l].alphaTransParticipantsIndexes.insert(levels[l].alphaTransParticipantsIndexes.end(), nonLocalAlphaTransParticipantsIndexes.begin(), nonLocalAlphaTransParticipantsIndexes.end());
     }
   }
   // we now eliminate the redundant radiations functions numbers in listOfFcToBeReceived
@@ -519,6 +554,7 @@ void Octtree::findAlphaTransParticipantsIndexes(const int l)
       }
     }
   }
+  std::vector<int>(levels[l].alphaTransParticipantsIndexes).swap(levels[l].alphaTransParticipantsIndexes);
   levels[l].listOfFcToBeReceived = listOfFcToBeReceivedTmp;
   // we now eliminate the redundant radiations functions numbers in listOfFcToBeSent
   for (unsigned int i=0 ; i<listOfFcToBeSentTmp.size() ; ++i) {
@@ -592,9 +628,10 @@ void Octtree::updateSup(const blitz::Array<std::complex<float>, 1>& I_PQ) /// co
         int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
         if (levels[l].Sdown(indexLocalCube).size()==0) levels[l].Sdown(indexLocalCube).resize(2, N_theta*N_phi);
         levels[l].Sdown(indexLocalCube) = 0.0;
-        const int NSons = levels[l].cubes[indexLocalCube].sonsIndexes.size();
+        const int NSons = levels[l].getNumberOfSons(indexLocalCube);
+        const int * sonsIndexes = levels[l].getSonsIndexes(indexLocalCube);
         for (int j=0 ; j<NSons ; ++j) {
-          const int sonIndex = levels[l-1].cubesIndexesAfterReduction[levels[l].cubes[indexLocalCube].sonsIndexes[j]];
+          const int sonIndex = levels[l-1].cubesIndexesAfterReduction[sonsIndexes[j]];
           // interpolation
           interpolate2Dlfi(S_tmp(0, all), levels[l-1].Sdown(sonIndex)(0, all), levels[l-1].lfi2D);
           interpolate2Dlfi(S_tmp(1, all), levels[l-1].Sdown(sonIndex)(1, all), levels[l-1].lfi2D);
@@ -691,6 +728,93 @@ void Octtree::SupAlphaMultiplication(blitz::Array<std::complex<float>, 2>& SupAl
   }
 }
 
+void Octtree::SupAlphaMultiplicationSwapXY(blitz::Array<std::complex<float>, 2>& SupAlpha,
+                                           const blitz::Array<std::complex<float>, 2>& Sup,
+                                           const blitz::Array<std::complex<float>, 1>& alphaTranslation,
+                                           const blitz::Array<int, 1>& alphaTranslationIndexesNonZeros,
+                                           const blitz::Array<int, 1>& alphaTranslationIndexes,
+                                           const blitz::Array<int, 1>& alphaTranslationIndexesSwapXY,
+                                           const int alphaCartesianCoord[3])
+/**
+ * Same as SupAlphaMultiplication, but alphaTranslation is the stored translation for the
+ * (|y|, |x|, |z|) offset. The directions are therefore first reflected by alphaTranslationIndexes, then
+ * permuted by alphaTranslationIndexesSwapXY (and the other way around for the non-zeros, since
+ * both permutations are involutions).
+ */
+{
+  if ((abs(alphaCartesianCoord[0]) > 1) || (abs(alphaCartesianCoord[1]) > 1) || (abs(alphaCartesianCoord[2]) > 1)) {
+    if (alphaTranslationIndexesNonZeros.size()==0) {
+      const int N_alpha( alphaTranslationIndexes.size() );
+      for (int i=0 ; i<N_alpha ; ++i) {
+        const int newIndex(alphaTranslationIndexesSwapXY(alphaTranslationIndexes(i)));
+        SupAlpha(0, i) += Sup(0, i) * alphaTranslation(newIndex);
+        SupAlpha(1, i) += Sup(1, i) * alphaTranslation(newIndex);
+      }
+    }
+    else {
+      const int N_alpha(alphaTranslationIndexesNonZeros.size());
+      for (int i=0 ; i<N_alpha ; ++i) {
+        const int oldIndex = alphaTranslationIndexesNonZeros(i);
+        const int newIndex = alphaTranslationIndexes(alphaTranslationIndexesSwapXY(oldIndex));
+        SupAlpha(0, newIndex) += Sup(0, newIndex) * alphaTranslation(i);
+        SupAlpha(1, newIndex) += Sup(1, newIndex) * alphaTranslation(i);
+      }
+    }
+  }
+}
+
+void Octtree::SupAlphaMultiplicationInterpolated(blitz::Array<std::complex<float>, 2>& SupAlpha,
+                                                 const blitz::Array<std::complex<float>, 2>& Sup,
+                                                 const blitz::Array<std::complex<float>, 1>& alphaTranslationSamples,
+                                                 const blitz::Array<float, 2>& kHats,
+                                                 const blitz::Array<float, 1>& weights,
+                                                 const float deltaGamma,
+                                                 const int NOrder,
+                                                 const int alphaCartesianCoord[3])
+/**
+ * The alpha translation is interpolated for each direction from its samples in
+ * \f$ \gamma = \arccos ( \mathbf{\hat{k}} \cdot \mathbf{\hat{r}}_{mn} ) \f$, see
+ * Level::alphaTranslationsInterpolatedComputation. We use the barycentric form of the
+ * Lagrange interpolation on NOrder equispaced samples surrounding \f$ \gamma \f$.
+ */
+{
+  if ((abs(alphaCartesianCoord[0]) > 1) || (abs(alphaCartesianCoord[1]) > 1) || (abs(alphaCartesianCoord[2]) > 1)) {
+    const double norm_r = sqrt(static_cast<double>(alphaCartesianCoord[0]*alphaCartesianCoord[0] + alphaCartesianCoord[1]*alphaCartesianCoord[1] + alphaCartesianCoord[2]*alphaCartesianCoord[2]));
+    const double rHat[3] = {alphaCartesianCoord[0]/norm_r, alphaCartesianCoord[1]/norm_r, alphaCartesianCoord[2]/norm_r};
+    const int NPadding = NOrder/2, jMax = alphaTranslationSamples.size() - NOrder;
+    // barycentric weights for equispaced nodes: (-1)^k * binomial(NOrder-1, k)
+    float baryWeights[16];
+    baryWeights[0] = 1.0;
+    for (int kk=1 ; kk<NOrder ; ++kk) baryWeights[kk] = -baryWeights[kk-1] * (NOrder-kk)/static_cast<float>(kk);
+    const int N_alpha = weights.size();
+    for (int i=0 ; i<N_alpha ; ++i) {
+      // gamma = atan2(|kHat x rHat|, kHat . rHat) in double: acos of a float dot product
+      // loses ~sqrt(eps) near gamma = 0 and pi, where the nodes matter most.
+      const double kHat[3] = {kHats(i, 0), kHats(i, 1), kHats(i, 2)};
+      const double cross[3] = {kHat[1]*rHat[2] - kHat[2]*rHat[1], kHat[2]*rHat[0] - kHat[0]*rHat[2], kHat[0]*rHat[1] - kHat[1]*rHat[0]};
+      const double sinGamma = sqrt(cross[0]*cross[0] + cross[1]*cross[1] + cross[2]*cross[2]);
+      const double cosGamma = kHat[0]*rHat[0] + kHat[1]*rHat[1] + kHat[2]*rHat[2];
+      const float t = static_cast<float>(atan2(sinGamma, cosGamma)/deltaGamma) + NPadding;
+      const int j0 = min(max(static_cast<int>(floor(t)) - NPadding + 1, 0), jMax);
+      const float u = t - j0;
+      std::complex<float> alpha(0.0, 0.0);
+      float den = 0.0;
+      int kk = 0;
+      for ( ; kk<NOrder ; ++kk) {
+        const float d = u - kk;
+        if (d==0.0) break;
+        const float w = baryWeights[kk]/d;
+        alpha += w * alphaTranslationSamples(j0 + kk);
+        den += w;
+      }
+      alpha = (kk<NOrder) ? alphaTranslationSamples(j0 + kk) : alpha/den;
+      alpha *= weights(i);
+      SupAlpha(0, i) += Sup(0, i) * alpha;
+      SupAlpha(1, i) += Sup(1, i) * alpha;
+    }
+  }
+}
+
 void Octtree::SupAlphaMultiplicationDirections(blitz::Array<std::complex<float>, 2>& SupAlpha,
                                                const blitz::Array<std::complex<float>, 2>& Sup,
                                                const blitz::Array<std::complex<float>, 1>& alphaTranslation,
@@ -716,32 +840,59 @@ void Octtree::SupAlphaMultiplicationDirections(blitz::Array<std::complex<float>,
   }
 }
 
+void Octtree::alphaTranslationMultiplication(blitz::Array<std::complex<float>, 2>& SupAlpha,
+                                             const blitz::Array<std::complex<float>, 2>& Sup,
+                                             const int l,
+                                             const int alphaCartesianCoord[3],
+                                             const bool COARSE)
+/// SupAlpha += alpha * Sup, with alpha the stored translation of level l for alphaCartesianCoord (not parallelized by directions)
+{
+  blitz::Range all = blitz::Range::all();
+  blitz::Array<std::complex<float>, 1> alpha;
+  blitz::Array<int, 1> alphaIndexesNonZeros;
+  const int X = 1 * (alphaCartesianCoord[0]>=0), Y = 1 * (alphaCartesianCoord[1]>=0), Z = 1 * (alphaCartesianCoord[2]>=0);
+  const int m = abs(alphaCartesianCoord[0]), n = abs(alphaCartesianCoord[1]), p = abs(alphaCartesianCoord[2]);
+  if (levels[l].alphaTranslationsInterpolation==1) {
+    // the samples are stored for the sorted offsets only
+    int mnp[3] = {m, n, p};
+    sort(mnp, mnp+3);
+    SupAlphaMultiplicationInterpolated(SupAlpha, Sup, levels[l].alphaTranslations(mnp[2], mnp[1], mnp[0]), levels[l].alphaTranslationsKHats, levels[l].alphaTranslationsWeights, levels[l].alphaTranslationsDeltaGamma, levels[l].alphaTranslationsInterpolationOrder, alphaCartesianCoord);
+  }
+  else if ( (m<n) && levels[l].getAlphaTranslationsSwapXY() ) {
+    levels[l].getAlphaTranslation(alpha, alphaIndexesNonZeros, n, m, p, COARSE);
+    SupAlphaMultiplicationSwapXY(SupAlpha, Sup, alpha, alphaIndexesNonZeros, levels[l].alphaTranslationsIndexes(X, Y, Z, all), levels[l].alphaTranslationsIndexesSwapXY, alphaCartesianCoord);
+  }
+  else {
+    levels[l].getAlphaTranslation(alpha, alphaIndexesNonZeros, m, n, p, COARSE);
+    SupAlphaMultiplication(SupAlpha, Sup, alpha, alphaIndexesNonZeros, levels[l].alphaTranslationsIndexes(X, Y, Z, all), alphaCartesianCoord);
+  }
+}
+
 void Octtree::alphaTranslationsToCube(blitz::Array<std::complex<float>, 2>& S_tmp,
                                       const blitz::Array< blitz::Array<std::complex<float>, 2>, 1>& LevelSup,
                                       const int l,
                                       const int cubeIndex,
-                                      const std::vector<int>& indexesAlphaParticipants,
+                                      const int * indexesAlphaParticipants,
+                                      const int N_part,
                                       const int DIRECTIONS_PARALLELIZATION)
 {
-  blitz::Range all = blitz::Range::all();
   const float * cartCoord_1(levels[l].cubes[cubeIndex].absoluteCartesianCoord);
+  const bool COARSE = (COARSE_ALPHA_TRANSLATIONS==1) && levels[l].getAlphaTranslationsCoarse();
+  blitz::Array<std::complex<float>, 1> alpha;
+  blitz::Array<int, 1> alphaIndexesNonZeros;
   S_tmp = 0.0;
-  const int N_part = indexesAlphaParticipants.size();
   for (int j=0; j<N_part ; ++j) {
     const int indexParticipant = levels[l].cubesIndexesAfterReduction[indexesAlphaParticipants[j]];
     const float * cartCoord_2(levels[l].cubes[indexParticipant].absoluteCartesianCoord);
     const float DRcenters[3] = {cartCoord_1[0]-cartCoord_2[0], cartCoord_1[1]-cartCoord_2[1], cartCoord_1[2]-cartCoord_2[2]};
     const int alphaCartesianCoord[3] = { static_cast<int>( round(DRcenters[0]) ), static_cast<int>(  round(DRcenters[1]) ), static_cast<int>( round(DRcenters[2]) ) };
-    if (DIRECTIONS_PARALLELIZATION!=1) {
-      const int X = 1 * (alphaCartesianCoord[0]>=0), Y = 1 * (alphaCartesianCoord[1]>=0), Z = 1 * (alphaCartesianCoord[2]>=0);
-      const int m = abs(alphaCartesianCoord[0]), n = abs(alphaCartesianCoord[1]), p = abs(alphaCartesianCoord[2]);
-      SupAlphaMultiplication(S_tmp, LevelSup(indexParticipant), levels[l].alphaTranslations(m,n,p), levels[l].alphaTranslationsIndexesNonZeros(m, n, p), levels[l].alphaTranslationsIndexes(X, Y, Z, all), alphaCartesianCoord);
-    }
+    if (DIRECTIONS_PARALLELIZATION!=1) alphaTranslationMultiplication(S_tmp, LevelSup(indexParticipant), l, alphaCartesianCoord, COARSE);
     else {
       const int m = alphaCartesianCoord[0] + levels[l].getOffsetAlphaIndexX();
       const int n = alphaCartesianCoord[1] + levels[l].getOffsetAlphaIndexY();
       const int p = alphaCartesianCoord[2] + levels[l].getOffsetAlphaIndexZ();
-      SupAlphaMultiplicationDirections(S_tmp, LevelSup(indexParticipant), levels[l].alphaTranslations(m,n,p), levels[l].alphaTranslationsIndexesNonZeros(m, n, p), alphaCartesianCoord);
+      levels[l].getAlphaTranslation(alpha, alphaIndexesNonZeros, m, n, p, COARSE);
+      SupAlphaMultiplicationDirections(S_tmp, LevelSup(indexParticipant), alpha, alphaIndexesNonZeros, alphaCartesianCoord);
     }
   }
 }
@@ -773,7 +924,7 @@ void Octtree::alphaTranslations(void)
       blitz::Array<std::complex<float>, 2> S_tmp(2, N_theta*N_phi);
       for (int i=0 ; i<N_local_cubes ; ++i) {
         int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
-        alphaTranslationsToCube(S_tmp, SupThisLevel, l, indexLocalCube, levels[l].cubes[indexLocalCube].nonLocalAlphaTransParticipantsIndexes, levels[l].DIRECTIONS_PARALLELIZATION);
+        alphaTranslationsToCube(S_tmp, SupThisLevel, l, indexLocalCube, levels[l].getNonLocalAlphaTransParticipants(levels[l].cubes[indexLocalCube]), levels[l].cubes[indexLocalCube].N_nonLocalAlphaTransParticipants, levels[l].DIRECTIONS_PARALLELIZATION);
         levels[l].Sdown(indexLocalCube) += S_tmp;
       }
     }
@@ -781,7 +932,7 @@ void Octtree::alphaTranslations(void)
     else {
       for (int i=0 ; i<N_local_cubes ; ++i) {
         int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
-        alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes, levels[l].DIRECTIONS_PARALLELIZATION);
+        alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].getLocalAlphaTransParticipants(levels[l].cubes[indexLocalCube]), levels[l].cubes[indexLocalCube].N_localAlphaTransParticipants, levels[l].DIRECTIONS_PARALLELIZATION);
       }
     }
     MPI_Barrier(MPI::COMM_WORLD);
@@ -808,14 +959,15 @@ void Octtree::exchangeSupsIndividually(blitz::Array< blitz::Array<std::complex<f
       isend_request[i].resize(NToSend);
       irecv_status[i].resize(NToReceive);
       isend_status[i].resize(NToSend);
+      // the tag is the position in the lists, which are sorted in the same order on both processes
       for (int j=0 ; j<NToReceive ; ++j) {
         const int indexRecv = levels[l].cubesIndexesAfterReduction[listOfFcToBeReceived[j]];
         SupThisLevel(indexRecv).resize(N_coord, N_theta*N_phi);
-        MPI_Irecv(SupThisLevel(indexRecv).data(), BUF_SIZE, MPI::COMPLEX, i, listOfFcToBeReceived[j], MPI::COMM_WORLD, &irecv_request[i][j]);
+        MPI_Irecv(SupThisLevel(indexRecv).data(), BUF_SIZE, MPI::COMPLEX, i, j, MPI::COMM_WORLD, &irecv_request[i][j]);
       }
       for (int j=0 ; j<NToSend ; ++j) {
         const int indexSend = levels[l].cubesIndexesAfterReduction[listOfFcToBeSent[j]];
-        MPI_Isend(SupThisLevel(indexSend).data(), BUF_SIZE, MPI::COMPLEX, i, listOfFcToBeSent[j], MPI::COMM_WORLD, &isend_request[i][j]);
+        MPI_Isend(SupThisLevel(indexSend).data(), BUF_SIZE, MPI::COMPLEX, i, j, MPI::COMM_WORLD, &isend_request[i][j]);
       }
     }
   }
@@ -823,7 +975,7 @@ void Octtree::exchangeSupsIndividually(blitz::Array< blitz::Array<std::complex<f
   const int N_local_cubes = localCubesIndexes.size();
   for (int i=0 ; i<N_local_cubes ; ++i) {
     int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
-    alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes, levels[l].DIRECTIONS_PARALLELIZATION);
+    alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].getLocalAlphaTransParticipants(levels[l].cubes[indexLocalCube]), levels[l].cubes[indexLocalCube].N_localAlphaTransParticipants, levels[l].DIRECTIONS_PARALLELIZATION);
   }
   // wait operation
   for (int i=0 ; i<getTotalNumProcs() ; ++i) {
@@ -879,7 +1031,7 @@ void Octtree::exchangeSupsInBlocks(blitz::Array< blitz::Array<std::complex<float
   const int N_local_cubes = localCubesIndexes.size();
   for (int i=0 ; i<N_local_cubes ; ++i) {
     int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
-    alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].cubes[indexLocalCube].localAlphaTransParticipantsIndexes, levels[l].DIRECTIONS_PARALLELIZATION);
+    alphaTranslationsToCube(levels[l].Sdown(indexLocalCube), SupThisLevel, l, indexLocalCube, levels[l].getLocalAlphaTransParticipants(levels[l].cubes[indexLocalCube]), levels[l].cubes[indexLocalCube].N_localAlphaTransParticipants, levels[l].DIRECTIONS_PARALLELIZATION);
   }
   // wait operation
   for (int i=0 ; i<getTotalNumProcs() ; ++i) {
@@ -905,6 +1057,47 @@ void Octtree::exchangeSupsInBlocks(blitz::Array< blitz::Array<std::complex<float
   }
 }
 
+void Octtree::SdownToSon(blitz::Array<std::complex<float>, 2>& SdownSon,
+                         const blitz::Array<std::complex<float>, 2>& Sdown,
+                         const int l,
+                         const float D[3],
+                         blitz::Array<std::complex<float>, 2>& Stmp2,
+                         blitz::Array<std::complex<float>, 2>& Stmp3)
+/// disaggregation of the incoming radiation function Sdown of level l to the son of center offset D: SdownSon += anterpolation(shift(Sdown))
+{
+  blitz::Range all = blitz::Range::all();
+  // shifting
+  Stmp2 = Sdown;
+  shiftExp( Stmp2, levels[l].shiftingArrays[(D[0]>0.0) * 4 + (D[1]>0.0) * 2 + (D[2]>0.0) * 1] );
+  // anterpolate
+  for (int m=0 ; m<2 ; m++) anterpolate2Dlfi(Stmp3(m, all), Stmp2(m, all), levels[l-1].lfi2D);
+  SdownSon += Stmp3;
+}
+
+void Octtree::descentToLeafLevel(const int topLevel)
+/// the Sdown of the local cubes are disaggregated from topLevel (not parallelized by directions) down to the leaf level
+{
+  int thisLevel = topLevel;
+  while (thisLevel>0) {
+    const int sonLevel = thisLevel-1;
+    std::vector<int> localCubesIndexes = levels[thisLevel].getLocalCubesIndexes();
+    const int N_local_Cubes = localCubesIndexes.size();
+    blitz::Array<std::complex<float>, 2> Stmp2(2, levels[thisLevel].thetas.size() * levels[thisLevel].phis.size()), Stmp3(2, levels[sonLevel].thetas.size() * levels[sonLevel].phis.size());
+    for (int i=0 ; i<N_local_Cubes ; ++i) {
+      int indexLocalCube = levels[thisLevel].cubesIndexesAfterReduction[localCubesIndexes[i]];
+      const int * sonsIndexes = levels[thisLevel].getSonsIndexes(indexLocalCube);
+      for (int j=0 ; j<levels[thisLevel].getNumberOfSons(indexLocalCube) ; ++j) {
+        const int sonIndex = levels[sonLevel].cubesIndexesAfterReduction[sonsIndexes[j]];
+        const float * rc_1(levels[sonLevel].cubes[sonIndex].rCenter);
+        const float * rc_2(levels[thisLevel].cubes[indexLocalCube].rCenter);
+        const float D[3] = {rc_1[0]-rc_2[0], rc_1[1]-rc_2[1], rc_1[2]-rc_2[2]};
+        SdownToSon(levels[sonLevel].Sdown(sonIndex), levels[thisLevel].Sdown(indexLocalCube), thisLevel, D, Stmp2, Stmp3);
+      }
+    }
+    thisLevel--;
+  }
+}
+
 void Octtree::ZIFarComputation(blitz::Array<std::complex<float>, 1>& ZI, /// result of matrix-vector multiplication
                                const blitz::Array<std::complex<float>, 1>& I_PQ) /// coefficients of RWG functions
 {
@@ -926,54 +1119,23 @@ void Octtree::ZIFarComputation(blitz::Array<std::complex<float>, 1>& ZI, /// res
       MPI_Allgatherv ( levels[thisLevel].Sdown(indexLocalCube)(0, all).data(), levels[thisLevel].Sdown(indexLocalCube)(0, all).size(), MPI::COMPLEX, Stmp(0, all).data(), levels[thisLevel].MPI_Scatterv_scounts.data(), levels[thisLevel].MPI_Scatterv_displs.data(), MPI::COMPLEX, MPI::COMM_WORLD );
       MPI_Allgatherv ( levels[thisLevel].Sdown(indexLocalCube)(1, all).data(), levels[thisLevel].Sdown(indexLocalCube)(1, all).size(), MPI::COMPLEX, Stmp(1, all).data(), levels[thisLevel].MPI_Scatterv_scounts.data(), levels[thisLevel].MPI_Scatterv_displs.data(), MPI::COMPLEX, MPI::COMM_WORLD );
 
-      std::vector<int> sonsIndexes = levels[thisLevel].cubes[indexLocalCube].sonsIndexes;
-      std::vector<int> sonsProcNumbers = levels[thisLevel].cubes[indexLocalCube].sonsProcNumbers;
-      for (unsigned int j=0 ; j<sonsIndexes.size() ; ++j) {
+      const int * sonsIndexes = levels[thisLevel].getSonsIndexes(indexLocalCube);
+      const int * sonsProcNumbers = levels[thisLevel].getSonsProcNumbers(indexLocalCube);
+      for (int j=0 ; j<levels[thisLevel].getNumberOfSons(indexLocalCube) ; ++j) {
         // we need to do the following only if the sons are local
         if (my_id==sonsProcNumbers[j]) {
           const int sonIndex = levels[sonLevel].cubesIndexesAfterReduction[sonsIndexes[j]];
-          // shifting
           const float * rc_1(levels[sonLevel].cubes[sonIndex].rCenter);
           const float * rc_2(levels[thisLevel].cubes[indexLocalCube].rCenter);
-          const float Dx = rc_1[0]-rc_2[0];
-          const float Dy = rc_1[1]-rc_2[1];
-          const float Dz = rc_1[2]-rc_2[2];
-          Stmp2 = Stmp;
-          shiftExp( Stmp2, levels[thisLevel].shiftingArrays[(Dx>0.0) * 4 + (Dy>0.0) * 2 + (Dz>0.0) * 1] );
-          // anterpolate
-          for (int m=0 ; m<2 ; m++) anterpolate2Dlfi(Stmp3(m, all), Stmp2(m, all), levels[sonLevel].lfi2D);
-          levels[sonLevel].Sdown(sonIndex) += Stmp3;
+          const float D[3] = {rc_1[0]-rc_2[0], rc_1[1]-rc_2[1], rc_1[2]-rc_2[2]};
+          SdownToSon(levels[sonLevel].Sdown(sonIndex), Stmp, thisLevel, D, Stmp2, Stmp3);
         }
       }
     }
     thisLevel--;
   }
   // now the descent towards the bottom
-  while (thisLevel>0) {
-    const int sonLevel = thisLevel-1;
-    std::vector<int> localCubesIndexes = levels[thisLevel].getLocalCubesIndexes();
-    const int N_local_Cubes = localCubesIndexes.size();
-    blitz::Array<std::complex<float>, 2> Stmp2(2, levels[thisLevel].thetas.size() * levels[thisLevel].phis.size()), Stmp3(2, levels[sonLevel].thetas.size() * levels[sonLevel].phis.size());
-    for (int i=0 ; i<N_local_Cubes ; ++i) {
-      int indexLocalCube = levels[thisLevel].cubesIndexesAfterReduction[localCubesIndexes[i]];
-      std::vector<int> sonsIndexes = levels[thisLevel].cubes[indexLocalCube].sonsIndexes;
-      for (unsigned int j=0 ; j<sonsIndexes.size() ; ++j) {
-        const int sonIndex = levels[sonLevel].cubesIndexesAfterReduction[sonsIndexes[j]];
-        // shifting
-        const float * rc_1(levels[sonLevel].cubes[sonIndex].rCenter);
-        const float * rc_2(levels[thisLevel].cubes[indexLocalCube].rCenter);
-        const float Dx = rc_1[0]-rc_2[0];
-        const float Dy = rc_1[1]-rc_2[1];
-        const float Dz = rc_1[2]-rc_2[2];
-        Stmp2 = levels[thisLevel].Sdown(indexLocalCube);
-        shiftExp( Stmp2, levels[thisLevel].shiftingArrays[(Dx>0.0) * 4 + (Dy>0.0) * 2 + (Dz>0.0) * 1] );
-        // anterpolate
-        for (int m=0 ; m<2 ; m++) anterpolate2Dlfi(Stmp3(m, all), Stmp2(m, all), levels[sonLevel].lfi2D);
-        levels[sonLevel].Sdown(sonIndex) += Stmp3;
-      }
-    }
-    thisLevel--;
-  }
+  descentToLeafLevel(thisLevel);
   // and finally the integration
   std::vector<int> localCubesIndexes = levels[thisLevel].getLocalCubesIndexes();
   const int N_local_cubes = localCubesIndexes.size();
@@ -1020,9 +1182,10 @@ void Octtree::computeFarField(blitz::Array<std::complex<float>, 2>& e_theta_far,
         int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
         if (levels[l].Sdown(indexLocalCube).size()==0) levels[l].Sdown(indexLocalCube).resize(2, N_directions);
         S_tmp2 = 0.0;
-        const int NSons = levels[l].cubes[indexLocalCube].sonsIndexes.size();
+        const int NSons = levels[l].getNumberOfSons(indexLocalCube);
+        const int * sonsIndexes = levels[l].getSonsIndexes(indexLocalCube);
         for (int j=0 ; j<NSons ; ++j) {
-          const int sonIndex = levels[l-1].cubesIndexesAfterReduction[levels[l].cubes[indexLocalCube].sonsIndexes[j]];
+          const int sonIndex = levels[l-1].cubesIndexesAfterReduction[sonsIndexes[j]];
           // interpolation
           interpolate2Dlfi(S_tmp(0, all), levels[l-1].Sdown(sonIndex)(0, all), levels[l-1].lfi2D);
           interpolate2Dlfi(S_tmp(1, all), levels[l-1].Sdown(sonIndex)(1, all), levels[l-1].lfi2D);
@@ -1230,3 +1393,441 @@ void Octtree::computeDipoleSup(blitz::Array<std::complex<float>, 2> & Sup,
   }
 }
 
+
+//! the alpha translation from a point to a cube center, multiplied by the directions integration weights
+/*!
+  Same result as IT_theta_IT_phi_alpha_C2 followed by the multiplication by the weights, but
+  the coefficients of the Legendre expansion are computed once for all the directions, and
+  the translation vector needs not be a multiple of the cubes side length.
+*/
+void pointAlphaTranslation(blitz::Array<std::complex<float>, 1>& alpha,
+                           const double r_mn[3],
+                           const std::complex<double>& k,
+                           const int L,
+                           const int L_prime,
+                           const blitz::Array<float, 2>& kHats,
+                           const blitz::Array<float, 1>& weights)
+{
+  int kode = 1, M = 2, N = 1, nz, ierr;
+  const double norm_r_mn = sqrt(r_mn[0]*r_mn[0] + r_mn[1]*r_mn[1] + r_mn[2]*r_mn[2]);
+  const double r_mn_hat[3] = {r_mn[0]/norm_r_mn, r_mn[1]/norm_r_mn, r_mn[2]/norm_r_mn};
+  std::vector< std::complex<double> > h2_sph(L+1), coeff(L_prime+1);
+  std::complex<double> z(k * norm_r_mn);
+  for (int i=0 ; i<L+1 ; i++) {
+    double fnu = i + 0.5;
+    zbesh(z, fnu, kode, M, N, h2_sph[i], nz, ierr);
+    h2_sph[i] *= sqrt(M_PI/(2.0 * z));
+  }
+  std::complex<double> minus_I_power(1.0, 0.0);
+  for (int j=0 ; j<L+1 ; ++j) {
+    coeff[j] = minus_I_power * (2*j + 1.0) * h2_sph[j];
+    minus_I_power *= -I;
+  }
+  for (int j=L+1 ; j<L_prime+1 ; ++j) {
+    const double c = cos((j-L) * M_PI/2.0 / (L_prime-L));
+    coeff[j] = coeff[L] * (c*c);
+  }
+  const std::complex<double> factor(-I * k / (16.0*M_PI*M_PI));
+  const int N_directions = alpha.size();
+  for (int i=0 ; i<N_directions ; ++i) {
+    const double x = kHats(i, 0)*r_mn_hat[0] + kHats(i, 1)*r_mn_hat[1] + kHats(i, 2)*r_mn_hat[2];
+    // Legendre polynomials recursion
+    double P_previous = 1.0, P = x;
+    std::complex<double> sum(coeff[0]);
+    if (L_prime>=1) sum += coeff[1] * x;
+    for (int j=1 ; j<L_prime ; ++j) {
+      const double P_next = ((2.0*j + 1.0) * x * P - j * P_previous)/(j + 1.0);
+      P_previous = P;
+      P = P_next;
+      sum += coeff[j+1] * P;
+    }
+    alpha(i) = static_cast< std::complex<float> > (factor * sum * static_cast<double>(weights(i)));
+  }
+}
+
+void Octtree::offsetAlphaTranslation(blitz::Array<std::complex<float>, 1>& alpha,
+                                     std::map< std::vector<int>, blitz::Array<std::complex<float>, 1> >& alphaCache,
+                                     const int l,
+                                     const int offset[3],
+                                     const int L_prime,
+                                     const blitz::Array<float, 2>& kHats,
+                                     const blitz::Array<float, 1>& weights)
+{
+  const std::vector<int> key(offset, offset+3);
+  std::map< std::vector<int>, blitz::Array<std::complex<float>, 1> >::iterator it = alphaCache.find(key);
+  if (it==alphaCache.end()) {
+    const int N_directions = weights.size();
+    blitz::Array<std::complex<float>, 1>& newAlpha = alphaCache[key];
+    newAlpha.resize(N_directions);
+    if (levels[l].isAlphaTranslationStored(abs(offset[0]), abs(offset[1]), abs(offset[2]))) {
+      // the translation of the matvec, applied to unit radiation functions
+      blitz::Array<std::complex<float>, 2> unitSup(2, N_directions), SupAlpha(2, N_directions);
+      unitSup = 1.0;
+      SupAlpha = 0.0;
+      alphaTranslationMultiplication(SupAlpha, unitSup, l, offset, false);
+      newAlpha = SupAlpha(0, blitz::Range::all());
+    }
+    else {
+      const double sideLength = levels[l].getCubeSideLength();
+      const double r_mn[3] = {offset[0] * sideLength, offset[1] * sideLength, offset[2] * sideLength};
+      pointAlphaTranslation(newAlpha, r_mn, k, levels[l].getN(), L_prime, kHats, weights);
+    }
+    alpha.reference(newAlpha);
+  }
+  else alpha.reference(it->second);
+}
+
+//! gathers points in clusters, the cells of side length sideLength of the grid of the octtree
+void pointsToClusters(std::vector< std::vector<int> >& clusterCoord,
+                      std::vector< std::vector<int> >& clusterPoints,
+                      const blitz::Array<double, 2>& r,
+                      const double big_cube_lower_coord[3],
+                      const double sideLength)
+{
+  std::map< std::vector<int>, int > coordToCluster;
+  clusterCoord.clear();
+  clusterPoints.clear();
+  for (int d=0 ; d<r.extent(0) ; ++d) {
+    std::vector<int> coord(3);
+    for (int i=0 ; i<3 ; ++i) coord[i] = static_cast<int>(floor((r(d, i) - big_cube_lower_coord[i])/sideLength));
+    std::map< std::vector<int>, int >::iterator it = coordToCluster.find(coord);
+    if (it==coordToCluster.end()) {
+      coordToCluster[coord] = clusterCoord.size();
+      clusterCoord.push_back(coord);
+      clusterPoints.push_back(std::vector<int>(1, d));
+    }
+    else clusterPoints[it->second].push_back(d);
+  }
+}
+
+//! are a cube and a cluster of the same level, and their fathers, separated by at least one cell?
+void clustersSeparation(bool & IS_FAR,
+                        bool & IS_FATHER_FAR,
+                        const int cubeCoord[3],
+                        const std::vector<int>& clusterCoord)
+{
+  IS_FAR = false;
+  IS_FATHER_FAR = false;
+  for (int m=0 ; m<3 ; ++m) {
+    IS_FAR = IS_FAR || (abs(cubeCoord[m] - clusterCoord[m]) > 1);
+    IS_FATHER_FAR = IS_FATHER_FAR || (abs(static_cast<int>(floor(cubeCoord[m]/2.0)) - static_cast<int>(floor(clusterCoord[m]/2.0))) > 1);
+  }
+}
+
+void Octtree::computeDipolesExcitation(blitz::Array<std::complex<float>, 1>& V_CFIE,
+                                       const blitz::Array<std::complex<double>, 2>& J_dip,
+                                       const blitz::Array<double, 2>& r_dip,
+                                       const char CURRENT_TYPE,
+                                       const LocalMesh & local_target_mesh,
+                                       const int FULL_PRECISION)
+{
+  blitz::Range all = blitz::Range::all();
+  const int my_id = this->getProcNumber();
+  const int N_levels = levels.size();
+  const int IS_J_CURRENT = (CURRENT_TYPE=='M') ? 0 : 1;
+  if (my_id==0) cout << "\nDipoles excitation through the octtree: level ";
+  // the radiation function of a magnetic dipole is turned into that of the electric
+  // dipole radiating the same far field: (-j*w*mu) * Sup_J = (j*k) * Sup_M
+  const std::complex<float> SupFactor = (IS_J_CURRENT==1) ? std::complex<float>(1.0, 0.0) : static_cast<std::complex<float> >(-k / (static_cast<double>(w) * mu_0 * static_cast<std::complex<double> >(mu_r)));
+  float alphaTranslation_smoothing_factor;
+  readFloatFromASCIIFile(this->octtreeDataPath + "alphaTranslation_smoothing_factor.txt", alphaTranslation_smoothing_factor);
+  if (alphaTranslation_smoothing_factor<1.0) alphaTranslation_smoothing_factor = 1.0;
+  if (alphaTranslation_smoothing_factor>2.0) alphaTranslation_smoothing_factor = 2.0;
+  // the translations are done down from the coarsest level not parallelized by directions
+  int topLevel = N_levels-1;
+  while ( (topLevel>0) && (levels[topLevel].DIRECTIONS_PARALLELIZATION==1) ) topLevel--;
+
+  std::vector<int> localLeafCubesIndexes(levels[0].getLocalCubesIndexes());
+  std::vector< std::vector<int> > nearDipoles(localLeafCubesIndexes.size());
+  for (int l=topLevel ; l>=0 ; --l) {
+    if (my_id==0) cout << levels[l].getLevel() << "..."; flush(cout);
+    std::vector<int> localCubesIndexes(levels[l].getLocalCubesIndexes());
+    const int N_local_cubes = localCubesIndexes.size();
+    const int N_theta = levels[l].thetas.size(), N_phi = levels[l].phis.size(), N_directions = N_theta*N_phi;
+    const double sideLength = levels[l].getCubeSideLength();
+    const int L = levels[l].getN(), L_prime = static_cast<int>(ceil(L * alphaTranslation_smoothing_factor));
+    blitz::Array<float, 2> kHats(N_directions, 3);
+    blitz::Array<float, 1> weights(N_directions);
+    for (int q=0 ; q<N_phi ; ++q) {
+      for (int p=0 ; p<N_theta ; ++p) {
+        const int index = p + q*N_theta;
+        kHats(index, 0) = sin(levels[l].thetas(p))*cos(levels[l].phis(q));
+        kHats(index, 1) = sin(levels[l].thetas(p))*sin(levels[l].phis(q));
+        kHats(index, 2) = cos(levels[l].thetas(p));
+        weights(index) = levels[l].weightsThetas(p) * levels[l].weightsPhis(q);
+      }
+    }
+    // the dipoles are gathered in clusters, the cells of the grid of the cubes of this level
+    std::vector< std::vector<int> > clusterCoord, clusterDipoles;
+    pointsToClusters(clusterCoord, clusterDipoles, r_dip, big_cube_lower_coord, sideLength);
+    const int N_clusters = clusterCoord.size();
+    // the radiation functions of the clusters, computed when first needed
+    std::vector< blitz::Array<std::complex<float>, 2> > SupClusters(N_clusters);
+    blitz::Array<std::complex<float>, 2> SupTmp(2, N_directions);
+    // the cube and the cluster centers are on the same grid: the translations only depend on their offset
+    std::map< std::vector<int>, blitz::Array<std::complex<float>, 1> > alphaCache;
+    blitz::Array<std::complex<float>, 1> alpha;
+
+    if (levels[l].Sdown.size()==0) levels[l].Sdown.resize(levels[l].getLevelSize());
+    for (int i=0 ; i<N_local_cubes ; ++i) {
+      const int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
+      levels[l].Sdown(indexLocalCube).resize(2, N_directions);
+      levels[l].Sdown(indexLocalCube) = 0.0;
+      const float * rCenter = levels[l].cubes[indexLocalCube].rCenter;
+      int cubeCoord[3];
+      for (int m=0 ; m<3 ; ++m) cubeCoord[m] = static_cast<int>(floor((rCenter[m] - big_cube_lower_coord[m])/sideLength));
+      for (int c=0 ; c<N_clusters ; ++c) {
+        // a cluster is translated to the cube if it is not a neighbor, and if it was a neighbor of its father
+        bool IS_FAR, IS_FATHER_FAR;
+        clustersSeparation(IS_FAR, IS_FATHER_FAR, cubeCoord, clusterCoord[c]);
+        if (IS_FAR && ((l==topLevel) || !IS_FATHER_FAR)) {
+          double rCluster[3];
+          for (int m=0 ; m<3 ; ++m) rCluster[m] = big_cube_lower_coord[m] + (clusterCoord[c][m] + 0.5) * sideLength;
+          if (SupClusters[c].size()==0) {
+            SupClusters[c].resize(2, N_directions);
+            SupClusters[c] = 0.0;
+            const float rClusterFloat[3] = {static_cast<float>(rCluster[0]), static_cast<float>(rCluster[1]), static_cast<float>(rCluster[2])};
+            for (unsigned int j=0 ; j<clusterDipoles[c].size() ; ++j) {
+              const int d = clusterDipoles[c][j];
+              const std::complex<float> J[3] = {static_cast< std::complex<float> >(J_dip(d, 0)), static_cast< std::complex<float> >(J_dip(d, 1)), static_cast< std::complex<float> >(J_dip(d, 2))};
+              const float r_d[3] = {static_cast<float>(r_dip(d, 0)), static_cast<float>(r_dip(d, 1)), static_cast<float>(r_dip(d, 2))};
+              computeDipoleSup(SupTmp, J, IS_J_CURRENT, r_d, rClusterFloat, levels[l].thetas, levels[l].phis);
+              SupClusters[c] += SupFactor * SupTmp;
+            }
+          }
+          const int offset[3] = {cubeCoord[0] - clusterCoord[c][0], cubeCoord[1] - clusterCoord[c][1], cubeCoord[2] - clusterCoord[c][2]};
+          offsetAlphaTranslation(alpha, alphaCache, l, offset, L_prime, kHats, weights);
+          for (int j=0 ; j<N_directions ; ++j) {
+            levels[l].Sdown(indexLocalCube)(0, j) += alpha(j) * SupClusters[c](0, j);
+            levels[l].Sdown(indexLocalCube)(1, j) += alpha(j) * SupClusters[c](1, j);
+          }
+        }
+        // the dipoles in the near zone of a leaf cube are computed directly
+        if ( (l==0) && !IS_FAR ) nearDipoles[i].insert(nearDipoles[i].end(), clusterDipoles[c].begin(), clusterDipoles[c].end());
+      }
+    }
+  }
+
+  descentToLeafLevel(topLevel);
+  // the integration gives the field of the far dipoles tested by the RWGs: V_CFIE = -ZI
+  const int N_local_RWG = local_target_mesh.N_local_RWG;
+  blitz::Array<std::complex<float>, 1> ZI(N_local_RWG);
+  ZI = 0.0;
+  for (unsigned int i=0 ; i<localLeafCubesIndexes.size() ; ++i) {
+    int indexLocalCube = levels[0].cubesIndexesAfterReduction[localLeafCubesIndexes[i]];
+    levels[0].sphericalIntegration(ZI, levels[0].Sdown(indexLocalCube), levels[0].cubes[indexLocalCube], levels[0].thetas, levels[0].phis, w, mu_r, k, CFIE);
+  }
+  this->resizeSdownLevelsToZero();
+  V_CFIE.resize(N_local_RWG);
+  V_CFIE = -ZI;
+
+  // the near dipoles, leaf cube by leaf cube
+  for (unsigned int i=0 ; i<localLeafCubesIndexes.size() ; ++i) {
+    const int N_near = nearDipoles[i].size();
+    if (N_near==0) continue;
+    const Cube & cube = levels[0].cubes[levels[0].cubesIndexesAfterReduction[localLeafCubesIndexes[i]]];
+    const int N_RWG_cube = cube.N_RWG;
+    const int * RWG_numbers = &levels[0].cubesRWG_numbers[cube.RWG_startIndex];
+    blitz::Array<std::complex<double>, 2> J_near(N_near, 3);
+    blitz::Array<double, 2> r_near(N_near, 3);
+    for (int j=0 ; j<N_near ; ++j) {
+      J_near(j, all) = J_dip(nearDipoles[i][j], all);
+      r_near(j, all) = r_dip(nearDipoles[i][j], all);
+    }
+    blitz::Array<int, 1> numbers_RWG_cube(N_RWG_cube), CFIE_OK_cube(N_RWG_cube);
+    blitz::Array<float, 2> trianglesCoord_cube(N_RWG_cube, 12);
+    for (int j=0 ; j<N_RWG_cube ; ++j) {
+      numbers_RWG_cube(j) = j;
+      CFIE_OK_cube(j) = local_target_mesh.localRWGNumber_CFIE_OK(RWG_numbers[j]);
+      trianglesCoord_cube(j, all) = local_target_mesh.localRWGNumber_trianglesCoord(RWG_numbers[j], all);
+    }
+    blitz::Array<std::complex<float>, 1> V_cube(N_RWG_cube);
+    V_CFIE_dipole_array (V_cube, CFIE, J_near, r_near, numbers_RWG_cube, CFIE_OK_cube, trianglesCoord_cube, w, eps_r, mu_r, CURRENT_TYPE, FULL_PRECISION);
+    for (int j=0 ; j<N_RWG_cube ; ++j) V_CFIE(RWG_numbers[j]) += V_cube(j);
+  }
+  if (my_id==0) cout << "finished!" << endl;
+}
+
+void Octtree::computeObservationFields(blitz::Array<std::complex<float>, 2>& E_obs,
+                                       blitz::Array<std::complex<float>, 2>& H_obs,
+                                       const blitz::Array<double, 2>& r_obs,
+                                       const blitz::Array<std::complex<float>, 1>& ZI,
+                                       const LocalMesh & local_target_mesh,
+                                       const int FULL_PRECISION)
+{
+  blitz::Range all = blitz::Range::all();
+  const int my_id = this->getProcNumber();
+  const int N_levels = levels.size(), N_obs = r_obs.extent(0);
+  E_obs.resize(N_obs, 3);
+  H_obs.resize(N_obs, 3);
+  E_obs = 0.0;
+  H_obs = 0.0;
+  // the radiation functions of the cubes, which are left in the Sdowns. This is not a matvec.
+  const int numberOfUpdatesSaved = this->getNumberOfUpdates();
+  this->updateSup(ZI);
+  this->setNumberOfUpdates(numberOfUpdatesSaved);
+  if (my_id==0) cout << "\nObservation fields through the octtree: level ";
+  const std::complex<float> E_factor(static_cast<std::complex<float> >(-I * static_cast<double>(w) * mu_0 * static_cast<std::complex<double> >(mu_r)));
+  // same sign convention as compute_E_obs for the magnetic field
+  const std::complex<float> H_factor(static_cast<std::complex<float> >(I * k));
+  float alphaTranslation_smoothing_factor;
+  readFloatFromASCIIFile(this->octtreeDataPath + "alphaTranslation_smoothing_factor.txt", alphaTranslation_smoothing_factor);
+  if (alphaTranslation_smoothing_factor<1.0) alphaTranslation_smoothing_factor = 1.0;
+  if (alphaTranslation_smoothing_factor>2.0) alphaTranslation_smoothing_factor = 2.0;
+  // the translations are done from the coarsest level not parallelized by directions
+  int topLevel = N_levels-1;
+  while ( (topLevel>0) && (levels[topLevel].DIRECTIONS_PARALLELIZATION==1) ) topLevel--;
+
+  std::vector<int> localLeafCubesIndexes(levels[0].getLocalCubesIndexes());
+  std::vector< std::vector<int> > nearPoints(localLeafCubesIndexes.size());
+  // the clusters of the father level, their incoming radiation functions and the cluster of each point.
+  // After the loop on the levels, those of the leaf level.
+  std::vector< std::vector<int> > fatherClusterCoord, fatherClusterPoints;
+  std::vector< blitz::Array<std::complex<float>, 2> > SdownFatherClusters;
+  std::vector<int> pointsCluster(N_obs, -1);
+  for (int l=topLevel ; l>=0 ; --l) {
+    if (my_id==0) cout << levels[l].getLevel() << "..."; flush(cout);
+    std::vector<int> localCubesIndexes(levels[l].getLocalCubesIndexes());
+    const int N_local_cubes = localCubesIndexes.size();
+    const int N_theta = levels[l].thetas.size(), N_phi = levels[l].phis.size(), N_directions = N_theta*N_phi;
+    const double sideLength = levels[l].getCubeSideLength();
+    const int L = levels[l].getN(), L_prime = static_cast<int>(ceil(L * alphaTranslation_smoothing_factor));
+    blitz::Array<float, 2> kHats(N_directions, 3);
+    blitz::Array<float, 1> weights(N_directions);
+    for (int q=0 ; q<N_phi ; ++q) {
+      for (int p=0 ; p<N_theta ; ++p) {
+        const int index = p + q*N_theta;
+        kHats(index, 0) = sin(levels[l].thetas(p))*cos(levels[l].phis(q));
+        kHats(index, 1) = sin(levels[l].thetas(p))*sin(levels[l].phis(q));
+        kHats(index, 2) = cos(levels[l].thetas(p));
+        weights(index) = levels[l].weightsThetas(p) * levels[l].weightsPhis(q);
+      }
+    }
+    // the observation points are gathered in clusters, the cells of the grid of the cubes of this level
+    std::vector< std::vector<int> > clusterCoord, clusterPoints;
+    pointsToClusters(clusterCoord, clusterPoints, r_obs, big_cube_lower_coord, sideLength);
+    const int N_clusters = clusterCoord.size();
+    // the incoming radiation functions of the clusters, allocated when first needed
+    std::vector< blitz::Array<std::complex<float>, 2> > SdownClusters(N_clusters);
+    // what the father clusters received is disaggregated to their sons, as in the descent of the matvec
+    if (l<topLevel) {
+      blitz::Array<std::complex<float>, 2> Stmp2(2, levels[l+1].thetas.size() * levels[l+1].phis.size()), Stmp3(2, N_directions);
+      for (int c=0 ; c<N_clusters ; ++c) {
+        const int father = pointsCluster[clusterPoints[c][0]];
+        if (SdownFatherClusters[father].size()==0) continue;
+        float D[3];
+        for (int m=0 ; m<3 ; ++m) D[m] = static_cast<float>(((clusterCoord[c][m] + 0.5) - 2.0 * (fatherClusterCoord[father][m] + 0.5)) * sideLength);
+        SdownClusters[c].resize(2, N_directions);
+        SdownClusters[c] = 0.0;
+        SdownToSon(SdownClusters[c], SdownFatherClusters[father], l+1, D, Stmp2, Stmp3);
+      }
+    }
+    // the cube and the cluster centers are on the same grid: the translations only depend on their offset
+    std::map< std::vector<int>, blitz::Array<std::complex<float>, 1> > alphaCache;
+    blitz::Array<std::complex<float>, 1> alpha;
+    for (int i=0 ; i<N_local_cubes ; ++i) {
+      const int indexLocalCube = levels[l].cubesIndexesAfterReduction[localCubesIndexes[i]];
+      const float * rCenter = levels[l].cubes[indexLocalCube].rCenter;
+      int cubeCoord[3];
+      for (int m=0 ; m<3 ; ++m) cubeCoord[m] = static_cast<int>(floor((rCenter[m] - big_cube_lower_coord[m])/sideLength));
+      for (int c=0 ; c<N_clusters ; ++c) {
+        bool IS_FAR, IS_FATHER_FAR;
+        clustersSeparation(IS_FAR, IS_FATHER_FAR, cubeCoord, clusterCoord[c]);
+        if (IS_FAR && ((l==topLevel) || !IS_FATHER_FAR)) {
+          const int offset[3] = {clusterCoord[c][0] - cubeCoord[0], clusterCoord[c][1] - cubeCoord[1], clusterCoord[c][2] - cubeCoord[2]};
+          if (SdownClusters[c].size()==0) {
+            SdownClusters[c].resize(2, N_directions);
+            SdownClusters[c] = 0.0;
+          }
+          offsetAlphaTranslation(alpha, alphaCache, l, offset, L_prime, kHats, weights);
+          for (int j=0 ; j<N_directions ; ++j) {
+            SdownClusters[c](0, j) += alpha(j) * levels[l].Sdown(indexLocalCube)(0, j);
+            SdownClusters[c](1, j) += alpha(j) * levels[l].Sdown(indexLocalCube)(1, j);
+          }
+        }
+        // the points in the near zone of a leaf cube are computed directly
+        if ( (l==0) && !IS_FAR ) nearPoints[i].insert(nearPoints[i].end(), clusterPoints[c].begin(), clusterPoints[c].end());
+      }
+    }
+    for (int c=0 ; c<N_clusters ; ++c) {
+      for (unsigned int i=0 ; i<clusterPoints[c].size() ; ++i) pointsCluster[clusterPoints[c][i]] = c;
+    }
+    fatherClusterCoord.swap(clusterCoord);
+    fatherClusterPoints.swap(clusterPoints);
+    SdownFatherClusters.swap(SdownClusters);
+  }
+
+  // plane waves summation at the points of each leaf cluster
+  const int N_theta = levels[0].thetas.size(), N_phi = levels[0].phis.size(), N_directions = N_theta*N_phi;
+  blitz::Array<float, 2> kHats(N_directions, 3), thetaHats(N_directions, 3), phiHats(N_directions, 3);
+  for (int q=0 ; q<N_phi ; ++q) {
+    const float cos_phi = cos(levels[0].phis(q)), sin_phi = sin(levels[0].phis(q));
+    for (int p=0 ; p<N_theta ; ++p) {
+      const int index = p + q*N_theta;
+      const float cos_theta = cos(levels[0].thetas(p)), sin_theta = sin(levels[0].thetas(p));
+      kHats(index, 0) = sin_theta*cos_phi;
+      kHats(index, 1) = sin_theta*sin_phi;
+      kHats(index, 2) = cos_theta;
+      thetaHats(index, 0) = cos_theta*cos_phi;
+      thetaHats(index, 1) = cos_theta*sin_phi;
+      thetaHats(index, 2) = -sin_theta;
+      phiHats(index, 0) = -sin_phi;
+      phiHats(index, 1) = cos_phi;
+      phiHats(index, 2) = 0.0;
+    }
+  }
+  // the leaf clusters are small: the phases are computed in single precision, as in computeDipoleSup
+  const std::complex<float> minus_I_k(static_cast<std::complex<float> >(-I*this->k));
+  for (unsigned int c=0 ; c<fatherClusterCoord.size() ; ++c) {
+    if (SdownFatherClusters[c].size()==0) continue;
+    const blitz::Array<std::complex<float>, 2>& SdownCluster = SdownFatherClusters[c];
+    float rCluster[3];
+    for (int m=0 ; m<3 ; ++m) rCluster[m] = static_cast<float>(big_cube_lower_coord[m] + (fatherClusterCoord[c][m] + 0.5) * levels[0].getCubeSideLength());
+    for (unsigned int i=0 ; i<fatherClusterPoints[c].size() ; ++i) {
+      const int n = fatherClusterPoints[c][i];
+      const float r[3] = {static_cast<float>(r_obs(n, 0)) - rCluster[0], static_cast<float>(r_obs(n, 1)) - rCluster[1], static_cast<float>(r_obs(n, 2)) - rCluster[2]};
+      std::complex<float> E[3] = {0.0, 0.0, 0.0}, H[3] = {0.0, 0.0, 0.0};
+      for (int j=0 ; j<N_directions ; ++j) {
+        const std::complex<float> a(minus_I_k * (kHats(j, 0)*r[0] + kHats(j, 1)*r[1] + kHats(j, 2)*r[2]));
+        float c_a, s_a;
+        const float e = (a.real() == 0.0) ? 1.0 : exp(a.real());
+        sincosf(a.imag(), &s_a, &c_a);
+        const std::complex<float> EXP(e * c_a, e * s_a);
+        const std::complex<float> S_theta = SdownCluster(0, j) * EXP, S_phi = SdownCluster(1, j) * EXP;
+        for (int m=0 ; m<3 ; ++m) {
+          const float thetaHat = thetaHats(j, m), phiHat = phiHats(j, m);
+          E[m] += thetaHat * S_theta + phiHat * S_phi;
+          H[m] += phiHat * S_theta - thetaHat * S_phi;
+        }
+      }
+      for (int m=0 ; m<3 ; ++m) {
+        E_obs(n, m) += E_factor * E[m];
+        H_obs(n, m) += H_factor * H[m];
+      }
+    }
+  }
+  this->resizeSdownLevelsToZero();
+
+  // the near points, leaf cube by leaf cube
+  for (unsigned int i=0 ; i<localLeafCubesIndexes.size() ; ++i) {
+    const int N_near = nearPoints[i].size();
+    if (N_near==0) continue;
+    const Cube & cube = levels[0].cubes[levels[0].cubesIndexesAfterReduction[localLeafCubesIndexes[i]]];
+    const int N_RWG_cube = cube.N_RWG;
+    const int * RWG_numbers = &levels[0].cubesRWG_numbers[cube.RWG_startIndex];
+    blitz::Array<int, 1> numbers_RWG_cube(N_RWG_cube);
+    blitz::Array<float, 2> trianglesCoord_cube(N_RWG_cube, 12);
+    for (int j=0 ; j<N_RWG_cube ; ++j) {
+      numbers_RWG_cube(j) = RWG_numbers[j];
+      trianglesCoord_cube(j, all) = local_target_mesh.localRWGNumber_trianglesCoord(RWG_numbers[j], all);
+    }
+    blitz::Array<std::complex<float>, 1> E_tmp(3), H_tmp(3);
+    for (int j=0 ; j<N_near ; ++j) {
+      const int n = nearPoints[i][j];
+      compute_E_obs(E_tmp, H_tmp, r_obs(n, all), ZI, numbers_RWG_cube, trianglesCoord_cube, w, eps_r, mu_r, FULL_PRECISION);
+      E_obs(n, all) += E_tmp;
+      H_obs(n, all) += H_tmp;
+    }
+  }
+  if (my_id==0) cout << "finished!" << endl;
+}
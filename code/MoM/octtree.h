@@ -6,6 +6,7 @@
 #include <complex>
 #include <blitz/array.h>
 #include <vector>
+#include <map>
 #include <algorithm>  // Include STL algorithms for sorting lists and vectors
 
 using namespace std;
@@ -31,6 +32,8 @@ class Octtree {
     int VERBOSE;
     int N_GaussOnTriangle;
     int DIRECTIONS_PARALLELIZATION, N_levels, ALLOW_CEILING_LEVEL;
+    //! 1 if the far field uses the coarse (sparser) alpha translations of the two-level preconditioner
+    int COARSE_ALPHA_TRANSLATIONS;
     std::complex<double> k;
     std::complex<float> eps_r;
     std::complex<float> mu_r;
@@ -50,6 +53,7 @@ class Octtree {
     Octtree(const Octtree &); // copy constructor
     Octtree& operator=(const Octtree&); // copy assignment operator
     void constructArrays(void);
+    void alphaTranslationsCoarseComputation(const float /*thresholdRelValueMax*/);
     void computeGaussLocatedArguments(const blitz::Array<int, 1>& /*local_cubes_NRWG*/, 
                                       const blitz::Array<int, 1>& /*local_RWG_numbers*/, 
                                       const blitz::Array<int, 1>& /*local_RWG_Numbers_CFIE_OK*/, 
@@ -77,6 +81,7 @@ class Octtree {
     void assignCubesToProcessors(const int /*num_procs*/, const int /*CUBES_DISTRIBUTION*/);
     void writeAssignedLeafCubesToDisk(const string /*path*/, const string /*filename*/);
     void updateSup(const blitz::Array<std::complex<float>, 1>&); // coefficients of RWG functions
+    void setCoarseAlphaTranslations (const int n) {COARSE_ALPHA_TRANSLATIONS = n;}
     void alphaTranslations(void);
     void exchangeSupsIndividually(blitz::Array< blitz::Array<std::complex<float>, 2>, 1>& /*SupThisLevel*/, const int /*l*/, const vector<int> & /*localCubesIndexes*/);
     void exchangeSupsInBlocks(blitz::Array< blitz::Array<std::complex<float>, 2>, 1>& /*SupThisLevel*/, const int /*l*/, const vector<int> & /*localCubesIndexes*/);
@@ -91,19 +96,59 @@ class Octtree {
                                 const blitz::Array<int, 1>& /*alphaTranslationIndexesNonZeros*/,
                                 const blitz::Array<int, 1>& /*alphaTranslationIndexes*/,
                                 const int alphaCartesianCoord[3]);
+    void SupAlphaMultiplicationSwapXY(blitz::Array<std::complex<float>, 2>& /*SupAlpha*/,
+                                      const blitz::Array<std::complex<float>, 2>& /*Sup*/,
+                                      const blitz::Array<std::complex<float>, 1>& /*alphaTranslation*/,
+                                      const blitz::Array<int, 1>& /*alphaTranslationIndexesNonZeros*/,
+                                      const blitz::Array<int, 1>& /*alphaTranslationIndexes*/,
+                                      const blitz::Array<int, 1>& /*alphaTranslationIndexesSwapXY*/,
+                                      const int alphaCartesianCoord[3]);
+    void SupAlphaMultiplicationInterpolated(blitz::Array<std::complex<float>, 2>& /*SupAlpha*/,
+                                            const blitz::Array<std::complex<float>, 2>& /*Sup*/,
+                                            const blitz::Array<std::complex<float>, 1>& /*alphaTranslationSamples*/,
+                                            const blitz::Array<float, 2>& /*kHats*/,
+                                            const blitz::Array<float, 1>& /*weights*/,
+                                            const float /*deltaGamma*/,
+                                            const int /*NOrder*/,
+                                            const int alphaCartesianCoord[3]);
     void SupAlphaMultiplicationDirections(blitz::Array<std::complex<float>, 2>& /*SupAlpha*/,
                                                    const blitz::Array<std::complex<float>, 2>& /*Sup*/,
                                                    const blitz::Array<std::complex<float>, 1>& /*alphaTranslation*/,
                                                    const blitz::Array<int, 1>& /*alphaTranslationIndexesNonZeros*/,
                                                    const int alphaCartesianCoord[3]);
+    void alphaTranslationMultiplication(blitz::Array<std::complex<float>, 2>& /*SupAlpha*/,
+                                        const blitz::Array<std::complex<float>, 2>& /*Sup*/,
+                                        const int /*l*/,
+                                        const int alphaCartesianCoord[3],
+                                        const bool /*COARSE*/);
+    //! the alpha translation of level l, with the weights, for an offset (in cube side lengths) between grid cells
+    /*!
+      The translations are kept in alphaCache, by offset. Those stored for the matvec are expanded to all
+      the directions, the others are computed by pointAlphaTranslation.
+    */
+    void offsetAlphaTranslation(blitz::Array<std::complex<float>, 1>& /*alpha*/,
+                                std::map< std::vector<int>, blitz::Array<std::complex<float>, 1> >& /*alphaCache*/,
+                                const int /*l*/,
+                                const int offset[3],
+                                const int /*L_prime*/,
+                                const blitz::Array<float, 2>& /*kHats*/,
+                                const blitz::Array<float, 1>& /*weights*/);
     void alphaTranslationsToCube(blitz::Array<std::complex<float>, 2>& /*S_tmp*/,
                                  const blitz::Array< blitz::Array<std::complex<float>, 2>, 1>& /*LevelSup*/,
                                  const int /*l*/,
                                  const int /*cubeIndex*/,
-                                 const std::vector<int>& /*indexesAlphaParticipants*/,
+                                 const int * /*indexesAlphaParticipants*/,
+                                 const int /*N_part*/,
                                  const int /*DIRECTIONS_PARALLELIZATION*/);
     void shiftExp(blitz::Array<std::complex<float>, 2>& /*S*/,
                   const std::vector< std::complex<float> >& /*shiftingArray*/);
+    void SdownToSon(blitz::Array<std::complex<float>, 2>& /*SdownSon*/,
+                    const blitz::Array<std::complex<float>, 2>& /*Sdown*/,
+                    const int /*l*/,
+                    const float D[3],
+                    blitz::Array<std::complex<float>, 2>& /*Stmp2*/,
+                    blitz::Array<std::complex<float>, 2>& /*Stmp3*/);
+    void descentToLeafLevel(const int /*topLevel*/);
     void computeFarField (blitz::Array<std::complex<float>, 2>& e_theta_far,
                           blitz::Array<std::complex<float>, 2>& e_phi_far,
                           const blitz::Array<float, 1>& r_phase_center,
@@ -129,6 +174,33 @@ class Octtree {
                           const float rCenter[3],
                           const blitz::Array<float, 1>& thetas,
                           const blitz::Array<float, 1>& phis);
+    //! the excitation vector of electric (CURRENT_TYPE 'J') or magnetic ('M') dipoles
+    /*!
+      The dipoles are gathered in clusters, the cells of the grid of each level. The radiation
+      function of a cluster is translated to the cubes of the coarsest level that are not its
+      neighbors, and then disaggregated down to the leaf cubes like in the matvec. Only the
+      dipoles in the near zone of a leaf cube are coupled directly to its RWGs.
+    */
+    void computeDipolesExcitation(blitz::Array<std::complex<float>, 1>& /*V_CFIE*/,
+                                  const blitz::Array<std::complex<double>, 2>& /*J_dip*/,
+                                  const blitz::Array<double, 2>& /*r_dip*/,
+                                  const char /*CURRENT_TYPE*/,
+                                  const LocalMesh & /*local_target_mesh*/,
+                                  const int /*FULL_PRECISION*/);
+    //! the local contributions to the fields radiated by the currents ZI at the points r_obs
+    /*!
+      Same grouping as computeDipolesExcitation, the other way around: the radiation functions
+      of the cubes are translated to the clusters of observation points that are well separated
+      from them, at the coarsest level possible. What a cluster receives is disaggregated to its
+      sons down to the leaf level, where it is summed as plane waves at the points. The
+      points in the near zone of a leaf cube are computed directly with compute_E_obs.
+    */
+    void computeObservationFields(blitz::Array<std::complex<float>, 2>& /*E_obs*/,
+                                  blitz::Array<std::complex<float>, 2>& /*H_obs*/,
+                                  const blitz::Array<double, 2>& /*r_obs*/,
+                                  const blitz::Array<std::complex<float>, 1>& /*ZI*/,
+                                  const LocalMesh & /*local_target_mesh*/,
+                                  const int /*FULL_PRECISION*/);
     void resizeSdownLevelsToZero(void) {for (unsigned int i=0 ; i<levels.size() ; ++i) levels[i].Sdown.resize(0);}
 };
 #endif
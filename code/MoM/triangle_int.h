@@ -96,6 +96,9 @@ void IT_fm_fn (double & IT_r_square,
                double IT_r[], // dim 3
                const Triangle & T);
 
+//! the maximum number of points of the triangle quadrature rules given by IT_points
+const int N_MAX_POINTS_TRIANGLE = 13;
+
 void ITs_free (std::complex<double>& ITs_G,
                std::complex<double> ITs_G_rprime_r[], // dim 3
                std::complex<double> ITs_grad_G[], // dim 3
@@ -329,15 +329,35 @@ void ITs_free (std::complex<double>& ITs_G,
                const int EXTRACT_R)
 {
   const double RSMALL_SQUARE = RSMALL*RSMALL;
-  double R, R_square, IT_1_R, IT_R;
+  double IT_1_R, IT_R;
   std::complex<double> G_j, minus_I_k(-I*k), minus_I_k_R, exp_minus_I_k_R;
-  double rprime_r[3], IT_1_R_rprime_r[3], IT_R_rprime_r[3], IT_grad_1_R[3]; // IT_grad_R[3];
+  double IT_1_R_rprime_r[3], IT_R_rprime_r[3], IT_grad_1_R[3]; // IT_grad_R[3];
   const double r0_r2[3] = {Ts.r_nodes[0][0]-Ts.r_nodes[2][0], Ts.r_nodes[0][1]-Ts.r_nodes[2][1], Ts.r_nodes[0][2]-Ts.r_nodes[2][2]};
   const double r1_r2[3] = {Ts.r_nodes[1][0]-Ts.r_nodes[2][0], Ts.r_nodes[1][1]-Ts.r_nodes[2][1], Ts.r_nodes[1][2]-Ts.r_nodes[2][2]};
   const double r2_r[3] = {Ts.r_nodes[2][0]-r[0], Ts.r_nodes[2][1]-r[1], Ts.r_nodes[2][2]-r[2]};
 
   const double norm_factor = Ts.A/sum_weights;
 
+  // the regular part of the kernel is first evaluated for all the source points at once,
+  // in a structure-of-arrays layout, so that the exp/cos/sin loop can be vectorised.
+  // exp(-I*k*R) = exp(k.imag()*R) * (cos(-k.real()*R) + I*sin(-k.real()*R))
+  double rprime_r_x[N_MAX_POINTS_TRIANGLE], rprime_r_y[N_MAX_POINTS_TRIANGLE], rprime_r_z[N_MAX_POINTS_TRIANGLE];
+  double R_square[N_MAX_POINTS_TRIANGLE], R[N_MAX_POINTS_TRIANGLE];
+  double exp_re[N_MAX_POINTS_TRIANGLE], cos_im[N_MAX_POINTS_TRIANGLE], sin_im[N_MAX_POINTS_TRIANGLE];
+  const double k_re = k.real(), k_im = k.imag();
+  for (int j=0 ; j<N_points ; j++) {
+    rprime_r_x[j] = r0_r2[0] * xi[j] + r1_r2[0] * eta[j] + r2_r[0];
+    rprime_r_y[j] = r0_r2[1] * xi[j] + r1_r2[1] * eta[j] + r2_r[1];
+    rprime_r_z[j] = r0_r2[2] * xi[j] + r1_r2[2] * eta[j] + r2_r[2];
+    R_square[j] = rprime_r_x[j]*rprime_r_x[j] + rprime_r_y[j]*rprime_r_y[j] + rprime_r_z[j]*rprime_r_z[j];
+    R[j] = sqrt(R_square[j]);
+  }
+  for (int j=0 ; j<N_points ; j++) {
+    exp_re[j] = exp(k_im * R[j]);
+    cos_im[j] = cos(-k_re * R[j]);
+    sin_im[j] = sin(-k_re * R[j]);
+  }
+
   ITs_G = 0.0; // complex<double>
   for (int i=0; i<3; i++) {
     ITs_G_rprime_r[i] = 0.0; // Vector<complex<double>, 3>
@@ -345,26 +365,16 @@ void ITs_free (std::complex<double>& ITs_G,
   }
   if ((EXTRACT_1_R==0) && (EXTRACT_R==0)) { // no singularity extraction
     for (int j=0 ; j<N_points ; j++) {
-      rprime_r[0] = r0_r2[0] * xi[j] + r1_r2[0] * eta[j] + r2_r[0];
-      rprime_r[1] = r0_r2[1] * xi[j] + r1_r2[1] * eta[j] + r2_r[1];
-      rprime_r[2] = r0_r2[2] * xi[j] + r1_r2[2] * eta[j] + r2_r[2];
-      R_square = rprime_r[0]*rprime_r[0] + rprime_r[1]*rprime_r[1] + rprime_r[2]*rprime_r[2];
-      R = sqrt(R_square);
-      minus_I_k_R = minus_I_k*R;
-//      G_j = exp(minus_I_k_R) * (weights[j]/R);
-//      G_j = (exp(minus_I_k_R.real()) * (weights[j]/R)) * std::complex<double>(cos(minus_I_k_R.imag()), sin(minus_I_k_R.imag())); // exp(a + ib) = exp(a) * (cos(b) + i*sin(b))
-      double c, s, e;
-      e = (minus_I_k_R.real() == 0.0) ? 1.0 * (weights[j]/R) : exp(minus_I_k_R.real()) * (weights[j]/R);
-      sincos(minus_I_k_R.imag(), &s, &c);
-      G_j = e * std::complex<double>(c, s);
+      minus_I_k_R = minus_I_k*R[j];
+      G_j = (exp_re[j] * (weights[j]/R[j])) * std::complex<double>(cos_im[j], sin_im[j]);
       ITs_G += G_j;
-      ITs_G_rprime_r[0] += G_j * rprime_r[0];
-      ITs_G_rprime_r[1] += G_j * rprime_r[1];
-      ITs_G_rprime_r[2] += G_j * rprime_r[2];
-      const std::complex<double> temp(G_j * (1.0-minus_I_k_R)/(R_square));
-      ITs_grad_G[0] += temp * rprime_r[0];
-      ITs_grad_G[1] += temp * rprime_r[1];
-      ITs_grad_G[2] += temp * rprime_r[2];
+      ITs_G_rprime_r[0] += G_j * rprime_r_x[j];
+      ITs_G_rprime_r[1] += G_j * rprime_r_y[j];
+      ITs_G_rprime_r[2] += G_j * rprime_r_z[j];
+      const std::complex<double> temp(G_j * (1.0-minus_I_k_R)/(R_square[j]));
+      ITs_grad_G[0] += temp * rprime_r_x[j];
+      ITs_grad_G[1] += temp * rprime_r_y[j];
+      ITs_grad_G[2] += temp * rprime_r_z[j];
     }
     ITs_G *= norm_factor;
     for (int i=0; i<3; i++) {
@@ -375,32 +385,22 @@ void ITs_free (std::complex<double>& ITs_G,
  
   else if ((EXTRACT_1_R==1) && (EXTRACT_R==0)) { // 1/R singularity extraction
     for (int j=0 ; j<N_points ; j++) {
-      rprime_r[0] = r0_r2[0] * xi[j] + r1_r2[0] * eta[j] + r2_r[0];
-      rprime_r[1] = r0_r2[1] * xi[j] + r1_r2[1] * eta[j] + r2_r[1];
-      rprime_r[2] = r0_r2[2] * xi[j] + r1_r2[2] * eta[j] + r2_r[2];
-      R_square = rprime_r[0]*rprime_r[0] + rprime_r[1]*rprime_r[1] + rprime_r[2]*rprime_r[2];
-      if (R_square>RSMALL_SQUARE) {
-        R = sqrt(R_square);
-        minus_I_k_R = minus_I_k*R;
-//        exp_minus_I_k_R = exp(minus_I_k_R);
-//        exp_minus_I_k_R = exp(minus_I_k_R.real()) * std::complex<double>(cos(minus_I_k_R.imag()), sin(minus_I_k_R.imag()));
-        double c, s, e;
-        e = (minus_I_k_R.real() == 0.0) ? 1.0 : exp(minus_I_k_R.real());
-        sincos(minus_I_k_R.imag(), &s, &c);
-        exp_minus_I_k_R = e * std::complex<double>(c, s);
-        G_j = (exp_minus_I_k_R - 1.0) * (weights[j]/R);
-        const std::complex<double> temp((exp_minus_I_k_R*(1.0-minus_I_k_R) - 1.0) * (weights[j]/(R*R_square)) );
-        ITs_grad_G[0] += temp * rprime_r[0];
-        ITs_grad_G[1] += temp * rprime_r[1];
-        ITs_grad_G[2] += temp * rprime_r[2];
+      if (R_square[j]>RSMALL_SQUARE) {
+        minus_I_k_R = minus_I_k*R[j];
+        exp_minus_I_k_R = exp_re[j] * std::complex<double>(cos_im[j], sin_im[j]);
+        G_j = (exp_minus_I_k_R - 1.0) * (weights[j]/R[j]);
+        const std::complex<double> temp((exp_minus_I_k_R*(1.0-minus_I_k_R) - 1.0) * (weights[j]/(R[j]*R_square[j])) );
+        ITs_grad_G[0] += temp * rprime_r_x[j];
+        ITs_grad_G[1] += temp * rprime_r_y[j];
+        ITs_grad_G[2] += temp * rprime_r_z[j];
       }
       else {
         G_j = minus_I_k * weights[j];
       }
       ITs_G += G_j;
-      ITs_G_rprime_r[0] += G_j * rprime_r[0];
-      ITs_G_rprime_r[1] += G_j * rprime_r[1];
-      ITs_G_rprime_r[2] += G_j * rprime_r[2];
+      ITs_G_rprime_r[0] += G_j * rprime_r_x[j];
+      ITs_G_rprime_r[1] += G_j * rprime_r_y[j];
+      ITs_G_rprime_r[2] += G_j * rprime_r_z[j];
     }
     IT_singularities (IT_1_R, IT_R, IT_1_R_rprime_r, IT_R_rprime_r, IT_grad_1_R, r, Ts);
     ITs_G = ITs_G * norm_factor + IT_1_R;
@@ -413,32 +413,22 @@ void ITs_free (std::complex<double>& ITs_G,
   else if ((EXTRACT_1_R==1) && (EXTRACT_R==1)) { // 1/R and R singularity extraction
     const std::complex<double> k_square = k*k;
     for (int j=0 ; j<N_points ; j++) {
-      rprime_r[0] = r0_r2[0] * xi[j] + r1_r2[0] * eta[j] + r2_r[0];
-      rprime_r[1] = r0_r2[1] * xi[j] + r1_r2[1] * eta[j] + r2_r[1];
-      rprime_r[2] = r0_r2[2] * xi[j] + r1_r2[2] * eta[j] + r2_r[2];
-      R_square = rprime_r[0]*rprime_r[0] + rprime_r[1]*rprime_r[1] + rprime_r[2]*rprime_r[2];
-      if (R_square>RSMALL_SQUARE) {
-        R = sqrt(R_square);
-        minus_I_k_R = minus_I_k*R;
-//        exp_minus_I_k_R = exp(minus_I_k_R);
-//        exp_minus_I_k_R = exp(minus_I_k_R.real()) * std::complex<double>(cos(minus_I_k_R.imag()), sin(minus_I_k_R.imag()));
-        double c, s, e;
-        e = (minus_I_k_R.real() == 0.0) ? 1.0 : exp(minus_I_k_R.real());
-        sincos(minus_I_k_R.imag(), &s, &c);
-        exp_minus_I_k_R = e * std::complex<double>(c, s);
-        G_j = ( (exp_minus_I_k_R - 1.0)/R + k_square * (R*0.5) ) * weights[j];
-        const std::complex<double> temp( (exp_minus_I_k_R*(1.0-minus_I_k_R) - 1.0 - k_square * (0.5*R_square)) * (weights[j]/(R*R_square)) );
-        ITs_grad_G[0] += temp * rprime_r[0];
-        ITs_grad_G[1] += temp * rprime_r[1];
-        ITs_grad_G[2] += temp * rprime_r[2];
+      if (R_square[j]>RSMALL_SQUARE) {
+        minus_I_k_R = minus_I_k*R[j];
+        exp_minus_I_k_R = exp_re[j] * std::complex<double>(cos_im[j], sin_im[j]);
+        G_j = ( (exp_minus_I_k_R - 1.0)/R[j] + k_square * (R[j]*0.5) ) * weights[j];
+        const std::complex<double> temp( (exp_minus_I_k_R*(1.0-minus_I_k_R) - 1.0 - k_square * (0.5*R_square[j])) * (weights[j]/(R[j]*R_square[j])) );
+        ITs_grad_G[0] += temp * rprime_r_x[j];
+        ITs_grad_G[1] += temp * rprime_r_y[j];
+        ITs_grad_G[2] += temp * rprime_r_z[j];
       }
       else {
         G_j = minus_I_k * weights[j];
       }
       ITs_G += G_j;
-      ITs_G_rprime_r[0] += G_j * rprime_r[0];
-      ITs_G_rprime_r[1] += G_j * rprime_r[1];
-      ITs_G_rprime_r[2] += G_j * rprime_r[2];
+      ITs_G_rprime_r[0] += G_j * rprime_r_x[j];
+      ITs_G_rprime_r[1] += G_j * rprime_r_y[j];
+      ITs_G_rprime_r[2] += G_j * rprime_r_z[j];
     }
     IT_singularities (IT_1_R, IT_R, IT_1_R_rprime_r, IT_R_rprime_r, IT_grad_1_R, r, Ts);
     const std::complex<double> k_square_2(k_square*0.5);
@@ -139,7 +139,12 @@ if __name__=='__main__':
             yticks(fontsize=FontSize)
             grid(True)
             show()
-    if params_simu.BISTATIC==1:
+    if (params_simu.BISTATIC==1) and (params_simu.BISTATIC_MULTIPLE_EXCITATIONS==1):
+        N_excitations = readIntFromDisk(os.path.join(simuDirName, 'result', 'N_excitations.txt'))
+        print("See the 'excitation<e>_*' files in './result' directory for the results of the " + str(N_excitations) + " excitations.")
+        nameOfFileToSaveTo = os.path.join(simuDirName, 'result', "simulation_parameters.txt")
+        params_simu.saveTo(nameOfFileToSaveTo)
+    elif params_simu.BISTATIC==1:
         params_simu.VERBOSE = 1
         # user supplied R_OBS
         if params_simu.BISTATIC_R_OBS==1:
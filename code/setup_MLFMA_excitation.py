@@ -2,7 +2,7 @@ import sys, os, argparse
 from mpi4py import MPI
 from numpy import zeros, array
 from ReadWriteBlitzArray import writeScalarToDisk, writeASCIIBlitzArrayToDisk
-from read_dipole_excitation import read_dipole_excitation, read_observation_points
+from read_dipole_excitation import read_dipole_excitation, read_observation_points, read_input_angles
 
 def setup_excitation(params_simu, inputDirName, simuDirName):
     num_proc = MPI.COMM_WORLD.Get_size()
@@ -40,6 +40,12 @@ def setup_excitation(params_simu, inputDirName, simuDirName):
     writeScalarToDisk(params_simu.BISTATIC_EXCITATION_DIPOLES, os.path.join(tmpDirName,'V_CFIE/DIPOLES_EXCITATION.txt'))
     writeScalarToDisk(params_simu.BISTATIC_EXCITATION_PLANE_WAVE, os.path.join(tmpDirName,'V_CFIE/PLANE_WAVE_EXCITATION.txt'))
     writeScalarToDisk(params_simu.V_FULL_PRECISION*1, os.path.join(tmpDirName, 'V_CFIE/V_FULL_PRECISION.txt') )
+    writeScalarToDisk(params_simu.V_CFIE_N_THREADS, os.path.join(tmpDirName, 'V_CFIE/V_CFIE_N_THREADS.txt') )
+    writeScalarToDisk(params_simu.V_CFIE_PLANE_WAVES_BATCH_SIZE, os.path.join(tmpDirName, 'V_CFIE/V_CFIE_PLANE_WAVES_BATCH_SIZE.txt') )
+    writeScalarToDisk(params_simu.V_DIPOLES_OCTTREE, os.path.join(tmpDirName, 'V_CFIE/V_DIPOLES_OCTTREE.txt') )
+    writeScalarToDisk(params_simu.E_OBS_OCTTREE, os.path.join(tmpDirName, 'V_CFIE/E_OBS_OCTTREE.txt') )
+    # each dipole and plane wave solved as a separate excitation?
+    writeScalarToDisk(params_simu.BISTATIC_MULTIPLE_EXCITATIONS, os.path.join(tmpDirName,'V_CFIE/MULTIPLE_EXCITATIONS.txt'))
     # if we have dipoles excitation AND definition of the excitation in a user-supplied file
     if (params_simu.BISTATIC_EXCITATION_DIPOLES == 1):
         if params_simu.BISTATIC_EXCITATION_J_DIPOLES_FILENAME != "":
@@ -72,6 +78,16 @@ def setup_excitation(params_simu, inputDirName, simuDirName):
         writeScalarToDisk(params_simu.phi_inc, os.path.join(tmpDirName,'V_CFIE/phi_inc.txt'))
         E_inc = array([params_simu.E_inc_theta, params_simu.E_inc_phi], 'D')
         writeASCIIBlitzArrayToDisk(E_inc, os.path.join(tmpDirName,'V_CFIE/E_inc.txt'))
+        if (params_simu.BISTATIC_MULTIPLE_EXCITATIONS == 1) and (params_simu.BISTATIC_EXCITATION_PLANE_WAVES_FILENAME != ""):
+            if (my_id==0): # this file is only on processor 0
+                plane_waves_angles = read_input_angles(os.path.join(inputDirName, params_simu.BISTATIC_EXCITATION_PLANE_WAVES_FILENAME))
+            else:
+                plane_waves_angles = zeros((1, 2), 'd')
+            plane_waves_angles = MPI.COMM_WORLD.bcast(plane_waves_angles)
+            writeASCIIBlitzArrayToDisk(plane_waves_angles, os.path.join(tmpDirName,'V_CFIE/plane_waves_angles.txt'))
+            writeScalarToDisk(1, os.path.join(tmpDirName,'V_CFIE/PLANE_WAVES_FROM_FILE.txt'))
+        else:
+            writeScalarToDisk(0, os.path.join(tmpDirName,'V_CFIE/PLANE_WAVES_FROM_FILE.txt'))
     if (params_simu.BISTATIC_EXCITATION_DIPOLES != 1) and (params_simu.BISTATIC_EXCITATION_PLANE_WAVE != 1):
         if (my_id==0):
             print("incorrect excitation choice. You have to choose dipole and/or plane wave excitation.")
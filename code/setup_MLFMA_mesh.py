@@ -67,9 +67,17 @@ def setup_mesh(params_simu, simuDirName):
     writeScalarToDisk(params_simu.CYCLIC_Phi*1, os.path.join(tmpDirName,'octtree_data/CYCLIC_Phi.txt') )
     writeScalarToDisk(params_simu.ALLOW_CEILING_LEVEL*1, os.path.join(tmpDirName, 'octtree_data/ALLOW_CEILING_LEVEL.txt') )
     writeScalarToDisk(params_simu.DIRECTIONS_PARALLELIZATION*1, os.path.join(tmpDirName, 'octtree_data/DIRECTIONS_PARALLELIZATION.txt') )
+    writeScalarToDisk(params_simu.MESH_MPI_IO*1, os.path.join(tmpDirName, 'octtree_data/MESH_MPI_IO.txt') )
+    writeScalarToDisk(params_simu.DISTRIBUTED_OCTTREE*1, os.path.join(tmpDirName, 'octtree_data/DISTRIBUTED_OCTTREE.txt') )
     writeScalarToDisk(params_simu.BE_BH_N_Gauss_points, os.path.join(tmpDirName, 'octtree_data/N_GaussOnTriangle.txt') )
     writeScalarToDisk(params_simu.MOM_FULL_PRECISION*1, os.path.join(tmpDirName, 'octtree_data/MOM_FULL_PRECISION.txt') )
+    writeScalarToDisk(params_simu.MOM_NEAR_FIELD_ACCURACY, os.path.join(tmpDirName, 'octtree_data/MOM_NEAR_FIELD_ACCURACY.txt') )
+    writeScalarToDisk(params_simu.MOM_NEAR_FIELD_CACHE*1, os.path.join(tmpDirName, 'octtree_data/MOM_NEAR_FIELD_CACHE.txt') )
+    writeScalarToDisk(params_simu.MOM_NEAR_FIELD_CACHE_TOL, os.path.join(tmpDirName, 'octtree_data/MOM_NEAR_FIELD_CACHE_TOL.txt') )
+    writeScalarToDisk(params_simu.MOM_NEAR_FIELD_CACHE_MAX_MB, os.path.join(tmpDirName, 'octtree_data/MOM_NEAR_FIELD_CACHE_MAX_MB.txt') )
     writeScalarToDisk(params_simu.VERBOSE*1, os.path.join(tmpDirName, 'octtree_data/VERBOSE.txt') )
+    writeScalarToDisk(params_simu.SAI_PRECOND_N_THREADS, os.path.join(tmpDirName, 'octtree_data/SAI_PRECOND_N_THREADS.txt') )
+    writeScalarToDisk(params_simu.SAI_PRECOND_DROP_THRESHOLD, os.path.join(tmpDirName, 'octtree_data/SAI_PRECOND_DROP_THRESHOLD.txt') )
     writeScalarToDisk(params_simu.TDS_APPROX*1, os.path.join(tmpDirName, 'octtree_data/TDS_APPROX.txt') )
     writeScalarToDisk(params_simu.Z_s, os.path.join(tmpDirName, 'octtree_data/Z_s.txt') )
     # what type of simulation are we running?
@@ -88,11 +96,15 @@ def setup_mesh(params_simu, simuDirName):
     writeScalarToDisk(params_simu.MAXITER, os.path.join(tmpDirName, 'iterative_data/MAXITER.txt') )
     writeScalarToDisk(restrt, os.path.join(tmpDirName, 'iterative_data/RESTART.txt') )
     writeScalarToDisk(params_simu.SOLVER, os.path.join(tmpDirName, 'iterative_data/SOLVER.txt') )
+    writeScalarToDisk(min(params_simu.GCRODR_RECYCLED_DIMENSION, restrt - 1), os.path.join(tmpDirName, 'iterative_data/GCRODR_RECYCLED_DIMENSION.txt') )
+    writeScalarToDisk(params_simu.GMRES_MULTIPLE_RHS_BATCH_SIZE, os.path.join(tmpDirName, 'iterative_data/GMRES_MULTIPLE_RHS_BATCH_SIZE.txt') )
     writeScalarToDisk(params_simu.INNER_SOLVER, os.path.join(tmpDirName, 'iterative_data/INNER_SOLVER.txt') )
     writeScalarToDisk(params_simu.TOL, os.path.join(tmpDirName, 'iterative_data/TOL.txt') )
     writeScalarToDisk(params_simu.INNER_TOL, os.path.join(tmpDirName, 'iterative_data/INNER_TOL.txt') )
     writeScalarToDisk(params_simu.INNER_MAXITER, os.path.join(tmpDirName, 'iterative_data/INNER_MAXITER.txt') )
     writeScalarToDisk(params_simu.INNER_RESTART, os.path.join(tmpDirName, 'iterative_data/INNER_RESTART.txt') )
+    writeScalarToDisk(params_simu.INNER_COARSE_MLFMA*1, os.path.join(tmpDirName, 'iterative_data/INNER_COARSE_MLFMA.txt') )
+    writeScalarToDisk(params_simu.INNER_COARSE_ALPHA_THRESHOLD, os.path.join(tmpDirName, 'iterative_data/INNER_COARSE_ALPHA_THRESHOLD.txt') )
     writeScalarToDisk(N_RWG, os.path.join(tmpDirName, 'ZI/ZI_size.txt') )
 
     variables = {}
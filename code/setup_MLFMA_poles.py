@@ -118,6 +118,9 @@ def computeTreeParameters(my_id, tmpDirName, a, k, N_levels, params_simu):
     writeScalarToDisk(params_simu.alphaTranslation_smoothing_factor, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_smoothing_factor.txt') )
     writeScalarToDisk(params_simu.alphaTranslation_thresholdRelValueMax, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_thresholdRelValueMax.txt') )
     writeScalarToDisk(params_simu.alphaTranslation_RelativeCountAboveThreshold, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_RelativeCountAboveThreshold.txt') )
+    writeScalarToDisk(params_simu.alphaTranslation_N_interpolated_levels, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_N_interpolated_levels.txt') )
+    writeScalarToDisk(params_simu.alphaTranslation_interpolation_order, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_interpolation_order.txt') )
+    writeScalarToDisk(params_simu.alphaTranslation_interpolation_oversampling, os.path.join(tmpDirName, 'octtree_data/alphaTranslation_interpolation_oversampling.txt') )
     writeASCIIBlitzArrayToDisk(octtreeNthetas, os.path.join(tmpDirName, 'octtree_data/octtreeNthetas.txt') )
     writeASCIIBlitzArrayToDisk(octtreeNphis, os.path.join(tmpDirName, 'octtree_data/octtreeNphis.txt') )
     writeASCIIBlitzArrayToDisk(octtreeXthetas, os.path.join(tmpDirName, 'octtree_data/octtreeXthetas.txt') )
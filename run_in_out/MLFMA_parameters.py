@@ -16,8 +16,33 @@ params_simu.languageForMeshConstruction = languageForMeshConstruction[1]
 
 # MOM_FULL_PRECISION = 0/1: faster/slower Z_near computation but less/more precision
 params_simu.MOM_FULL_PRECISION = 1
+# MOM_NEAR_FIELD_ACCURACY: if > 0, the number of quadrature points of the non-touching
+# triangles pairs of Z_near is chosen from their distance-to-size ratio and electrical
+# size, so that the estimated relative error is below this target. 1.0e-4 keeps the 6 points
+# of the near pairs and uses 3 points for the well-separated ones. 0 keeps the fixed rules.
+params_simu.MOM_NEAR_FIELD_ACCURACY = 0.0
+# MOM_NEAR_FIELD_CACHE = 0/1: reuse the Z_near triangle-to-triangle integrals of the pairs of
+# triangles that are translated copies of each other. Useful for regular or periodic meshes.
+# MOM_NEAR_FIELD_CACHE_TOL is the geometric tolerance, relative to the leaf cubes side length.
+# MOM_NEAR_FIELD_CACHE_MAX_MB is the memory budget of the cache, per process, in MB.
+params_simu.MOM_NEAR_FIELD_CACHE = 0
+params_simu.MOM_NEAR_FIELD_CACHE_TOL = 1.0e-6
+params_simu.MOM_NEAR_FIELD_CACHE_MAX_MB = 100.0
 # V_FULL_PRECISION = 0/1: faster/slower V_CFIE computation but less/more precision
 params_simu.V_FULL_PRECISION = 1
+# the number of threads per process computing the plane waves excitation vectors
+params_simu.V_CFIE_N_THREADS = 1
+# the number of monostatic incidence angles whose excitation vectors are computed together,
+# in one pass over the mesh. Each of them takes one complex vector of the local RWGs in memory.
+params_simu.V_CFIE_PLANE_WAVES_BATCH_SIZE = 16
+# V_DIPOLES_OCTTREE = 0/1: the dipoles excitation vector is computed directly/through the
+# octtree translations, the direct computation being kept for the dipoles close to a leaf cube.
+# Faster for many dipoles or for dipoles far from a large target.
+params_simu.V_DIPOLES_OCTTREE = 0
+# E_OBS_OCTTREE = 0/1: the fields at the observation points r_obs are computed directly/through
+# the octtree translations, the direct computation being kept for the points close to a leaf cube.
+# Faster for large numbers of observation points (near-field maps).
+params_simu.E_OBS_OCTTREE = 0
 
 # the a (finest cubes sidelength) factor -- it will multiply lambda (the wavelength)
 # to obtain the side length of the leaf (finest) level . Usually: a = lambda/4.
@@ -36,6 +61,17 @@ params_simu.BE_BH_N_Gauss_points = 1
 # at the ceiling level
 params_simu.DIRECTIONS_PARALLELIZATION = 1
 
+# MESH_MPI_IO = 0/1: the mesh is read by the master process and sent to the other processes/
+# each process reads its own part of the mesh with MPI-IO. The latter requires the simulation
+# directory to be on a file system shared by all the processes.
+params_simu.MESH_MPI_IO = 0
+
+# DISTRIBUTED_OCTTREE = 0/1: the centroids of all the leaf cubes are broadcasted and each process
+# builds the whole tree/each process reads a part of the centroids with MPI-IO and builds its tree
+# only from the cubes it owns and those it interacts with. The latter requires a shared file system
+# and ALLOW_CEILING_LEVEL = 0.
+params_simu.DISTRIBUTED_OCTTREE = 0
+
 # do we allow a ceiling level that could be other than the third coarsest level?
 # the ceiling level having the smallest memory footprint(by its cubes is chosen)
 params_simu.ALLOW_CEILING_LEVEL = 0
@@ -55,6 +91,16 @@ params_simu.MAXIMUM_DELTA_PHASE = 0.0 # in degrees
 # dumped to the disk in order to minimize RAM memory occupation
 params_simu.MAX_BLOCK_SIZE = 100.
 
+# the number of threads per process computing the SAI preconditioner. The per-cube
+# least squares problems are then solved concurrently. Should not exceed the number
+# of cores available to each MPI process.
+params_simu.SAI_PRECOND_N_THREADS = 1
+# the SAI preconditioner entries smaller than SAI_PRECOND_DROP_THRESHOLD times the largest
+# entry of their row are dropped. This makes the preconditioner sparser, hence cheaper to
+# apply, usually at the price of a few more iterations. 0 keeps all the entries, otherwise
+# it must be in (0, 1]. The largest entry of each row is always kept.
+params_simu.SAI_PRECOND_DROP_THRESHOLD = 0.0
+
 # the integration type. Usually Gauss-Legendre for theta and Poncelet for phi.
 params_simu.int_method_theta = "GAUSSL"
 params_simu.int_method_phi = "PONCELET"
@@ -78,3 +124,11 @@ params_simu.alphaTranslation_smoothing_factor = 1.4
 params_simu.alphaTranslation_thresholdRelValueMax = 1.0e-3
 params_simu.alphaTranslation_RelativeCountAboveThreshold = 0.6
 
+# the alpha translations of the N coarsest levels can be stored only as functions of the
+# angle between the direction and the translation vector, and interpolated on the fly.
+# This saves a lot of memory at the coarse levels, for a little more computation.
+# 0 = no interpolation. Levels parallelized by directions are never interpolated.
+params_simu.alphaTranslation_N_interpolated_levels = 0
+params_simu.alphaTranslation_interpolation_order = 8
+params_simu.alphaTranslation_interpolation_oversampling = 3.0
+
@@ -94,6 +94,19 @@ params_simu.BISTATIC_EXCITATION_M_DIPOLES_FILENAME = ""
 #
 # where J = [J_x J_y J_z] is the dipole and r = [r_x r_y r_z] its origin.
 
+# multiple independent excitations: if 1, each dipole of the excitation files and each
+# plane wave is solved as a separate excitation, all in the same run and sharing the
+# MLFMA setup. The results of excitation number e are written in the 'result' directory
+# with the prefix 'excitation<e>_': the J dipoles come first, then the M dipoles, then the plane waves.
+params_simu.BISTATIC_MULTIPLE_EXCITATIONS = 0
+# the name of the file holding the plane wave directions for multiple excitations. Set to "" if empty,
+# in which case theta_inc and phi_inc below are used. Each line has 2 columns, in degrees:
+#
+# theta_inc phi_inc
+#
+# All these plane waves have the amplitudes E_inc_theta and E_inc_phi given below.
+params_simu.BISTATIC_EXCITATION_PLANE_WAVES_FILENAME = ""
+
 if params_simu.BISTATIC_EXCITATION_PLANE_WAVE == 1:
     # origin, strength, phase and polarization of the plane wave
     params_simu.theta_inc = pi/2.0
@@ -179,17 +192,32 @@ if params_simu.MONOSTATIC_SAR==1:
 # SOLVER DATA
 # iterative solver tolerance
 params_simu.TOL = 1.e-3
-# iterative solver: BICGSTAB, GMRES, RGMRES or FGMRES
-SOLVERS = ["BICGSTAB", "GMRES", "RGMRES", "FGMRES"]
+# iterative solver: BICGSTAB, GMRES, RGMRES, FGMRES or GCRODR
+SOLVERS = ["BICGSTAB", "GMRES", "RGMRES", "FGMRES", "GCRODR"]
 params_simu.SOLVER = SOLVERS[0]
 params_simu.MAXITER = 300
-# RESTART is only for (F)GMRES
+# RESTART is only for (F)GMRES and GCRODR
 params_simu.RESTART = 30
+# GCRODR is a GMRES with deflated restarts, whose deflation subspace (the
+# approximate slowest eigenmodes) is recycled from one monostatic incidence
+# angle to the next. Its dimension must be smaller than RESTART.
+params_simu.GCRODR_RECYCLED_DIMENSION = 10
+# with the GMRES solver, the independent right-hand sides (multiple excitations, monostatic RCS
+# incidences without USE_PREVIOUS_SOLUTION, monostatic SAR points) are solved by batches of this
+# size, in lockstep: the near-field and preconditioner products are then made once per batch
+# instead of once per right-hand side. Each right-hand side of a batch has its own Krylov basis
+# of RESTART+1 vectors in memory. 1 solves them one by one.
+params_simu.GMRES_MULTIPLE_RHS_BATCH_SIZE = 4
 # inner solver characteristics. will be used only if FGMRES is used
 params_simu.INNER_SOLVER = SOLVERS[0]
 params_simu.INNER_TOL = 0.25
 params_simu.INNER_MAXITER = 15
 params_simu.INNER_RESTART = 30
+# two-level preconditioner: if 1, the inner solver uses a coarse MLFMA, whose alpha
+# translations only keep the coefficients above INNER_COARSE_ALPHA_THRESHOLD times
+# their maximum. Cheaper inner iterations, at the cost of a less accurate correction.
+params_simu.INNER_COARSE_MLFMA = 0
+params_simu.INNER_COARSE_ALPHA_THRESHOLD = 1.0e-2
 # preconditioner type. No choice here
 params_simu.PRECOND = "FROB"
 